@@ -0,0 +1,289 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "aggregate.h"
+#include "field_codec.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+static bool isFloat(FieldType type)
+{
+    return type == FieldType::FLOAT || type == FieldType::DOUBLE;
+}
+
+// ̵Ŀɻԭʾ
+static std::string formatDouble(double value)
+{
+    char buf[32];
+    return std::string(buf, std::to_chars(buf, buf + sizeof(buf), value).ptr);
+}
+
+bool AggregateEvaluator::compile(const TableDef& def, const std::vector<AggregateDef>& aggregates)
+{
+    bound.clear();
+    nulls = NullMask();
+    for (const auto& agg : aggregates)
+    {
+        BoundAggregate b;
+        b.def = agg;
+        b.star = agg.field == "*";
+        b.offset = 0;
+        b.width = 0;
+        b.field.type = FieldType::INT;
+        b.field.size = 0;
+
+        if (b.star)
+        {
+            if (agg.func != AggregateFunc::COUNT)
+            {
+                std::cerr << "Only COUNT accepts *: " << agg.label() << std::endl;
+                return false;
+            }
+        }
+        else
+        {
+            int index = def.fieldIndex(agg.field);
+            if (index < 0)
+            {
+                std::cerr << "Unknown field in aggregate: " << agg.field << std::endl;
+                return false;
+            }
+
+            b.column = def.layout.column(index);
+            b.offset = b.column.offset;
+            b.field = b.column.field;
+            b.width = b.column.width;
+            nulls.add(b.column);
+
+            if (!isNumericType(b.field.type) &&
+                (agg.func == AggregateFunc::SUM || agg.func == AggregateFunc::AVG))
+            {
+                std::cerr << "SUM/AVG require a numeric field: " << agg.label() << std::endl;
+                return false;
+            }
+        }
+        bound.push_back(b);
+    }
+    return true;
+}
+
+void AggregateEvaluator::accumulate(AggregateState* states, const char* row, size_t size) const
+{
+    // ۺ NULLCOUNT(field) ֻ NULL ֵ
+    bool hasNull = !nulls.empty() && nulls.any(row);
+    for (size_t i = 0; i < bound.size(); i++)
+    {
+        const BoundAggregate& b = bound[i];
+        AggregateState& s = states[i];
+
+        if (b.star)
+        {
+            s.count++;
+            continue;
+        }
+        if (hasNull && b.column.isNull(row))
+        {
+            continue;
+        }
+
+        if (b.field.type != FieldType::VARCHAR)
+        {
+            if (b.offset + b.width > size)
+            {
+                continue;
+            }
+            const char* val = row + b.offset;
+            if (s.count == 0 || compareField(b.field, val, s.minValue) < 0)
+            {
+                std::memcpy(s.minValue, val, b.width);
+            }
+            if (s.count == 0 || compareField(b.field, val, s.maxValue) > 0)
+            {
+                std::memcpy(s.maxValue, val, b.width);
+            }
+            if (isFloat(b.field.type))
+            {
+                s.floatSum += fieldAsDouble(b.field, val);
+            }
+            else
+            {
+                s.intSum += fieldAsInteger(b.field, val);
+            }
+            s.count++;
+        }
+        else
+        {
+            if (b.offset >= size)
+            {
+                continue;
+            }
+            // ֻ MIN/MAX Ҫַ
+            if (b.def.func == AggregateFunc::MIN || b.def.func == AggregateFunc::MAX)
+            {
+                std::string_view val = b.column.text(row, size);
+                if (s.count == 0 || val < s.strMin)
+                {
+                    s.strMin = val;
+                }
+                if (s.count == 0 || val > s.strMax)
+                {
+                    s.strMax = val;
+                }
+            }
+            s.count++;
+        }
+    }
+}
+
+void AggregateEvaluator::merge(AggregateState* into, const AggregateState* from) const
+{
+    for (size_t i = 0; i < bound.size(); i++)
+    {
+        AggregateState& a = into[i];
+        const AggregateState& b = from[i];
+        if (b.count == 0)
+        {
+            continue;
+        }
+
+        if (a.count == 0)
+        {
+            a = b;
+            continue;
+        }
+
+        const BoundAggregate& column = bound[i];
+        a.intSum += b.intSum;
+        a.floatSum += b.floatSum;
+        if (column.field.type != FieldType::VARCHAR)
+        {
+            if (compareField(column.field, b.minValue, a.minValue) < 0)
+            {
+                std::memcpy(a.minValue, b.minValue, column.width);
+            }
+            if (compareField(column.field, b.maxValue, a.maxValue) > 0)
+            {
+                std::memcpy(a.maxValue, b.maxValue, column.width);
+            }
+        }
+        if (b.strMin < a.strMin)
+        {
+            a.strMin = b.strMin;
+        }
+        if (b.strMax > a.strMax)
+        {
+            a.strMax = b.strMax;
+        }
+        a.count += b.count;
+    }
+}
+
+std::vector<std::string> AggregateEvaluator::finalize(const AggregateState* states) const
+{
+    std::vector<std::string> row;
+    for (size_t i = 0; i < bound.size(); i++)
+    {
+        const BoundAggregate& b = bound[i];
+        const AggregateState& s = states[i];
+
+        if (b.def.func == AggregateFunc::COUNT)
+        {
+            row.push_back(std::to_string(s.count));
+            continue;
+        }
+
+        if (s.count == 0)
+        {
+            row.push_back("NULL");
+            continue;
+        }
+
+        switch (b.def.func)
+        {
+        case AggregateFunc::SUM:
+            row.push_back(isFloat(b.field.type) ? formatDouble(s.floatSum) : std::to_string(s.intSum));
+            break;
+        case AggregateFunc::MIN:
+            row.push_back(b.field.type == FieldType::VARCHAR ? s.strMin : decodeField(b.field, s.minValue));
+            break;
+        case AggregateFunc::MAX:
+            row.push_back(b.field.type == FieldType::VARCHAR ? s.strMax : decodeField(b.field, s.maxValue));
+            break;
+        case AggregateFunc::AVG:
+        {
+            std::ostringstream oss;
+            oss << (isFloat(b.field.type) ? s.floatSum : static_cast<double>(s.intSum)) / s.count;
+            row.push_back(oss.str());
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    return row;
+}
+
+static bool writeString(FILE* fp, const std::string& str)
+{
+    size_t len = str.size();
+    return fwrite(&len, sizeof(size_t), 1, fp) == 1 &&
+        (len == 0 || fwrite(str.data(), len, 1, fp) == 1);
+}
+
+static bool readString(FILE* fp, std::string& str)
+{
+    size_t len;
+    if (fread(&len, sizeof(size_t), 1, fp) != 1)
+    {
+        return false;
+    }
+    str.resize(len);
+    return len == 0 || fread(&str[0], len, 1, fp) == 1;
+}
+
+bool AggregateEvaluator::writeStates(FILE* fp, const AggregateState* states) const
+{
+    for (size_t i = 0; i < bound.size(); i++)
+    {
+        const AggregateState& s = states[i];
+        if (fwrite(&s.count, sizeof(s.count), 1, fp) != 1 ||
+            fwrite(&s.intSum, sizeof(s.intSum), 1, fp) != 1 ||
+            fwrite(&s.floatSum, sizeof(s.floatSum), 1, fp) != 1 ||
+            fwrite(s.minValue, sizeof(s.minValue), 1, fp) != 1 ||
+            fwrite(s.maxValue, sizeof(s.maxValue), 1, fp) != 1 ||
+            !writeString(fp, s.strMin) || !writeString(fp, s.strMax))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AggregateEvaluator::readStates(FILE* fp, AggregateState* states) const
+{
+    for (size_t i = 0; i < bound.size(); i++)
+    {
+        AggregateState& s = states[i];
+        if (fread(&s.count, sizeof(s.count), 1, fp) != 1 ||
+            fread(&s.intSum, sizeof(s.intSum), 1, fp) != 1 ||
+            fread(&s.floatSum, sizeof(s.floatSum), 1, fp) != 1 ||
+            fread(s.minValue, sizeof(s.minValue), 1, fp) != 1 ||
+            fread(s.maxValue, sizeof(s.maxValue), 1, fp) != 1 ||
+            !readString(fp, s.strMin) || !readString(fp, s.strMax))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<std::string> AggregateEvaluator::labels() const
+{
+    std::vector<std::string> result;
+    for (const auto& b : bound)
+    {
+        result.push_back(b.def.label());
+    }
+    return result;
+}
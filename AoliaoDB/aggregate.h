@@ -0,0 +1,63 @@
+#pragma once
+#include "query_def.h"
+#include "table_def.h"
+#include <stdio.h>
+
+// ۺϺĲ״̬ÿ̸߳ۻϲ
+struct AggregateState
+{
+    long long count = 0;
+    long long intSum = 0;   // INT/BIGINT ĺ
+    double floatSum = 0;    // FLOAT/DOUBLE ĺ
+    char minValue[8] = {};  // ͵С/ֵԭʼ
+    char maxValue[8] = {};
+    std::string strMin;
+    std::string strMax;
+};
+
+// 󶨵ṹľۺϺбֱڶƼ¼ۻ
+class AggregateEvaluator
+{
+public:
+    bool compile(const TableDef& def, const std::vector<AggregateDef>& aggregates);
+
+    std::vector<AggregateState> createStates() const
+    {
+        return std::vector<AggregateState>(bound.size());
+    }
+
+    // ۺϺstates ĳ
+    size_t size() const
+    {
+        return bound.size();
+    }
+
+    // ۻһ¼
+    void accumulate(AggregateState* states, const char* row, size_t size) const;
+
+    // ϲһ̵߳Ĳ״̬
+    void merge(AggregateState* into, const AggregateState* from) const;
+
+    // ս
+    std::vector<std::string> finalize(const AggregateState* states) const;
+
+    // ״̬д/ļ
+    bool writeStates(FILE* fp, const AggregateState* states) const;
+    bool readStates(FILE* fp, AggregateState* states) const;
+
+    std::vector<std::string> labels() const;
+
+private:
+    struct BoundAggregate
+    {
+        AggregateDef def;
+        bool star;
+        size_t offset;
+        size_t width;
+        FieldDef field;
+        ColumnLayout column;
+    };
+
+    std::vector<BoundAggregate> bound;
+    NullMask nulls; // ۺϵУû NULL ʱм
+};
@@ -4,8 +4,9 @@
 #include <stdlib.h>
 #include <iostream>
 #include <list>
+#include <set>
 #include <algorithm>
-#include <iomanip>
+#include <stdexcept>
 using std::binary_search;
 using std::lower_bound;
 using std::swap;
@@ -40,17 +41,29 @@ namespace bpt
         return lower_bound(begin(node), end(node), key);
     }
 
-    bplus_tree::bplus_tree(const char* p, bool force_empty)
-        : fp(NULL), fp_level(0)
+    bplus_tree::bplus_tree(const char* p, bool force_empty, size_t value_size, bool copy_on_write)
+        : fp(NULL), fp_level(0), sync_deferred(false), transaction(false), truncated(false),
+        cow(false), pages(std::make_shared<page_table_t>()), version(0), unpreserved(false)
     {
         memset(path, 0, sizeof(path));
         strcpy(path, p);
+        memset(&published, 0, sizeof(meta_t));
+        memset(&cow_header, 0, sizeof(cow_header_t));
 
         if (!force_empty)
         {
             // Զȡļ
             open_file("rb+");
-            if (fp && map(&meta, OFFSET_META) != 0)
+            page_table_t table;
+            int loaded = fp ? load_cow(fp, cow_header, table, cow_space) : 1;
+            if (loaded == 0)
+            {
+                // дʱļԪڵǰļͷ
+                cow = true;
+                meta = cow_header.meta;
+                pages = std::make_shared<page_table_t>(std::move(table));
+            }
+            else if (fp && (loaded < 0 || map(&meta, OFFSET_META) != 0))
             {
                 close_file();
                 force_empty = true;
@@ -67,9 +80,12 @@ namespace bpt
             open_file("wb+");
             if (fp)
             {
+                // дʱģʽЩ pending Уɵһύд
+                cow = copy_on_write;
+
                 // ʼԪ
                 meta.order = BP_ORDER;
-                meta.value_size = sizeof(value_t);
+                meta.value_size = value_size > 0 ? value_size : sizeof(value_t);
                 meta.key_size = sizeof(key_t);
                 meta.internal_node_num = 0;
                 meta.leaf_node_num = 0;
@@ -99,12 +115,18 @@ namespace bpt
 
                 fflush(fp);
                 close_file();
+                if (cow && commit_cow() != 0)
+                {
+                    std::cerr << "Failed to create copy-on-write file: " << path << std::endl;
+                }
             }
         }
+        published = meta;
     }
 
     int bplus_tree::search(const key_t& key, value_t* value) const
     {
+        std::lock_guard<std::recursive_mutex> lock(file_mutex);
         std::cout << "Searching for key: " << key.k << std::endl;
 
         leaf_node_t leaf;
@@ -141,9 +163,45 @@ namespace bpt
         }
     }
 
+    int bplus_tree::search_batch(const std::vector<key_t>& keys,
+        const std::function<void(size_t, const value_t&)>& callback) const
+    {
+        std::lock_guard<std::recursive_mutex> lock(file_mutex);
+        leaf_node_t leaf;
+        off_t current = 0;
+        int reads = 0;
+
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            // 򣺲ڵǰҶһʱڵǰҶӣٴӸ½
+            if (current == 0 || leaf.n == 0 || keycmp(keys[i], leaf.children[leaf.n - 1].key) > 0)
+            {
+                off_t offset = search_leaf(keys[i]);
+                if (offset != current)
+                {
+                    if (map(&leaf, offset) != 0)
+                    {
+                        std::cerr << "Failed to read leaf node" << std::endl;
+                        return -1;
+                    }
+                    current = offset;
+                    reads++;
+                }
+            }
+
+            record_t* record = find(leaf, keys[i]);
+            if (record != leaf.children + leaf.n && keycmp(record->key, keys[i]) == 0)
+            {
+                callback(i, record->value);
+            }
+        }
+        return reads;
+    }
+
     int bplus_tree::search_range(key_t* left, const key_t& right,
         value_t* values, size_t max, bool* next) const
     {
+        std::lock_guard<std::recursive_mutex> lock(file_mutex);
         if (left == NULL || keycmp(*left, right) > 0)
             return -1;
 
@@ -229,269 +287,1805 @@ namespace bpt
         // merge or borrow
         if (leaf.n < min_n)
         {
-            // first borrow from left
-            bool borrowed = false;
-            if (leaf.prev != 0)
-                borrowed = borrow_key(false, leaf);
+            rebalance_leaf(parent_off, parent, where, offset, leaf);
+        }
+        else
+        {
+            unmap(&leaf, offset);
+        }
 
-            // then borrow from right
-            if (!borrowed && leaf.next != 0)
-                borrowed = borrow_key(true, leaf);
+        return 0;
+    }
 
-            // finally we merge
-            if (!borrowed)
+    off_t bplus_tree::rebalance_leaf(off_t parent_off, internal_node_t& parent,
+        index_t* where, off_t offset, leaf_node_t& leaf)
+    {
+        off_t freed = 0;
+
+        /* only borrow from siblings under the same parent, a lender
+         * under another parent has its separator key in an ancestor
+         * that borrow_key does not update */
+        // first borrow from left
+        bool borrowed = false;
+        if (leaf.prev != 0 && where != begin(parent))
+            borrowed = borrow_key(false, leaf);
+
+        // then borrow from right
+        if (!borrowed && leaf.next != 0 && where != end(parent) - 1)
+            borrowed = borrow_key(true, leaf);
+
+        // finally we merge
+        if (!borrowed)
+        {
+            assert(leaf.next != 0 || leaf.prev != 0);
+
+            key_t index_key;
+
+            if (where == end(parent) - 1)
+            {
+                // if leaf is last element then merge | prev | leaf |
+                assert(leaf.prev != 0);
+                leaf_node_t prev;
+                map(&prev, leaf.prev);
+                index_key = begin(prev)->key;
+
+                merge_leafs(&prev, &leaf);
+                node_remove(&prev, &leaf);
+                unmap(&prev, leaf.prev);
+                freed = offset;
+            }
+            else
+            {
+                // else merge | leaf | next |
+                assert(leaf.next != 0);
+                leaf_node_t next;
+                map(&next, leaf.next);
+                index_key = begin(leaf)->key;
+                freed = leaf.next;
+
+                merge_leafs(&leaf, &next);
+                node_remove(&leaf, &next);
+                unmap(&leaf, offset);
+            }
+
+            // remove parent's key
+            remove_from_index(parent_off, parent, index_key);
+        }
+        else
+        {
+            unmap(&leaf, offset);
+        }
+        return freed;
+    }
+
+    int bplus_tree::insert(const key_t& key, value_t value)
+    {
+        return upsert(key, value, [](value_t&)
+            {
+                return false;
+            });
+    }
+
+    int bplus_tree::upsert(const key_t& key, value_t value,
+        const std::function<bool(value_t&)>& replace)
+    {
+        open_file("rb+");
+        if (!fp)
+        {
+            std::cerr << "Failed to open file" << std::endl;
+            return -1;
+        }
+
+        try
+        {
+            // ȡԪ
+            if (map(&meta, OFFSET_META) != 0)
+            {
+                std::cerr << "Failed to read meta data" << std::endl;
+                close_file();
+                return -1;
+            }
+
+            std::cout << "Current tree meta - height: " << meta.height
+                << ", leaf_num: " << meta.leaf_node_num
+                << ", internal_num: " << meta.internal_node_num << std::endl;
+
+            off_t parent = search_index(key);
+            std::cout << "Found parent node at offset: " << parent << std::endl;
+
+            off_t offset = search_leaf(parent, key);
+            std::cout << "Found leaf node at offset: " << offset << std::endl;
+
+            leaf_node_t leaf;
+            if (map(&leaf, offset) != 0)
             {
-                assert(leaf.next != 0 || leaf.prev != 0);
+                std::cerr << "Failed to read leaf node" << std::endl;
+                close_file();
+                return -1;
+            }
+
+            std::cout << "Leaf node info - n: " << leaf.n
+                << ", parent: " << leaf.parent
+                << ", next: " << leaf.next
+                << ", prev: " << leaf.prev << std::endl;
 
-                key_t index_key;
+            // Ѵʱ replace ԭ޸ģ½ڶ
+            record_t* record = find(leaf, key);
+            if (record != end(leaf) && keycmp(record->key, key) == 0)
+            {
+                std::cout << "Found existing key " << key.k << " in leaf node" << std::endl;
+                bool changed = true;
+                if (replace)
+                {
+                    changed = replace(record->value);
+                }
+                else
+                {
+                    record->value = value;
+                }
+                if (changed && unmap(&leaf, offset) != 0)
+                {
+                    std::cerr << "Failed to save leaf node" << std::endl;
+                    close_file();
+                    return -1;
+                }
+                close_file();
+                return 1;
+            }
 
-                if (where == end(parent) - 1)
+            // ǷҪ
+            if (leaf.n >= meta.order)
+            {
+                insert_record_split(parent, offset, leaf, key, value);
+            }
+            else
+            {
+                std::cout << "Direct insert without split" << std::endl;
+                insert_record_no_split(&leaf, key, value);
+                if (unmap(&leaf, offset) != 0)
                 {
-                    // if leaf is last element then merge | prev | leaf |
-                    assert(leaf.prev != 0);
-                    leaf_node_t prev;
-                    map(&prev, leaf.prev);
-                    index_key = begin(prev)->key;
+                    std::cerr << "Failed to save leaf node" << std::endl;
+                }
+            }
+
+            close_file();
+            return 0;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Exception during insert: " << e.what() << std::endl;
+            if (fp_level > 0)
+            {
+                close_file();
+            }
+            throw;
+        }
+    }
+
+    int bplus_tree::insert_batch(const std::vector<key_t>& keys, const char* data, size_t size,
+        const size_t* lengths)
+    {
+        open_file("rb+");
+        if (!fp)
+        {
+            std::cerr << "Failed to open file" << std::endl;
+            return -1;
+        }
+
+        // дڼÿֻдͬʱͳһͬһ
+        sync_deferred = true;
+        try
+        {
+            if (map(&meta, OFFSET_META) != 0)
+            {
+                std::cerr << "Failed to read meta data" << std::endl;
+                sync_deferred = false;
+                close_file();
+                return -1;
+            }
+
+            value_t value;
+            value.size = size;
+            value.data = new char[size];
+
+            // ǰҶڴУڱҶӻʱд
+            leaf_node_t leaf;
+            off_t current = 0;
+            bool dirty = false;
+            int result = 0;
+
+            for (size_t i = 0; i < keys.size(); i++)
+            {
+                off_t parent = search_index(keys[i]);
+                off_t offset = search_leaf(parent, keys[i]);
+                if (offset != current)
+                {
+                    if (dirty && unmap(&leaf, current) != 0)
+                    {
+                        std::cerr << "Failed to save leaf node" << std::endl;
+                        result = -1;
+                        break;
+                    }
+                    dirty = false;
+                    if (map(&leaf, offset) != 0)
+                    {
+                        std::cerr << "Failed to read leaf node" << std::endl;
+                        current = 0;
+                        result = -1;
+                        break;
+                    }
+                    current = offset;
+                }
+
+                if (binary_search(begin(leaf), end(leaf), keys[i]))
+                {
+                    std::cout << "Found existing key " << keys[i].k << " in leaf node" << std::endl;
+                    result = 1;
+                    break;
+                }
+
+                value.size = lengths ? lengths[i] : size;
+                std::memcpy(value.data, data + i * size, value.size);
+                if (leaf.n >= meta.order)
+                {
+                    // ѻдҶӺڵ㣬һ´Ӹ
+                    insert_record_split(parent, offset, leaf, keys[i], value);
+                    current = 0;
+                    dirty = false;
+                }
+                else
+                {
+                    insert_record_no_split(&leaf, keys[i], value);
+                    dirty = true;
+                }
+            }
+
+            if (dirty && unmap(&leaf, current) != 0)
+            {
+                std::cerr << "Failed to save leaf node" << std::endl;
+                result = -1;
+            }
+            unmap(&meta, OFFSET_META);
+
+            sync_deferred = false;
+            fflush(fp);
+#ifdef _WIN32
+            _commit(_fileno(fp));
+#else
+            fsync(fileno(fp));
+#endif
+            close_file();
+            return result;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Exception during batch insert: " << e.what() << std::endl;
+            sync_deferred = false;
+            if (fp_level > 0)
+            {
+                close_file();
+            }
+            throw;
+        }
+    }
+
+    /* the g-th of `count` even groups over `items` starts at this index */
+    static size_t group_begin(size_t items, size_t count, size_t g)
+    {
+        return items * g / count;
+    }
+
+    int bplus_tree::bulk_load(const std::vector<key_t>& keys, const char* data, size_t size,
+        const size_t* lengths)
+    {
+        open_file("rb+");
+        if (!fp)
+        {
+            std::cerr << "Failed to open file" << std::endl;
+            return -1;
+        }
+
+        sync_deferred = true;
+        try
+        {
+            leaf_node_t leaf;
+            if (map(&meta, OFFSET_META) != 0 || map(&leaf, meta.leaf_offset) != 0)
+            {
+                std::cerr << "Failed to read tree" << std::endl;
+                sync_deferred = false;
+                close_file();
+                return -1;
+            }
+            if (meta.leaf_node_num != 1 || meta.height != 1 || leaf.n != 0)
+            {
+                std::cout << "Tree is not empty, bulk load refused" << std::endl;
+                sync_deferred = false;
+                close_file();
+                return 1;
+            }
+
+            // ԵȷÿĽڵÿڵ order ӣƽ
+            // levels[0] ҶӲ㣬һֻиڵ㣬еĵһҶӺ͸ڵλ
+            std::vector<std::vector<off_t>> levels;
+            size_t count = std::max<size_t>(1, (keys.size() + meta.order - 1) / meta.order);
+            levels.push_back(std::vector<off_t>(count));
+            do
+            {
+                count = (count + meta.order - 1) / meta.order;
+                levels.push_back(std::vector<off_t>(count));
+            } while (count > 1);
+
+            levels[0][0] = meta.leaf_offset;
+            for (size_t i = 1; i < levels[0].size(); i++)
+            {
+                levels[0][i] = alloc(&leaf);
+            }
+            internal_node_t node;
+            for (size_t l = 1; l + 1 < levels.size(); l++)
+            {
+                for (size_t i = 0; i < levels[l].size(); i++)
+                {
+                    levels[l][i] = alloc(&node);
+                }
+            }
+            levels.back()[0] = meta.root_offset;
+
+            // ÿڵĸڵ
+            std::vector<std::vector<off_t>> parents(levels.size());
+            for (size_t l = 0; l + 1 < levels.size(); l++)
+            {
+                size_t n = levels[l].size();
+                size_t groups = levels[l + 1].size();
+                parents[l].resize(n);
+                for (size_t g = 0; g < groups; g++)
+                {
+                    for (size_t i = group_begin(n, groups, g); i < group_begin(n, groups, g + 1); i++)
+                    {
+                        parents[l][i] = levels[l + 1][g];
+                    }
+                }
+            }
+            parents.back().assign(1, 0);
+
+            // ҶӲ
+            std::vector<key_t> firsts(levels[0].size());
+            size_t leaves = levels[0].size();
+            for (size_t g = 0; g < leaves; g++)
+            {
+                size_t from = group_begin(keys.size(), leaves, g);
+                size_t to = group_begin(keys.size(), leaves, g + 1);
+                leaf.parent = parents[0][g];
+                leaf.prev = g > 0 ? levels[0][g - 1] : 0;
+                leaf.next = g + 1 < leaves ? levels[0][g + 1] : 0;
+                leaf.n = to - from;
+                for (size_t i = from; i < to; i++)
+                {
+                    record_t& record = leaf.children[i - from];
+                    record.key = keys[i];
+                    record.value.clear();
+                    record.value.size = lengths ? lengths[i] : size;
+                    record.value.data = new char[record.value.size];
+                    std::memcpy(record.value.data, data + i * size, record.value.size);
+                }
+                if (leaf.n > 0)
+                {
+                    firsts[g] = keys[from];
+                }
+                if (unmap(&leaf, levels[0][g]) != 0)
+                {
+                    throw std::runtime_error("failed to write leaf node");
+                }
+            }
+
+            // 㣺children[i].key ǵ i + 1 ӵС
+            for (size_t l = 1; l < levels.size(); l++)
+            {
+                size_t n = levels[l - 1].size();
+                size_t groups = levels[l].size();
+                std::vector<key_t> upper(groups);
+                for (size_t g = 0; g < groups; g++)
+                {
+                    size_t from = group_begin(n, groups, g);
+                    size_t to = group_begin(n, groups, g + 1);
+                    node.parent = parents[l][g];
+                    node.prev = g > 0 ? levels[l][g - 1] : 0;
+                    node.next = g + 1 < groups ? levels[l][g + 1] : 0;
+                    node.n = to - from;
+                    for (size_t i = from; i < to; i++)
+                    {
+                        node.children[i - from].child = levels[l - 1][i];
+                        node.children[i - from].key = i + 1 < to ? firsts[i + 1] : key_t();
+                    }
+                    upper[g] = firsts[from];
+                    if (unmap(&node, levels[l][g]) != 0)
+                    {
+                        throw std::runtime_error("failed to write internal node");
+                    }
+                }
+                firsts.swap(upper);
+            }
+
+            meta.height = levels.size() - 1;
+            unmap(&meta, OFFSET_META);
+
+            sync_deferred = false;
+            fflush(fp);
+#ifdef _WIN32
+            _commit(_fileno(fp));
+#else
+            fsync(fileno(fp));
+#endif
+            close_file();
+            std::cout << "Bulk loaded " << keys.size() << " records into " << leaves
+                << " leaves, height " << meta.height << std::endl;
+            return 0;
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Exception during bulk load: " << e.what() << std::endl;
+            sync_deferred = false;
+            if (fp_level > 0)
+            {
+                close_file();
+            }
+            throw;
+        }
+    }
+
+    void bplus_tree::insert_record_split(off_t parent, off_t offset,
+        leaf_node_t& leaf, const key_t& key, const value_t& value)
+    {
+        std::cout << "Need to split leaf node" << std::endl;
+
+        // µҶӽڵ
+        leaf_node_t new_leaf;
+        node_create(offset, &leaf, &new_leaf);
+
+        std::cout << "Created new leaf node - next: " << new_leaf.next
+            << ", prev: " << new_leaf.prev << std::endl;
+
+        // ҵѵ
+        size_t point = leaf.n / 2;
+        bool place_right = keycmp(key, leaf.children[point].key) > 0;
+        if (place_right)
+            ++point;
+
+        std::cout << "Split point: " << point
+            << ", place_right: " << place_right << std::endl;
+
+        // ѽڵ
+        for (size_t i = point; i < leaf.n; i++)
+        {
+            // 
+            new_leaf.children[i - point].key = leaf.children[i].key;
+            new_leaf.children[i - point].value.clear();
+            if (leaf.children[i].value.data && leaf.children[i].value.size > 0)
+            {
+                new_leaf.children[i - point].value.size = leaf.children[i].value.size;
+                new_leaf.children[i - point].value.data = new char[leaf.children[i].value.size];
+                std::memcpy(new_leaf.children[i - point].value.data,
+                    leaf.children[i].value.data,
+                    leaf.children[i].value.size);
+            }
+        }
+        new_leaf.n = leaf.n - point;
+        leaf.n = point;
+
+        std::cout << "After split - old leaf n: " << leaf.n
+            << ", new leaf n: " << new_leaf.n << std::endl;
+
+        // ¼¼
+        if (place_right)
+        {
+            std::cout << "Inserting into new leaf" << std::endl;
+            insert_record_no_split(&new_leaf, key, value);
+        }
+        else
+        {
+            std::cout << "Inserting into old leaf" << std::endl;
+            insert_record_no_split(&leaf, key, value);
+        }
+
+        // ڵ
+        if (unmap(&leaf, offset) != 0)
+        {
+            std::cerr << "Failed to save old leaf" << std::endl;
+        }
+        if (unmap(&new_leaf, leaf.next) != 0)
+        {
+            std::cerr << "Failed to save new leaf" << std::endl;
+        }
+
+        // 
+        std::cout << "Updating index with key: " << new_leaf.children[0].key.k << std::endl;
+        insert_key_to_index(parent, new_leaf.children[0].key,
+            offset, leaf.next);
+    }
+
+    int bplus_tree::update(const key_t& key, value_t value)
+    {
+        off_t offset = search_leaf(key);
+        leaf_node_t leaf;
+        map(&leaf, offset);
+
+        record_t* record = find(leaf, key);
+        if (record != leaf.children + leaf.n)
+            if (keycmp(key, record->key) == 0)
+            {
+                record->value = value;
+                unmap(&leaf, offset);
+
+                return 0;
+            }
+            else
+            {
+                return 1;
+            }
+        else
+            return -1;
+    }
+
+    int bplus_tree::update_scan(const std::function<bool(const key_t&, value_t&)>& visit)
+    {
+        open_file("rb+");
+        if (!fp)
+        {
+            std::cerr << "Failed to open file" << std::endl;
+            return -1;
+        }
+
+        sync_deferred = true;
+        int changed = 0;
+        leaf_node_t leaf;
+        for (off_t offset = meta.leaf_offset; offset != 0; offset = leaf.next)
+        {
+            if (map(&leaf, offset) != 0)
+            {
+                std::cerr << "Failed to read leaf node" << std::endl;
+                changed = -1;
+                break;
+            }
+
+            bool dirty = false;
+            for (size_t i = 0; i < leaf.n; i++)
+            {
+                if (visit(leaf.children[i].key, leaf.children[i].value))
+                {
+                    dirty = true;
+                    changed++;
+                }
+            }
+            if (dirty && unmap(&leaf, offset) != 0)
+            {
+                std::cerr << "Failed to save leaf node" << std::endl;
+                changed = -1;
+                break;
+            }
+        }
+
+        sync_deferred = false;
+        fflush(fp);
+#ifdef _WIN32
+        _commit(_fileno(fp));
+#else
+        fsync(fileno(fp));
+#endif
+        close_file();
+        return changed;
+    }
+
+    int bplus_tree::remove_scan(const std::function<bool(const key_t&, const value_t&)>& match)
+    {
+        open_file("rb+");
+        if (!fp)
+        {
+            std::cerr << "Failed to open file" << std::endl;
+            return -1;
+        }
+
+        sync_deferred = true;
+        int removed = 0;
+        std::vector<key_t> rest; // ɾҶӻ᲻ļɾ
+        size_t min_n = meta.leaf_node_num == 1 ? 0 : meta.order / 2;
+        leaf_node_t leaf;
+        for (off_t offset = meta.leaf_offset; offset != 0; offset = leaf.next)
+        {
+            if (map(&leaf, offset) != 0)
+            {
+                std::cerr << "Failed to read leaf node" << std::endl;
+                removed = -1;
+                break;
+            }
+
+            // ԭѹļ¼ǰƣɾ min_n 
+            size_t kept = 0;
+            for (size_t i = 0; i < leaf.n; i++)
+            {
+                record_t& record = leaf.children[i];
+                if (match(record.key, record.value))
+                {
+                    if (kept + (leaf.n - i - 1) >= min_n)
+                    {
+                        removed++;
+                        continue;
+                    }
+                    rest.push_back(record.key);
+                }
+                if (kept != i)
+                {
+                    leaf.children[kept].key = record.key;
+                    leaf.children[kept].value = std::move(record.value);
+                }
+                kept++;
+            }
+
+            if (kept != leaf.n)
+            {
+                leaf.n = kept;
+                if (unmap(&leaf, offset) != 0)
+                {
+                    std::cerr << "Failed to save leaf node" << std::endl;
+                    removed = -1;
+                    break;
+                }
+            }
+        }
+
+        for (size_t i = 0; removed >= 0 && i < rest.size(); i++)
+        {
+            if (remove(rest[i]) == 0)
+            {
+                removed++;
+            }
+        }
+
+        unmap(&meta, OFFSET_META);
+        sync_deferred = false;
+        fflush(fp);
+#ifdef _WIN32
+        _commit(_fileno(fp));
+#else
+        fsync(fileno(fp));
+#endif
+        close_file();
+        return removed;
+    }
+
+    int bplus_tree::remove_range(const key_t* left, const key_t* right,
+        const std::function<bool(const key_t&, const value_t&)>& match)
+    {
+        open_file("rb+");
+        if (!fp)
+        {
+            std::cerr << "Failed to open file" << std::endl;
+            return -1;
+        }
+
+        sync_deferred = true;
+        int removed = 0;
+        std::vector<off_t> underfull; // ɾҶӣΧɾٽûϲ
+        size_t min_n = meta.order / 2;
+        off_t offset = left ? search_leaf(*left) : meta.leaf_offset;
+        leaf_node_t leaf;
+        while (offset != 0)
+        {
+            if (map(&leaf, offset) != 0)
+            {
+                std::cerr << "Failed to read leaf node" << std::endl;
+                removed = -1;
+                break;
+            }
+            off_t next = leaf.next;
+
+            size_t n = 0;
+            bool past = false;
+            for (size_t i = 0; i < leaf.n; i++)
+            {
+                record_t& record = leaf.children[i];
+                bool inside = (!left || keycmp(record.key, *left) >= 0) && !past &&
+                    (!right || keycmp(record.key, *right) <= 0);
+                past = past || (right && keycmp(record.key, *right) > 0);
+                if (inside && match(record.key, record.value))
+                {
+                    removed++;
+                    continue;
+                }
+                if (n != i)
+                {
+                    leaf.children[n].key = record.key;
+                    leaf.children[n].value = std::move(record.value);
+                }
+                n++;
+            }
+
+            if (n != leaf.n)
+            {
+                // ļ¼ԭҶУʱ
+                leaf.n = n;
+                unmap(&leaf, offset);
+                if (n < min_n)
+                {
+                    underfull.push_back(offset);
+                }
+            }
+            if (past)
+            {
+                break;
+            }
+            offset = next;
+        }
+
+        // ˳޸ҶӣʱҶӵļ¼ȷ
+        // ϲͷŵҶӿܻ underfull У
+        std::vector<off_t> freed;
+        for (off_t current : underfull)
+        {
+            while (current != 0 && meta.leaf_node_num > 1 &&
+                std::find(freed.begin(), freed.end(), current) == freed.end())
+            {
+                map(&leaf, current);
+                if (leaf.n >= min_n)
+                {
+                    break;
+                }
+                if (leaf.n == 0)
+                {
+                    detach_leaf(current, leaf);
+                    freed.push_back(current);
+                    break;
+                }
+
+                internal_node_t parent;
+                map(&parent, leaf.parent);
+                index_t* where = begin(parent);
+                while (where != end(parent) && where->child != current)
+                    ++where;
+                assert(where != end(parent));
+
+                // ÿν赽һ¼ߺϲҶӺϲԿܲ㣬
+                // ͬһҶӻϲĽ
+                off_t prev = leaf.prev;
+                off_t merged = rebalance_leaf(leaf.parent, parent, where, current, leaf);
+                if (merged != 0)
+                {
+                    freed.push_back(merged);
+                    current = merged == current ? prev : current;
+                }
+            }
+        }
+
+        unmap(&meta, OFFSET_META);
+        sync_deferred = false;
+        fflush(fp);
+#ifdef _WIN32
+        _commit(_fileno(fp));
+#else
+        fsync(fileno(fp));
+#endif
+        close_file();
+        return removed;
+    }
+
+    void bplus_tree::detach_leaf(off_t offset, leaf_node_t& leaf)
+    {
+        // ҶҶ
+        if (leaf.prev != 0)
+        {
+            leaf_node_t prev;
+            map(&prev, leaf.prev, SIZE_NO_CHILDREN);
+            prev.next = leaf.next;
+            unmap(&prev, leaf.prev, SIZE_NO_CHILDREN);
+        }
+        else
+        {
+            meta.leaf_offset = leaf.next;
+        }
+        if (leaf.next != 0)
+        {
+            leaf_node_t next;
+            map(&next, leaf.next, SIZE_NO_CHILDREN);
+            next.prev = leaf.prev;
+            unmap(&next, leaf.next, SIZE_NO_CHILDREN);
+        }
+        unalloc(&leaf, offset);
+
+        /* dropping entry i leaves its range to the next child, or to
+         * the previous one when i is the last entry */
+        internal_node_t parent;
+        map(&parent, leaf.parent);
+        key_t index_key = begin(parent)->key;
+        index_t* where = begin(parent);
+        while (where->child != offset)
+            ++where;
+        std::copy(where + 1, end(parent), where);
+        parent.n--;
+        rebalance_index(leaf.parent, parent, index_key);
+        unmap(&meta, OFFSET_META);
+    }
+
+    int bplus_tree::truncate()
+    {
+        size_t value_size = meta.value_size;
+        if (buffered())
+        {
+            // ļύʱգдʱļɿյҳ֮ǰдĿ鶼
+            pending.clear();
+            truncated = true;
+            init_from_empty(value_size);
+            return 0;
+        }
+
+        // пʱɿ黹ҪȡܽضļֻǴͷ·
+        open_file(keep_for_snapshots() ? "rb+" : "wb+");
+        if (!fp)
+        {
+            std::cerr << "Failed to truncate file" << std::endl;
+            return -1;
+        }
+
+        init_from_empty(value_size);
+        close_file();
+        return 0;
+    }
+
+    void bplus_tree::begin_transaction()
+    {
+        pending.clear();
+        truncated = false;
+        transaction = true;
+    }
+
+    int bplus_tree::apply_pending()
+    {
+        int result = 0;
+        if (cow)
+        {
+            result = commit_cow();
+        }
+        else if (truncated || !pending.empty())
+        {
+            // رԼľво
+            close_tree_file();
+            bool snapshots = truncated && keep_for_snapshots();
+            FILE* f = fopen(path, "rb");
+            for (pending_map_t::const_iterator it = pending.begin(); f && it != pending.end(); ++it)
+            {
+                preserve(f, it->first);
+            }
+            if (f)
+            {
+                fclose(f);
+            }
+            result = write_blocks(path, truncated && !snapshots, pending);
+        }
+        pending.clear();
+        truncated = false;
+        transaction = false;
+        return result;
+    }
+
+    void bplus_tree::rollback()
+    {
+        pending.clear();
+        truncated = false;
+        transaction = false;
+        if (cow)
+        {
+            meta = cow_header.meta;
+        }
+        else if (map(&meta, OFFSET_META) != 0)
+        {
+            std::cerr << "Failed to reload meta after rollback: " << path << std::endl;
+        }
+    }
+
+    int bplus_tree::write_blocks(const char* path, bool truncate, const pending_map_t& blocks)
+    {
+        // дʱļԭظдΪһµύ׷
+        FILE* f = fopen(path, "rb");
+        unsigned long long magic = 0;
+        if (f)
+        {
+            if (fread(&magic, sizeof(magic), 1, f) != 1)
+            {
+                magic = 0;
+            }
+            fclose(f);
+            f = nullptr;
+        }
+        if (magic == COW_MAGIC)
+        {
+            cow_header_t header;
+            page_table_t table;
+            cow_space_t space;
+            std::vector<page_t> superseded;
+            f = fopen(path, "rb+");
+            int result = f ? load_cow(f, header, table, space) : -1;
+            if (result == 0)
+            {
+                result = write_cow(f, header, table, space, truncate, blocks, superseded);
+            }
+            if (f)
+            {
+                fclose(f);
+            }
+            if (result != 0)
+            {
+                std::cerr << "Failed to commit blocks to copy-on-write file: " << path << std::endl;
+                return -1;
+            }
+            return 0;
+        }
+
+#ifdef _WIN32
+        fopen_s(&f, path, truncate ? "wb" : "rb+");
+#else
+        f = fopen(path, truncate ? "wb" : "rb+");
+#endif
+        if (!f)
+        {
+            std::cerr << "Failed to open file for commit: " << path << std::endl;
+            return -1;
+        }
+
+        int result = 0;
+        for (pending_map_t::const_iterator it = blocks.begin(); it != blocks.end(); ++it)
+        {
+            const std::string& bytes = it->second.bytes;
+            if (fseek(f, it->first, SEEK_SET) != 0 ||
+                (!bytes.empty() && fwrite(bytes.data(), bytes.size(), 1, f) != 1))
+            {
+                std::cerr << "Failed to write block at offset: " << it->first << std::endl;
+                result = -1;
+                break;
+            }
+        }
+
+        fflush(f);
+#ifdef _WIN32
+        _commit(_fileno(f));
+#else
+        fsync(fileno(f));
+#endif
+        fclose(f);
+        return result;
+    }
+
+    /* FNV-1a over the header fields before the checksum */
+    static unsigned long long header_checksum(const cow_header_t& header)
+    {
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(&header);
+        unsigned long long hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < offsetof(cow_header_t, checksum); i++)
+        {
+            hash = (hash ^ p[i]) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    /* a page table record: prev (0 for a full table), count, then count
+     * entries of block offset, physical offset and length */
+    static bool write_page(FILE* f, off_t offset, const page_t& page)
+    {
+        return fwrite(&offset, sizeof(off_t), 1, f) == 1 &&
+            fwrite(&page.physical, sizeof(off_t), 1, f) == 1 &&
+            fwrite(&page.length, sizeof(size_t), 1, f) == 1;
+    }
+
+    static const size_t PAGE_ENTRY_SIZE = 2 * sizeof(off_t) + sizeof(size_t);
+    static const size_t PAGE_RECORD_HEADER = sizeof(off_t) + sizeof(size_t);
+
+    /* first free extent that holds length bytes, or append at end */
+    static off_t allocate_extent(std::map<off_t, size_t>& gaps, off_t& end, size_t length)
+    {
+        for (std::map<off_t, size_t>::iterator it = gaps.begin(); length > 0 && it != gaps.end(); ++it)
+        {
+            if (it->second < length)
+                continue;
+            off_t offset = it->first;
+            size_t rest = it->second - length;
+            gaps.erase(it);
+            if (rest > 0)
+            {
+                gaps[offset + static_cast<off_t>(length)] = rest;
+            }
+            return offset;
+        }
+        off_t offset = end;
+        end += static_cast<off_t>(length);
+        return offset;
+    }
+
+    /* give an extent back, merged with the free extents next to it */
+    static void release_extent(std::map<off_t, size_t>& gaps, off_t offset, size_t length)
+    {
+        if (length == 0)
+            return;
+        std::map<off_t, size_t>::iterator next = gaps.lower_bound(offset);
+        if (next != gaps.begin())
+        {
+            std::map<off_t, size_t>::iterator prev = std::prev(next);
+            if (prev->first + static_cast<off_t>(prev->second) == offset)
+            {
+                offset = prev->first;
+                length += prev->second;
+                gaps.erase(prev);
+            }
+        }
+        if (next != gaps.end() && offset + static_cast<off_t>(length) == next->first)
+        {
+            length += next->second;
+            gaps.erase(next);
+        }
+        gaps[offset] = length;
+    }
+
+    int bplus_tree::load_cow(FILE* f, cow_header_t& header, page_table_t& table, cow_space_t& space)
+    {
+        unsigned long long magic = 0;
+        if (fseek(f, 0, SEEK_SET) != 0 || fread(&magic, sizeof(magic), 1, f) != 1 || magic != COW_MAGIC)
+            return 1;
+
+        // ļͷУͨҴϴǵǰģһдһ
+        bool found = false;
+        for (unsigned long long slot = 0; slot < 2; slot++)
+        {
+            cow_header_t candidate;
+            if (fseek(f, OFFSET_COW_HEADER(slot), SEEK_SET) == 0 &&
+                fread(&candidate, sizeof(candidate), 1, f) == 1 &&
+                candidate.magic == COW_MAGIC &&
+                candidate.checksum == header_checksum(candidate) &&
+                (!found || candidate.generation > header.generation))
+            {
+                header = candidate;
+                found = true;
+            }
+        }
+        if (!found)
+        {
+            std::cerr << "No valid copy-on-write header" << std::endl;
+            return -1;
+        }
+
+        // µļ¼ prev صҳٰд˳Ӧá
+        // ¼дڿУһǰһ֮
+        std::vector<std::vector<std::pair<off_t, page_t>>> records;
+        std::set<off_t> visited;
+        space.records.clear();
+        off_t record = header.table;
+        while (true)
+        {
+            off_t prev;
+            size_t count;
+            if (record < OFFSET_COW_DATA || record >= header.end || !visited.insert(record).second ||
+                fseek(f, record, SEEK_SET) != 0 ||
+                fread(&prev, sizeof(off_t), 1, f) != 1 ||
+                fread(&count, sizeof(size_t), 1, f) != 1 ||
+                count > static_cast<size_t>(header.end - record) / PAGE_ENTRY_SIZE)
+            {
+                std::cerr << "Corrupted page table record at offset: " << record << std::endl;
+                return -1;
+            }
+
+            page_t extent;
+            extent.physical = record;
+            extent.length = PAGE_RECORD_HEADER + count * PAGE_ENTRY_SIZE;
+            space.records.push_back(extent);
+            records.emplace_back(count);
+            for (auto& entry : records.back())
+            {
+                if (fread(&entry.first, sizeof(off_t), 1, f) != 1 ||
+                    fread(&entry.second.physical, sizeof(off_t), 1, f) != 1 ||
+                    fread(&entry.second.length, sizeof(size_t), 1, f) != 1)
+                {
+                    std::cerr << "Corrupted page table record at offset: " << record << std::endl;
+                    return -1;
+                }
+            }
+            if (prev == 0)
+                break;
+            record = prev;
+        }
+
+        table.clear();
+        space.chain = 0;
+        for (auto it = records.rbegin(); it != records.rend(); ++it)
+        {
+            for (const auto& entry : *it)
+            {
+                table[entry.first] = entry.second;
+            }
+            space.chain += it->size();
+        }
+
+        // ǰ汾Ŀҳ¼֮Ŀ϶Ǳȡľɸд
+        std::vector<page_t> used(space.records);
+        for (const auto& entry : table)
+        {
+            used.push_back(entry.second);
+        }
+        std::sort(used.begin(), used.end(),
+            [](const page_t& a, const page_t& b) { return a.physical < b.physical; });
+        space.gaps.clear();
+        off_t pos = OFFSET_COW_DATA;
+        for (const auto& extent : used)
+        {
+            if (extent.physical > pos)
+            {
+                space.gaps[pos] = static_cast<size_t>(extent.physical - pos);
+            }
+            pos = std::max(pos, extent.physical + static_cast<off_t>(extent.length));
+        }
+        if (header.end > pos)
+        {
+            space.gaps[pos] = static_cast<size_t>(header.end - pos);
+        }
+        return 0;
+    }
+
+    int bplus_tree::write_cow(FILE* f, cow_header_t& header, page_table_t& table, cow_space_t& space,
+        bool truncate, const pending_map_t& blocks, std::vector<page_t>& retired)
+    {
+        const page_table_t old_table = truncate ? page_table_t() : table;
+        meta_t meta = header.meta;
+        off_t pos = header.end != 0 ? header.end : OFFSET_COW_DATA;
+        if (truncate)
+        {
+            for (const auto& entry : table)
+            {
+                retired.push_back(entry.second);
+            }
+            table.clear();
+        }
+
+        // ļдʶ֮ٸĶ
+        unsigned long long magic = COW_MAGIC;
+        if (header.generation == 0 &&
+            (fseek(f, 0, SEEK_SET) != 0 || fwrite(&magic, sizeof(magic), 1, f) != 1))
+        {
+            return -1;
+        }
+
+        std::vector<off_t> written;
+        for (pending_map_t::const_iterator it = blocks.begin(); it != blocks.end(); ++it)
+        {
+            if (it->first == OFFSET_META)
+            {
+                memcpy(&meta, it->second.bytes.data(), std::min(sizeof(meta_t), it->second.bytes.size()));
+                continue;
+            }
+
+            // ֻĹڵͷĿ飬ƾɸٸдڵͷ
+            std::string image;
+            const std::string* bytes = &it->second.bytes;
+            if (!it->second.whole)
+            {
+                page_table_t::const_iterator old = old_table.find(it->first);
+                if (old == old_table.end())
+                {
+                    std::cerr << "No copy of block at offset: " << it->first << std::endl;
+                    return -1;
+                }
+                image.resize(old->second.length);
+                if (fseek(f, old->second.physical, SEEK_SET) != 0 ||
+                    (!image.empty() && fread(&image[0], image.size(), 1, f) != 1))
+                {
+                    std::cerr << "Failed to read block at offset: " << it->first << std::endl;
+                    return -1;
+                }
+                image.replace(0, std::min(image.size(), bytes->size()), *bytes);
+                bytes = &image;
+            }
+
+            // ¸д䣬ȡľɸȿն֮
+            page_t page;
+            page.length = bytes->size();
+            page.physical = allocate_extent(space.gaps, pos, page.length);
+            if (fseek(f, page.physical, SEEK_SET) != 0 ||
+                (!bytes->empty() && fwrite(bytes->data(), bytes->size(), 1, f) != 1))
+            {
+                std::cerr << "Failed to write block at offset: " << it->first << std::endl;
+                return -1;
+            }
+            page_table_t::iterator old = table.find(it->first);
+            if (old != table.end())
+            {
+                retired.push_back(old->second);
+            }
+            table[it->first] = page;
+            written.push_back(it->first);
+        }
+
+        // ¼ۼƳҳСʱдҳļʱҳ
+        bool full = truncate || space.chain + written.size() > table.size();
+        off_t prev = full ? 0 : header.table;
+        size_t count = full ? table.size() : written.size();
+        page_t extent;
+        extent.length = PAGE_RECORD_HEADER + count * PAGE_ENTRY_SIZE;
+        extent.physical = allocate_extent(space.gaps, pos, extent.length);
+        off_t record = extent.physical;
+        bool ok = fseek(f, record, SEEK_SET) == 0 &&
+            fwrite(&prev, sizeof(off_t), 1, f) == 1 &&
+            fwrite(&count, sizeof(size_t), 1, f) == 1;
+        if (full)
+        {
+            for (page_table_t::const_iterator it = table.begin(); ok && it != table.end(); ++it)
+            {
+                ok = write_page(f, it->first, it->second);
+            }
+        }
+        else
+        {
+            for (size_t i = 0; ok && i < written.size(); i++)
+            {
+                ok = write_page(f, written[i], table[written[i]]);
+            }
+        }
+        if (!ok)
+        {
+            std::cerr << "Failed to write page table" << std::endl;
+            return -1;
+        }
+        // ֮дļͷļͷдһʱɵǸȻЧ
+        fflush(f);
+#ifdef _WIN32
+        _commit(_fileno(f));
+#else
+        fsync(fileno(f));
+#endif
+
+        cow_header_t next = header;
+        next.magic = COW_MAGIC;
+        next.generation = header.generation + 1;
+        next.meta = meta;
+        next.table = record;
+        next.end = pos;
+        next.checksum = header_checksum(next);
+        if (fseek(f, OFFSET_COW_HEADER(next.generation), SEEK_SET) != 0 ||
+            fwrite(&next, sizeof(next), 1, f) != 1 || fflush(f) != 0)
+        {
+            std::cerr << "Failed to write copy-on-write header" << std::endl;
+            return -1;
+        }
+#ifdef _WIN32
+        _commit(_fileno(f));
+#else
+        fsync(fileno(f));
+#endif
+
+        header = next;
+        if (full)
+        {
+            // ҳ֮ǰļ¼ٱȡ
+            retired.insert(retired.end(), space.records.begin(), space.records.end());
+            space.records.clear();
+        }
+        space.records.push_back(extent);
+        space.chain = full ? count : space.chain + count;
+        return 0;
+    }
+
+    int bplus_tree::commit_cow()
+    {
+        int result = 0;
+        if (truncated || !pending.empty())
+        {
+            // رԼľво
+            close_tree_file();
+            {
+                // ն˵ľɸԱύд
+                std::lock_guard<std::mutex> lock(version_mutex);
+                for (const auto& extent : reclaimed)
+                {
+                    release_extent(cow_space.gaps, extent.physical, extent.length);
+                }
+                reclaimed.clear();
+            }
+            cow_header_t header = cow_header;
+            page_table_t table = *pages;
+            cow_space_t space = cow_space;
+            std::vector<page_t> superseded;
+            FILE* f = fopen(path, "rb+");
+            result = f ? write_cow(f, header, table, space, truncated, pending, superseded) : -1;
+            if (f)
+            {
+                fclose(f);
+            }
+
+            if (result == 0)
+            {
+                // ҳԪһ𻻵֮򿪵Ŀտͬһ汾
+                std::lock_guard<std::mutex> lock(version_mutex);
+                cow_header = header;
+                cow_space = std::move(space);
+                pages = std::make_shared<const page_table_t>(std::move(table));
+                published = cow_header.meta;
+                // ɸ;һдİ汾ǣ򿪵Ŀջ
+                for (const auto& extent : superseded)
+                {
+                    retired.insert(std::make_pair(version + 1, extent));
+                }
+            }
+        }
+
+        pending.clear();
+        truncated = false;
+        meta = cow_header.meta;
+        return result;
+    }
+
+    bool bplus_tree::find_page(off_t offset, page_t& page) const
+    {
+        page_table_t::const_iterator it = pages->find(offset);
+        if (it == pages->end())
+            return false;
+        page = it->second;
+        return true;
+    }
+
+    /* read n bytes from the serialized block, false when it is too short */
+    static bool take(const char*& p, const char* end, void* out, size_t n)
+    {
+        if (static_cast<size_t>(end - p) < n)
+            return false;
+        memcpy(out, p, n);
+        p += n;
+        return true;
+    }
+
+    int bplus_tree::parse_leaf(const std::string& bytes, leaf_node_t* leaf)
+    {
+        const char* p = bytes.data();
+        const char* end = p + bytes.size();
+        if (!take(p, end, &leaf->parent, sizeof(off_t)) ||
+            !take(p, end, &leaf->next, sizeof(off_t)) ||
+            !take(p, end, &leaf->prev, sizeof(off_t)) ||
+            !take(p, end, &leaf->n, sizeof(size_t)) ||
+            leaf->n > BP_ORDER)
+        {
+            return -1;
+        }
+        for (size_t i = 0; i < leaf->n; i++)
+        {
+            record_t& record = leaf->children[i];
+            size_t length;
+            record.value.clear();
+            if (!take(p, end, &record.key, sizeof(key_t)) ||
+                !take(p, end, &length, sizeof(size_t)) ||
+                length > static_cast<size_t>(end - p))
+            {
+                return -1;
+            }
+            if (length > 0)
+            {
+                record.value.data = new char[length];
+                record.value.size = length;
+                take(p, end, record.value.data, length);
+            }
+        }
+        return 0;
+    }
+
+    int bplus_tree::map_pending(void* block, off_t offset, size_t size) const
+    {
+        bool is_leaf = size == sizeof(leaf_node_t);
+        pending_map_t::const_iterator it = pending.find(offset);
+        if (it != pending.end() && it->second.whole)
+        {
+            const std::string& bytes = it->second.bytes;
+            if (!is_leaf)
+            {
+                // ҶӰ internal_node_t ȡʱֻõڵͷлҶӿܸ
+                size_t length = std::min(size, bytes.size());
+                memcpy(block, bytes.data(), length);
+                memset(static_cast<char*>(block) + length, 0, size - length);
+                return 0;
+            }
+
+            return parse_leaf(bytes, static_cast<leaf_node_t*>(block));
+        }
+
+        // дʱļԪڵǰļͷ
+        if (cow && offset == OFFSET_META)
+        {
+            memcpy(block, &cow_header.meta, std::min(size, sizeof(meta_t)));
+            return 0;
+        }
+
+        // չļûбĿ
+        if (truncated)
+            return -1;
+
+        if (!fp && fp_level == 0)
+        {
+            open_file();
+        }
+
+        // дʱļп¸ҶӰ internal_node_t ȡʱܱ
+        off_t position = offset;
+        size_t length = size;
+        if (cow)
+        {
+            page_t page;
+            if (!find_page(offset, page))
+                return -1;
+            position = page.physical;
+            length = is_leaf ? size : std::min(size, page.length);
+        }
+        if (!fp || fseek(fp, position, SEEK_SET) != 0)
+            return -1;
+
+        if (is_leaf)
+        {
+            if (read_leaf(fp, static_cast<leaf_node_t*>(block)) != 0)
+                return -1;
+        }
+        else if (fread(block, length, 1, fp) != 1)
+        {
+            return offset == OFFSET_META ? 1 : -1;
+        }
+        else
+        {
+            memset(static_cast<char*>(block) + length, 0, size - length);
+        }
+
+        // ֻдڵͷʱļеľɽڵͷ
+        if (it != pending.end())
+        {
+            memcpy(block, it->second.bytes.data(), std::min(size, it->second.bytes.size()));
+        }
+        return 0;
+    }
+
+    int bplus_tree::unmap_pending(void* block, off_t offset, size_t size) const
+    {
+        std::string bytes;
+        if (size == sizeof(leaf_node_t))
+        {
+            const leaf_node_t* leaf = static_cast<const leaf_node_t*>(block);
+            bytes.append(reinterpret_cast<const char*>(&leaf->parent), sizeof(off_t));
+            bytes.append(reinterpret_cast<const char*>(&leaf->next), sizeof(off_t));
+            bytes.append(reinterpret_cast<const char*>(&leaf->prev), sizeof(off_t));
+            bytes.append(reinterpret_cast<const char*>(&leaf->n), sizeof(size_t));
+            for (size_t i = 0; i < leaf->n; i++)
+            {
+                const record_t& record = leaf->children[i];
+                size_t length = record.value.data ? record.value.size : 0;
+                bytes.append(reinterpret_cast<const char*>(&record.key), sizeof(key_t));
+                bytes.append(reinterpret_cast<const char*>(&length), sizeof(size_t));
+                bytes.append(record.value.data ? record.value.data : "", length);
+            }
+        }
+        else
+        {
+            bytes.assign(static_cast<const char*>(block), size);
+        }
+
+        pending_block_t& entry = pending[offset];
+        if (size != SIZE_NO_CHILDREN)
+        {
+            entry.bytes.swap(bytes);
+            entry.whole = true;
+        }
+        else if (entry.bytes.size() > bytes.size())
+        {
+            entry.bytes.replace(0, bytes.size(), bytes);
+        }
+        else
+        {
+            entry.bytes.swap(bytes);
+        }
+        return 0;
+    }
 
-                    merge_leafs(&prev, &leaf);
-                    node_remove(&prev, &leaf);
-                    unmap(&prev, leaf.prev);
-                }
-                else
-                {
-                    // else merge | leaf | next |
-                    assert(leaf.next != 0);
-                    leaf_node_t next;
-                    map(&next, leaf.next);
-                    index_key = begin(leaf)->key;
+    int bplus_tree::publish()
+    {
+        int result = 0;
+        if (cow && !transaction && commit_cow() != 0)
+        {
+            std::cerr << "Failed to commit copy-on-write blocks, changes discarded: " << path << std::endl;
+            result = -1;
+        }
 
-                    merge_leafs(&leaf, &next);
-                    node_remove(&leaf, &next);
-                    unmap(&leaf, offset);
-                }
+        std::lock_guard<std::mutex> lock(version_mutex);
+        published = meta;
+        ++version;
+        unpreserved = false;
+        if (active.empty())
+        {
+            collect_versions();
+        }
+        published_cv.notify_all();
+        return result;
+    }
 
-                // remove parent's key
-                remove_from_index(parent_off, parent, index_key);
-            }
-            else
+    std::shared_ptr<const snapshot_t> bplus_tree::open_snapshot() const
+    {
+        std::unique_lock<std::mutex> lock(version_mutex);
+        published_cv.wait(lock, [this]() { return !unpreserved; });
+        snapshot_t* snapshot = new snapshot_t;
+        snapshot->version = version;
+        snapshot->meta = published;
+        if (cow)
+        {
+            snapshot->pages = pages;
+        }
+        active.insert(std::make_pair(version, published.slot));
+        return std::shared_ptr<const snapshot_t>(snapshot, [this](const snapshot_t* s)
             {
-                unmap(&leaf, offset);
-            }
+                release_snapshot(s->version);
+                delete s;
+            });
+    }
+
+    meta_t bplus_tree::get_published_meta() const
+    {
+        std::lock_guard<std::mutex> lock(version_mutex);
+        return published;
+    }
+
+    bool bplus_tree::keep_for_snapshots() const
+    {
+        std::lock_guard<std::mutex> lock(version_mutex);
+        if (active.empty())
+        {
+            // ļֱӽضϣ֮򿪵Ŀյθд
+            // ضʱռύʱĿ¼ռʵϲпڵ
+            unpreserved = true;
+            return false;
         }
-        else
+        return true;
+    }
+
+    size_t bplus_tree::version_count() const
+    {
+        std::lock_guard<std::mutex> lock(version_mutex);
+        size_t count = 0;
+        for (const auto& images : versions)
         {
-            unmap(&leaf, offset);
+            count += images.second.size();
         }
+        return count;
+    }
 
-        return 0;
+    void bplus_tree::release_snapshot(unsigned long long snapshot) const
+    {
+        std::lock_guard<std::mutex> lock(version_mutex);
+        active.erase(active.find(snapshot));
+        collect_versions();
     }
 
-    int bplus_tree::insert(const key_t& key, value_t value)
+    void bplus_tree::collect_versions() const
     {
-        open_file("rb+");
-        if (!fp)
+        // 汾ϿյľҲᱻûпʱֻ
+        // дİ汾ݣ֮򿪵ĿջҪõ
+        unsigned long long oldest = active.empty() ? version : active.begin()->first;
+        for (auto it = versions.begin(); it != versions.end();)
         {
-            std::cerr << "Failed to open file" << std::endl;
-            return -1;
+            it->second.erase(it->second.begin(), it->second.upper_bound(oldest));
+            it = it->second.empty() ? versions.erase(it) : std::next(it);
         }
 
-        try
+        // дʱļбȡľɸͬһύд
+        auto last = retired.upper_bound(oldest);
+        for (auto it = retired.begin(); it != last; ++it)
         {
-            // ȡԪ
-            if (map(&meta, OFFSET_META) != 0)
-            {
-                std::cerr << "Failed to read meta data" << std::endl;
-                close_file();
-                return -1;
-            }
+            reclaimed.push_back(it->second);
+        }
+        retired.erase(retired.begin(), last);
+    }
 
-            std::cout << "Current tree meta - height: " << meta.height
-                << ", leaf_num: " << meta.leaf_node_num
-                << ", internal_num: " << meta.internal_node_num << std::endl;
+    void bplus_tree::preserve(FILE* f, off_t offset) const
+    {
+        std::lock_guard<std::mutex> lock(version_mutex);
+        if (offset == OFFSET_META)
+            return;
 
-            off_t parent = search_index(key);
-            std::cout << "Found parent node at offset: " << parent << std::endl;
+        // ûпʱҲ棺дڼ򿪵Ŀնϴηİ汾д뷢
+        // 򿪵Ŀպ֮򿪵Ŀնϴη֮Ŀ
+        off_t reachable = published.slot;
+        for (const auto& snapshot : active)
+        {
+            reachable = std::max(reachable, snapshot.second);
+        }
+        if (offset >= reachable)
+            return;
 
-            off_t offset = search_leaf(parent, key);
-            std::cout << "Found leaf node at offset: " << offset << std::endl;
+        // ÿ汾ֻһθд֮ǰ
+        std::string& image = versions[offset][version + 1];
+        if (!image.empty())
+            return;
 
-            leaf_node_t leaf;
-            if (map(&leaf, offset) != 0)
-            {
-                std::cerr << "Failed to read leaf node" << std::endl;
-                close_file();
-                return -1;
-            }
+        image.resize(leaf_block_size());
+        size_t rd = 0;
+        if (fseek(f, offset, SEEK_SET) == 0)
+        {
+            rd = fread(&image[0], 1, image.size(), f);
+        }
+        image.resize(rd);
+    }
 
-            std::cout << "Leaf node info - n: " << leaf.n
-                << ", parent: " << leaf.parent
-                << ", next: " << leaf.next
-                << ", prev: " << leaf.prev << std::endl;
+    bool bplus_tree::find_version(off_t offset, unsigned long long snapshot, std::string& image) const
+    {
+        std::lock_guard<std::mutex> lock(version_mutex);
+        auto it = versions.find(offset);
+        if (it == versions.end())
+            return false;
+
+        // ֮һθд֮ǰ
+        auto image_it = it->second.upper_bound(snapshot);
+        if (image_it == it->second.end())
+            return false;
+        image = image_it->second;
+        return true;
+    }
 
-            // ǷѴͬļ
-            if (binary_search(begin(leaf), end(leaf), key))
-            {
-                std::cout << "Found existing key " << key.k << " in leaf node" << std::endl;
-                std::cout << "Current records in leaf:" << std::endl;
-                for (size_t i = 0; i < leaf.n; i++)
-                {
-                    std::cout << "  Record " << i << " - Key: " << leaf.children[i].key.k
-                        << ", Value size: " << leaf.children[i].value.size << std::endl;
+    snapshot_reader::snapshot_reader(const bplus_tree* tree, std::shared_ptr<const snapshot_t> snapshot,
+        bool own_writes)
+        : tree(tree), snapshot(snapshot ? snapshot : tree->open_snapshot()),
+        through_tree(own_writes && tree->in_transaction()), f(nullptr)
+    {
+        if (!through_tree)
+        {
+#ifdef _WIN32
+            fopen_s(&f, tree->get_path(), "rb");
+#else
+            f = fopen(tree->get_path(), "rb");
+#endif
+        }
+    }
 
-                    // ȫؼֵ
-                    if (leaf.children[i].value.size > 0)
-                    {
-                        std::cout << "    Value size: " << leaf.children[i].value.size << std::endl;
+    snapshot_reader::~snapshot_reader()
+    {
+        if (f)
+        {
+            fclose(f);
+        }
+    }
 
-                        // ڴ沢ȡֵ
-                        try
-                        {
-                            value_t temp_value;
-                            temp_value.size = leaf.children[i].value.size;
-                            temp_value.data = new char[temp_value.size];
-
-                            // ļжȡֵ
-                            if (fseek(fp, offset + sizeof(leaf_node_t) - BP_ORDER * sizeof(record_t) + i * sizeof(record_t) + offsetof(record_t, value), SEEK_SET) == 0)
-                            {
-                                if (fread(temp_value.data, temp_value.size, 1, fp) == 1)
-                                {
-                                    std::cout << "    First few bytes: ";
-                                    for (size_t j = 0; j < std::min(temp_value.size, size_t(8)); j++)
-                                    {
-                                        std::cout << std::hex << std::setw(2) << std::setfill('0')
-                                            << static_cast<int>(static_cast<unsigned char>(temp_value.data[j]))
-                                            << " ";
-                                    }
-                                    std::cout << std::dec << std::endl;
-                                }
-                            }
-
-                            delete[] temp_value.data;
-                        }
-                        catch (const std::exception& e)
-                        {
-                            std::cerr << "Error reading value data: " << e.what() << std::endl;
-                        }
-                    }
-                }
-                close_file();
-                return 1;
-            }
+    bool snapshot_reader::read_block(void* block, off_t offset, size_t size)
+    {
+        if (snapshot->pages)
+            return read_page(block, offset, size);
 
-            // ǷҪ
-            if (leaf.n >= meta.order)
-            {
-                std::cout << "Need to split leaf node" << std::endl;
+        std::string image;
+        if (!tree->find_version(offset, snapshot->version, image))
+        {
+            bool ok = f && fseek(f, offset, SEEK_SET) == 0 && fread(block, size, 1, f) == 1;
+            // ļڼ鱻дʱдǰѾڰ汾洢
+            if (!tree->find_version(offset, snapshot->version, image))
+                return ok;
+        }
+        size_t length = std::min(size, image.size());
+        memcpy(block, image.data(), length);
+        memset(static_cast<char*>(block) + length, 0, size - length);
+        return true;
+    }
+
+    bool snapshot_reader::read_leaf(leaf_node_t* leaf, off_t offset)
+    {
+        if (through_tree)
+            return tree->read_leaf_node(leaf, offset);
 
-                // µҶӽڵ
-                leaf_node_t new_leaf;
-                node_create(offset, &leaf, &new_leaf);
+        if (snapshot->pages)
+        {
+            page_table_t::const_iterator page = snapshot->pages->find(offset);
+            return page != snapshot->pages->end() && f &&
+                bplus_tree::read_leaf_node(f, leaf, page->second.physical);
+        }
 
-                std::cout << "Created new leaf node - next: " << new_leaf.next
-                    << ", prev: " << new_leaf.prev << std::endl;
+        std::string image;
+        if (!tree->find_version(offset, snapshot->version, image))
+        {
+            bool ok = f && bplus_tree::read_leaf_node(f, leaf, offset);
+            if (!tree->find_version(offset, snapshot->version, image))
+                return ok;
+        }
+        return bplus_tree::parse_leaf(image, leaf) == 0;
+    }
 
-                // ҵѵ
-                size_t point = leaf.n / 2;
-                bool place_right = keycmp(key, leaf.children[point].key) > 0;
-                if (place_right)
-                    ++point;
+    bool snapshot_reader::read_next(off_t offset, off_t* next)
+    {
+        internal_node_t node;
+        bool ok = through_tree ?
+            tree->map(&node, offset, SIZE_NO_CHILDREN) == 0 :
+            read_block(&node, offset, SIZE_NO_CHILDREN);
+        *next = node.next;
+        return ok;
+    }
 
-                std::cout << "Split point: " << point
-                    << ", place_right: " << place_right << std::endl;
+    bool snapshot_reader::read_page(void* block, off_t offset, size_t size)
+    {
+        page_table_t::const_iterator page = snapshot->pages->find(offset);
+        if (page == snapshot->pages->end() || !f)
+            return false;
+
+        size_t length = std::min(size, page->second.length);
+        if (fseek(f, page->second.physical, SEEK_SET) != 0 || fread(block, length, 1, f) != 1)
+            return false;
+        memset(static_cast<char*>(block) + length, 0, size - length);
+        return true;
+    }
 
-                // ѽڵ
-                for (size_t i = point; i < leaf.n; i++)
-                {
-                    // 
-                    new_leaf.children[i - point].key = leaf.children[i].key;
-                    new_leaf.children[i - point].value.clear();
-                    if (leaf.children[i].value.data && leaf.children[i].value.size > 0)
-                    {
-                        new_leaf.children[i - point].value.size = leaf.children[i].value.size;
-                        new_leaf.children[i - point].value.data = new char[leaf.children[i].value.size];
-                        std::memcpy(new_leaf.children[i - point].value.data,
-                            leaf.children[i].value.data,
-                            leaf.children[i].value.size);
-                    }
-                }
-                new_leaf.n = leaf.n - point;
-                leaf.n = point;
+    off_t snapshot_reader::find_leaf(const key_t& key)
+    {
+        off_t org = snapshot->meta.root_offset;
+        size_t height = snapshot->meta.height;
+        while (height > 0)
+        {
+            internal_node_t node;
+            if (!read_block(&node, org, sizeof(internal_node_t)) || node.n == 0)
+                return 0;
+            org = find(node, key)->child;
+            --height;
+        }
+        return org;
+    }
 
-                std::cout << "After split - old leaf n: " << leaf.n
-                    << ", new leaf n: " << new_leaf.n << std::endl;
+    int snapshot_reader::search_batch(const std::vector<key_t>& keys,
+        const std::function<void(size_t, const value_t&)>& callback)
+    {
+        if (through_tree)
+        {
+            if (!tree->open_tree_file("rb+"))
+                return -1;
+            int reads = tree->search_batch(keys, callback);
+            tree->close_tree_file();
+            return reads;
+        }
 
-                // ¼¼
-                if (place_right)
-                {
-                    std::cout << "Inserting into new leaf" << std::endl;
-                    insert_record_no_split(&new_leaf, key, value);
-                }
-                else
-                {
-                    std::cout << "Inserting into old leaf" << std::endl;
-                    insert_record_no_split(&leaf, key, value);
-                }
+        leaf_node_t leaf;
+        off_t current = 0;
+        int reads = 0;
 
-                // ڵ
-                if (unmap(&leaf, offset) != 0)
-                {
-                    std::cerr << "Failed to save old leaf" << std::endl;
-                }
-                if (unmap(&new_leaf, leaf.next) != 0)
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            //  bplus_tree::search_batch ͬڵǰҶϵļٴӸ½
+            if (current == 0 || leaf.n == 0 || keycmp(keys[i], leaf.children[leaf.n - 1].key) > 0)
+            {
+                off_t offset = find_leaf(keys[i]);
+                if (offset == 0)
                 {
-                    std::cerr << "Failed to save new leaf" << std::endl;
+                    std::cerr << "Failed to read index node" << std::endl;
+                    return -1;
                 }
-
-                // 
-                std::cout << "Updating index with key: " << new_leaf.children[0].key.k << std::endl;
-                insert_key_to_index(parent, new_leaf.children[0].key,
-                    offset, leaf.next);
-            }
-            else
-            {
-                std::cout << "Direct insert without split" << std::endl;
-                insert_record_no_split(&leaf, key, value);
-                if (unmap(&leaf, offset) != 0)
+                if (offset != current)
                 {
-                    std::cerr << "Failed to save leaf node" << std::endl;
+                    if (!read_leaf(&leaf, offset))
+                    {
+                        std::cerr << "Failed to read leaf node" << std::endl;
+                        return -1;
+                    }
+                    current = offset;
+                    reads++;
                 }
             }
 
-            close_file();
-            return 0;
-        }
-        catch (const std::exception& e)
-        {
-            std::cerr << "Exception during insert: " << e.what() << std::endl;
-            if (fp_level > 0)
+            record_t* record = find(leaf, keys[i]);
+            if (record != leaf.children + leaf.n && keycmp(record->key, keys[i]) == 0)
             {
-                close_file();
+                callback(i, record->value);
             }
-            throw;
         }
+        return reads;
     }
 
-    int bplus_tree::update(const key_t& key, value_t value)
+    off_t snapshot_reader::last_leaf()
     {
-        off_t offset = search_leaf(key);
-        leaf_node_t leaf;
-        map(&leaf, offset);
-
-        record_t* record = find(leaf, key);
-        if (record != leaf.children + leaf.n)
-            if (keycmp(key, record->key) == 0)
-            {
-                record->value = value;
-                unmap(&leaf, offset);
+        if (through_tree)
+            return tree->get_last_leaf();
 
+        off_t org = snapshot->meta.root_offset;
+        size_t height = snapshot->meta.height;
+        while (height > 0)
+        {
+            internal_node_t node;
+            if (!read_block(&node, org, sizeof(internal_node_t)) || node.n == 0)
                 return 0;
-            }
-            else
-            {
-                return 1;
-            }
-        else
-            return -1;
+            org = node.children[node.n - 1].child;
+            --height;
+        }
+        return org;
     }
 
     void bplus_tree::remove_from_index(off_t offset, internal_node_t& node,
@@ -503,13 +2097,21 @@ namespace bpt
         // remove key
         key_t index_key = begin(node)->key;
         index_t* to_delete = find(node, key);
-        if (to_delete != end(node))
+        if (to_delete != end(node) - 1)
         {
             (to_delete + 1)->child = to_delete->child;
             std::copy(to_delete + 1, end(node), to_delete);
         }
         node.n--;
 
+        rebalance_index(offset, node, index_key);
+    }
+
+    void bplus_tree::rebalance_index(off_t offset, internal_node_t& node,
+        const key_t& index_key)
+    {
+        size_t min_n = meta.root_offset == offset ? 1 : meta.order / 2;
+
         // remove to only one key
         if (node.n == 1 && meta.root_offset == offset &&
             meta.internal_node_num != 1)
@@ -518,6 +2120,12 @@ namespace bpt
             meta.height--;
             meta.root_offset = node.children[0].child;
             unmap(&meta, OFFSET_META);
+
+            /* insert_key_to_index tells the root by its zero parent */
+            internal_node_t root;
+            map(&root, meta.root_offset);
+            root.parent = 0;
+            unmap(&root, meta.root_offset);
             return;
         }
 
@@ -595,6 +2203,7 @@ namespace bpt
         if (lender.n != meta.order / 2)
         {
             child_t where_to_lend, where_to_put;
+            key_t separator; /* key of the entry lent from the left */
 
             internal_node_t parent;
 
@@ -604,9 +2213,13 @@ namespace bpt
                 where_to_lend = begin(lender);
                 where_to_put = end(borrower);
 
+                /* borrower's last key is unused, look its entry up by offset;
+                 * the old separator moves down, the lent key moves up */
                 map(&parent, borrower.parent);
-                child_t where = lower_bound(begin(parent), end(parent) - 1,
-                    (end(borrower) - 1)->key);
+                child_t where = begin(parent);
+                while (where->child != offset)
+                    ++where;
+                (end(borrower) - 1)->key = where->key;
                 where->key = where_to_lend->key;
                 unmap(&parent, borrower.parent);
             }
@@ -617,7 +2230,7 @@ namespace bpt
 
                 map(&parent, lender.parent);
                 child_t where = find(parent, begin(lender)->key);
-                where_to_put->key = where->key;
+                separator = where->key;
                 where->key = (where_to_lend - 1)->key;
                 unmap(&parent, lender.parent);
             }
@@ -625,6 +2238,8 @@ namespace bpt
             // store
             std::copy_backward(where_to_put, end(borrower), end(borrower) + 1);
             *where_to_put = *where_to_lend;
+            if (!from_right)
+                where_to_put->key = separator;
             borrower.n++;
 
             // erase
@@ -644,8 +2259,9 @@ namespace bpt
         leaf_node_t lender;
         map(&lender, lender_off);
 
-        assert(lender.n >= meta.order / 2);
-        if (lender.n != meta.order / 2)
+        /* remove_range repairs leaves one by one, a sibling still below
+         * half full simply does not lend */
+        if (lender.n > meta.order / 2)
         {
             typename leaf_node_t::child_t where_to_lend, where_to_put;
 
@@ -706,8 +2322,9 @@ namespace bpt
     void bplus_tree::merge_keys(index_t* where,
         internal_node_t& node, internal_node_t& next)
     {
-        //(end(node) - 1)->key = where->key;
-        // where->key = (end(next) - 1)->key;
+        /* the last key of node was unused, it becomes the separator
+         * between node and next that the parent is about to drop */
+        (end(node) - 1)->key = where->key;
         std::copy(begin(next), end(next), end(node));
         node.n += next.n;
         node_remove(&node, &next);
@@ -991,12 +2608,117 @@ namespace bpt
         unmap(&meta, OFFSET_META);
     }
 
-    void bplus_tree::init_from_empty()
+    int bplus_tree::read_leaf(FILE* f, leaf_node_t* leaf)
+    {
+        // ȡϢ
+        if (fread(&leaf->parent, sizeof(off_t), 1, f) != 1 ||
+            fread(&leaf->next, sizeof(off_t), 1, f) != 1 ||
+            fread(&leaf->prev, sizeof(off_t), 1, f) != 1 ||
+            fread(&leaf->n, sizeof(size_t), 1, f) != 1)
+        {
+            return -1;
+        }
+
+        if (leaf->n > BP_ORDER)
+        {
+            return -1;
+        }
+
+        // ȡÿ¼
+        for (size_t i = 0; i < leaf->n; i++)
+        {
+            if (!leaf->children[i].deserialize(f))
+            {
+                return -1;
+            }
+        }
+
+        return 0;
+    }
+
+    bool bplus_tree::read_leaf_node(FILE* f, leaf_node_t* leaf, off_t offset)
+    {
+        if (!f || !leaf || fseek(f, offset, SEEK_SET) != 0)
+        {
+            return false;
+        }
+        return read_leaf(f, leaf) == 0;
+    }
+
+    off_t bplus_tree::get_last_leaf() const
+    {
+        std::lock_guard<std::recursive_mutex> lock(file_mutex);
+        off_t org = meta.root_offset;
+        int height = meta.height;
+        while (height > 0)
+        {
+            internal_node_t node;
+            if (map(&node, org) != 0 || node.n == 0)
+                return 0;
+            org = node.children[node.n - 1].child;
+            --height;
+        }
+        return org;
+    }
+
+    bool bplus_tree::collect_leaf_offsets(std::vector<off_t>& offsets) const
+    {
+        std::lock_guard<std::recursive_mutex> lock(file_mutex);
+        offsets.clear();
+
+        open_file("rb+");
+        if (!fp)
+        {
+            std::cerr << "Failed to open file" << std::endl;
+            return false;
+        }
+
+        // ֻȡ parent/next/prev/nл¼
+        off_t current = meta.leaf_offset;
+        while (current != 0)
+        {
+            off_t header[3];
+            size_t n;
+            bool ok;
+            if (buffered())
+            {
+                // иĹҶֻڴУдʱļҪҳ
+                internal_node_t node;
+                ok = map(&node, current, SIZE_NO_CHILDREN) == 0;
+                header[1] = node.next;
+            }
+            else
+            {
+                ok = fseek(fp, current, SEEK_SET) == 0 &&
+                    fread(header, sizeof(off_t), 3, fp) == 3 &&
+                    fread(&n, sizeof(size_t), 1, fp) == 1;
+            }
+            if (!ok)
+            {
+                std::cerr << "Failed to read leaf header at offset: " << current << std::endl;
+                close_file();
+                return false;
+            }
+
+            if (offsets.size() >= meta.leaf_node_num)
+            {
+                std::cerr << "Leaf chain longer than leaf_node_num, stop collecting" << std::endl;
+                break;
+            }
+            offsets.push_back(current);
+            current = header[1];
+        }
+
+        close_file();
+        return true;
+    }
+
+    void bplus_tree::init_from_empty(size_t value_size)
     {
-        // init default meta
+        // init default meta, value_size before alloc: it sizes the leaf block
         memset(&meta, 0, sizeof(meta_t));
         meta.order = BP_ORDER;
-        meta.value_size = sizeof(value_t);
+        meta.value_size = value_size;
         meta.key_size = sizeof(key_t);
         meta.height = 1;
         meta.slot = OFFSET_BLOCK;
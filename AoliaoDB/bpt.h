@@ -10,6 +10,13 @@
 #include <cstddef>
 #include "predefined.h"
 #include <iostream>
+#include <vector>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <string>
 #include <direct.h> // for _mkdir
 #include <io.h>
 
@@ -188,20 +195,211 @@ namespace bpt
         record_t children[BP_ORDER];
     };
 
+    /* a block written inside a transaction: whole blocks replace the
+     * file content, header-only writes (SIZE_NO_CHILDREN bytes) patch
+     * the first bytes of the block on disk */
+    struct pending_block_t
+    {
+        std::string bytes;
+        bool whole;
+    };
+
+    typedef std::map<off_t, pending_block_t> pending_map_t;
+
+    /* copy-on-write files never overwrite a block the current version
+     * reads: every commit writes the blocks and a page table record into
+     * unused extents (or appends them), then switches to them by writing
+     * the header page not used by the previous commit. the valid header
+     * with the larger generation is the current one */
+#define COW_MAGIC 0x4554495257574f43ULL /* "COWWRITE" */
+#define COW_HEADER_SIZE 4096
+    /* the first page only holds COW_MAGIC, written once when the file
+     * is created; meta.order of an in-place file is never that value */
+#define OFFSET_COW_HEADER(generation) ((1 + (generation) % 2) * COW_HEADER_SIZE)
+#define OFFSET_COW_DATA (3 * COW_HEADER_SIZE)
+
+    struct cow_header_t
+    {
+        unsigned long long magic;
+        unsigned long long generation;
+        meta_t meta;
+        off_t table;                  /* last page table record */
+        off_t end;                    /* end of the data, next commit appends here */
+        unsigned long long checksum;  /* of the bytes above */
+    };
+
+    /* where the latest copy of a block lives in a copy-on-write file */
+    struct page_t
+    {
+        off_t physical;
+        size_t length;
+    };
+
+    /* block offset (as allocated by alloc) -> its latest copy */
+    typedef std::map<off_t, page_t> page_table_t;
+
+    /* the parts of a copy-on-write file outside the blocks of the
+     * current version: the page table records the current header still
+     * reads, and the extents no version can reach. commits write into
+     * the gaps before appending, so the file stops growing once
+     * superseded copies are reclaimed */
+    struct cow_space_t
+    {
+        size_t chain;                   /* entries in the page table records since the last full one */
+        std::vector<page_t> records;    /* where those records are */
+        std::map<off_t, size_t> gaps;   /* physical offset -> length */
+
+        cow_space_t() : chain(0)
+        {
+        }
+    };
+
+    /* a read view of the tree as of one published version. blocks
+     * overwritten after it was taken are found in the tree's version
+     * store, so a reader with its own file handle never waits for a
+     * writer; see snapshot_reader */
+    struct snapshot_t
+    {
+        unsigned long long version;
+        meta_t meta;
+        /* copy-on-write trees: the page table of the version, the
+         * blocks it points to are never overwritten */
+        std::shared_ptr<const page_table_t> pages;
+    };
+
+    class snapshot_reader;
+
     /* the encapulated B+ tree */
     class bplus_tree
     {
     public:
-        bplus_tree(const char* path, bool force_empty = false);
+        /* value_size is the largest value stored in this tree,
+         * leaf blocks are sized to hold BP_ORDER such records.
+         * copy_on_write only applies to a new file, an existing file
+         * keeps the mode it was created with */
+        bplus_tree(const char* path, bool force_empty = false, size_t value_size = 0,
+            bool copy_on_write = false);
 
         /* abstract operations */
         int search(const key_t& key, value_t* value) const;
         int search_range(key_t* left, const key_t& right,
             value_t* values, size_t max, bool* next = NULL) const;
+        /* search keys sorted by keycmp, keys falling into the same leaf
+         * share one leaf read, callback(key index, value) for each hit.
+         * return the number of leaves read, -1 on error */
+        int search_batch(const std::vector<key_t>& keys,
+            const std::function<void(size_t, const value_t&)>& callback) const;
         int remove(const key_t& key);
         int insert(const key_t& key, value_t value);
+        /* insert, or when the key exists rewrite its record in place in
+         * the same descent: replace(old value) returns true after
+         * changing it, a null replace stores `value`.
+         * return 0 when inserted, 1 when the key existed, -1 on error */
+        int upsert(const key_t& key, value_t value,
+            const std::function<bool(value_t&)>& replace = nullptr);
+        /* insert keys sorted by keycmp, the i-th value starts at data + i * size
+         * and is `size` bytes long, or lengths[i] bytes when lengths is given.
+         * the file is opened once and synced once at the end.
+         * return 0 on success, 1 when a key already exists, -1 on error */
+        int insert_batch(const std::vector<key_t>& keys, const char* data, size_t size,
+            const size_t* lengths = NULL);
+        /* build an empty tree bottom-up from keys sorted by keycmp, values
+         * laid out as in insert_batch. leaves and index nodes are filled
+         * evenly and written once. return 0 on success, 1 when the tree is
+         * not empty, -1 on error */
+        int bulk_load(const std::vector<key_t>& keys, const char* data, size_t size,
+            const size_t* lengths = NULL);
         int update(const key_t& key, value_t value);
 
+        /* walk the leaf chain once, visit(key, value) may rewrite the value
+         * (never the key) and returns true when it did. a leaf is written
+         * back once if any of its records changed, the file is synced once.
+         * return the number of changed records, -1 on error */
+        int update_scan(const std::function<bool(const key_t&, value_t&)>& visit);
+
+        /* walk the leaf chain once and remove the records for which
+         * match(key, value) is true. records are removed in place as long
+         * as the leaf stays at least half full, so such a leaf is written
+         * once and the index is untouched; the matches beyond that go
+         * through remove() after the walk to borrow or merge.
+         * return the number of removed records, -1 on error */
+        int remove_scan(const std::function<bool(const key_t&, const value_t&)>& match);
+
+        /* remove the records with left <= key <= right for which
+         * match(key, value) is true, a NULL bound is open. every leaf in
+         * the range is filtered in place and written once; afterwards the
+         * leaves left empty are detached from the chain and the index and
+         * the ones below half full borrow or merge as in remove(), so kept
+         * records never leave the tree. the file is synced once.
+         * return the number of removed records, -1 on error */
+        int remove_range(const key_t* left, const key_t* right,
+            const std::function<bool(const key_t&, const value_t&)>& match);
+
+        /* drop every record and reset the file to an empty tree, the
+         * old blocks are released by truncating the file.
+         * return 0 on success, -1 on error */
+        int truncate();
+
+        /* between begin_transaction and apply_pending / rollback every
+         * written block stays in memory and later reads see it, the file
+         * is not touched. apply_pending writes the blocks and syncs the
+         * file once, rollback drops them and reloads meta from the file.
+         * return 0 on success, -1 on error */
+        void begin_transaction();
+        int apply_pending();
+        void rollback();
+
+        bool in_transaction() const
+        {
+            return transaction;
+        }
+
+        // дĿ飬ύʱд־
+        const pending_map_t& pending_blocks() const
+        {
+            return pending;
+        }
+
+        // ִй truncateύʱļ
+        bool pending_truncate() const
+        {
+            return truncated;
+        }
+
+        // дʱģʽ鲻ԭظдύʱ׷ӵļĩβ
+        bool copy_on_write() const
+        {
+            return cow;
+        }
+
+        /* multi-version reads: writes made after the last publish belong
+         * to the next version. before such a write overwrites a block
+         * that an open snapshot can still reach, the old image is kept
+         * in memory, tagged with the writing version. an image is
+         * dropped once no open snapshot is older than its version.
+         * images are kept for every block below the published slot even
+         * with no snapshot open, so a snapshot opened during a write reads
+         * the last published version without waiting for the write.
+         * publish makes the current tree visible to new snapshots.
+         * only a whole-file rewrite (truncate) with no snapshot open keeps
+         * no images; a snapshot opened after it waits for the publish.
+         * a copy-on-write tree keeps the writes in memory until publish
+         * (or apply_pending in a transaction) commits them; when that
+         * fails they are dropped. return 0 on success, -1 on error */
+        int publish();
+        std::shared_ptr<const snapshot_t> open_snapshot() const;
+        // İ汾ԪݣбĲѯƱĴС
+        meta_t get_published_meta() const;
+
+        // 汾洢еĿԺͳ
+        size_t version_count() const;
+
+        /* write blocks to the file at path and sync once, the file is
+         * emptied first when truncate is set. used by apply_pending and
+         * by the commit log replay, a copy-on-write file gets them as
+         * a new commit. return 0 on success, -1 on error */
+        static int write_blocks(const char* path, bool truncate, const pending_map_t& blocks);
+
         meta_t get_meta() const
         {
             return meta;
@@ -216,12 +414,29 @@ namespace bpt
         // ȡҶӽڵ
         bool read_leaf_node(leaf_node_t* leaf, off_t offset) const
         {
+            std::lock_guard<std::recursive_mutex> lock(file_mutex);
             return map(leaf, offset) == 0;
         }
 
+        // ȡһҶӽڵƫ·½
+        off_t get_last_leaf() const;
+
+        // ʹõ÷ԼļȡҶӽڵ㣬ɨĹ߳ʹ
+        static bool read_leaf_node(FILE* f, leaf_node_t* leaf, off_t offset);
+
+        // ҶռҶӽڵƫֻȡڵͷ
+        bool collect_leaf_offsets(std::vector<off_t>& offsets) const;
+
+        // ȡļ·
+        const char* get_path() const
+        {
+            return path;
+        }
+
         // ļǷɹ
         bool open_tree_file(const char* mode = "rb+") const
         {
+            std::lock_guard<std::recursive_mutex> lock(file_mutex);
             open_file(mode);
             return fp != nullptr;
         }
@@ -229,6 +444,7 @@ namespace bpt
         // رļ
         void close_tree_file() const
         {
+            std::lock_guard<std::recursive_mutex> lock(file_mutex);
             if (fp)
             {
                 fflush(fp);
@@ -256,8 +472,8 @@ namespace bpt
         char path[512];
         meta_t meta;
 
-        /* init empty tree */
-        void init_from_empty();
+        /* init empty tree whose leaves hold values of up to value_size bytes */
+        void init_from_empty(size_t value_size);
 
         /* find index */
         off_t search_index(const key_t& key) const;
@@ -273,6 +489,21 @@ namespace bpt
         void remove_from_index(off_t offset, internal_node_t& node,
             const key_t& key);
 
+        /* borrow or merge after node lost a child, index_key is the first
+         * key node had before that */
+        void rebalance_index(off_t offset, internal_node_t& node,
+            const key_t& index_key);
+
+        /* unlink a leaf from the leaf chain and drop its parent entry */
+        void detach_leaf(off_t offset, leaf_node_t& leaf);
+
+        /* a leaf below half full borrows from a sibling under the same
+         * parent or merges with one, `where` is its entry in `parent`.
+         * return the offset of the leaf freed by the merge, 0 when it
+         * borrowed */
+        off_t rebalance_leaf(off_t parent_off, internal_node_t& parent,
+            index_t* where, off_t offset, leaf_node_t& leaf);
+
         /* borrow one key from other internal node */
         bool borrow_key(bool from_right, internal_node_t& borrower,
             off_t offset);
@@ -289,6 +520,10 @@ namespace bpt
         void merge_keys(index_t* where, internal_node_t& left,
             internal_node_t& right);
 
+        /* split a full leaf and insert, then update the parent index */
+        void insert_record_split(off_t parent, off_t offset,
+            leaf_node_t& leaf, const key_t& key, const value_t& value);
+
         /* insert into leaf without split */
         void insert_record_no_split(leaf_node_t* leaf,
             const key_t& key, const value_t& value);
@@ -309,9 +544,77 @@ namespace bpt
         template <class T>
         void node_remove(T* prev, T* node);
 
-        /* multi-level file open/close */
+        /* multi-level file open/close. the const lookups share fp and
+         * each takes file_mutex; writers are serialized by the caller and
+         * do not. readers that may run beside a writer go through
+         * snapshot_reader, which has its own file handle */
+        mutable std::recursive_mutex file_mutex;
         mutable FILE* fp;
         mutable int fp_level;
+        mutable bool sync_deferred; /* skip per-block flush during insert_batch */
+        bool transaction; /* map/unmap go through `pending` */
+        bool truncated;
+        mutable pending_map_t pending;
+
+        /* copy-on-write mode, map/unmap always go through `pending`.
+         * pages is replaced (under version_mutex) by every commit, so
+         * snapshots keep the table they were opened with */
+        bool cow;
+        cow_header_t cow_header;
+        std::shared_ptr<const page_table_t> pages;
+        cow_space_t cow_space; /* only touched by the writer */
+
+        bool buffered() const
+        {
+            return transaction || cow;
+        }
+
+        //  pending еĿд׷ӣлļͷɹ pending
+        int commit_cow();
+        // ļͷҳ¼ָдʱļ״̬ļʱ 1
+        // Ϊļеǰ汾Ŀҳ¼ûռõĲ
+        static int load_cow(FILE* f, cow_header_t& header, page_table_t& table, cow_space_t& space);
+        // д㹻Ŀ䣬ûʱ׷ӣ¸ȡľɸ;ҳ¼ retired
+        static int write_cow(FILE* f, cow_header_t& header, page_table_t& table, cow_space_t& space,
+            bool truncate, const pending_map_t& blocks, std::vector<page_t>& retired);
+        // дʱļеλãûʱ false
+        bool find_page(off_t offset, page_t& page) const;
+
+        friend class snapshot_reader;
+
+        /* version store, guarded by version_mutex. versions[offset] maps
+         * the writing version to the block image before that write,
+         * active maps the version of each open snapshot to its slot */
+        mutable std::mutex version_mutex;
+        unsigned long long version;
+        meta_t published;
+        mutable std::map<off_t, std::map<unsigned long long, std::string>> versions;
+        mutable std::multimap<unsigned long long, off_t> active;
+        mutable bool unpreserved; /* the file was rewritten since publish without keeping its images */
+        /* copy-on-write extents superseded by a commit, tagged like the
+         * images in versions; once no snapshot can read them they move
+         * to reclaimed, and the next commit adds them to cow_space.gaps */
+        mutable std::multimap<unsigned long long, page_t> retired;
+        mutable std::vector<page_t> reclaimed;
+        mutable std::condition_variable published_cv;
+
+        // д offset Ŀ֮ǰΪܶĿձ
+        void preserve(FILE* f, off_t offset) const;
+        //  version Ŀݣڿ֮ûбдʱ false
+        bool find_version(off_t offset, unsigned long long snapshot, std::string& image) const;
+        void release_snapshot(unsigned long long snapshot) const;
+        // ļдпʱ trueļҪգ
+        // ֮򿪵Ŀյд뷢
+        bool keep_for_snapshots() const;
+        // ٱκοҪľݣ÷ version_mutex
+        void collect_versions() const;
+
+        // лֽڽҶӽڵ㣬ʽ read_leaf ͬ
+        static int parse_leaf(const std::string& bytes, leaf_node_t* leaf);
+
+        // еĶдҶӽڵ㰴ļеĸʽл󱣴
+        int map_pending(void* block, off_t offset, size_t size) const;
+        int unmap_pending(void* block, off_t offset, size_t size) const;
         void open_file(const char* mode = "rb+") const
         {
             std::cout << "Opening file: " << path << " mode: " << mode << std::endl;
@@ -393,7 +696,7 @@ namespace bpt
         {
             leaf->n = 0;
             meta.leaf_node_num++;
-            return alloc(sizeof(leaf_node_t));
+            return alloc(leaf_block_size());
         }
 
         off_t alloc(internal_node_t* node)
@@ -403,6 +706,15 @@ namespace bpt
             return alloc(sizeof(internal_node_t));
         }
 
+        /* leaves are serialized as key + size + value per record, the block
+         * must hold a full leaf of the largest values */
+        size_t leaf_block_size() const
+        {
+            size_t serialized = SIZE_NO_CHILDREN +
+                meta.order * (sizeof(key_t) + sizeof(size_t) + meta.value_size);
+            return std::max(serialized, sizeof(leaf_node_t));
+        }
+
         void unalloc(leaf_node_t* leaf, off_t offset)
         {
             --meta.leaf_node_num;
@@ -418,6 +730,9 @@ namespace bpt
             if (!block || size == 0)
                 return -1;
 
+            if (buffered())
+                return map_pending(block, offset, size);
+
             if (!fp && fp_level == 0)
             {
                 open_file();
@@ -437,27 +752,7 @@ namespace bpt
             // Ҷӽڵ㣬Ҫ⴦
             if (size == sizeof(leaf_node_t))
             {
-                leaf_node_t* leaf = static_cast<leaf_node_t*>(block);
-
-                // ȡϢ
-                if (fread(&leaf->parent, sizeof(off_t), 1, fp) != 1 ||
-                    fread(&leaf->next, sizeof(off_t), 1, fp) != 1 ||
-                    fread(&leaf->prev, sizeof(off_t), 1, fp) != 1 ||
-                    fread(&leaf->n, sizeof(size_t), 1, fp) != 1)
-                {
-                    return -1;
-                }
-
-                // ȡÿ¼
-                for (size_t i = 0; i < leaf->n; i++)
-                {
-                    if (!leaf->children[i].deserialize(fp))
-                    {
-                        return -1;
-                    }
-                }
-
-                return 0;
+                return read_leaf(fp, static_cast<leaf_node_t*>(block));
             }
 
             // ͵ĽڵֱӶȡ
@@ -478,9 +773,15 @@ namespace bpt
             return map(block, offset, sizeof(T));
         }
 
+        // ļǰλ÷лһҶӽڵ
+        static int read_leaf(FILE* f, leaf_node_t* leaf);
+
         /* write block to disk */
         int unmap(void* block, off_t offset, size_t size) const
         {
+            if (buffered())
+                return unmap_pending(block, offset, size);
+
             if (!fp && fp_level == 0)
             {
                 open_file("rb+");
@@ -489,6 +790,8 @@ namespace bpt
             if (!fp)
                 return -1;
 
+            preserve(fp, offset);
+
             if (fseek(fp, offset, SEEK_SET) != 0)
                 return -1;
 
@@ -522,13 +825,16 @@ namespace bpt
                     return -1;
             }
 
-            fflush(fp);
+            if (!sync_deferred)
+            {
+                fflush(fp);
 
 #ifdef _WIN32
-            _commit(_fileno(fp));
+                _commit(_fileno(fp));
 #else
-            fsync(fileno(fp));
+                fsync(fileno(fp));
 #endif
+            }
 
             return 0;
         }
@@ -539,6 +845,64 @@ namespace bpt
         }
     };
 
+    /* sequential reads of one snapshot through a private file handle,
+     * several readers may share a snapshot (one per worker thread).
+     * when the tree is inside a transaction and own_writes is set (the
+     * reader belongs to the session that opened it), the reads go
+     * through the tree itself so the transaction sees its own writes */
+    class snapshot_reader
+    {
+    public:
+        explicit snapshot_reader(const bplus_tree* tree,
+            std::shared_ptr<const snapshot_t> snapshot = nullptr, bool own_writes = true);
+        ~snapshot_reader();
+
+        bool is_open() const
+        {
+            return through_tree || f != nullptr;
+        }
+
+        std::shared_ptr<const snapshot_t> get_snapshot() const
+        {
+            return snapshot;
+        }
+
+        meta_t get_meta() const
+        {
+            return through_tree ? tree->get_meta() : snapshot->meta;
+        }
+
+        off_t first_leaf() const
+        {
+            return get_meta().leaf_offset;
+        }
+
+        // ·½һҶ
+        off_t last_leaf();
+
+        bool read_leaf(leaf_node_t* leaf, off_t offset);
+        // ֻڵͷȡһҶӵƫ
+        bool read_next(off_t offset, off_t* next);
+
+        /* bplus_tree::search_batch on the snapshot: keys sorted by keycmp,
+         * return the number of leaves read, -1 on error */
+        int search_batch(const std::vector<key_t>& keys,
+            const std::function<void(size_t, const value_t&)>& callback);
+
+    private:
+        const bplus_tree* tree;
+        std::shared_ptr<const snapshot_t> snapshot;
+        bool through_tree;
+        FILE* f;
+
+        // ȡĿ飺֮дȡ汾洢еľݣļ
+        bool read_block(void* block, off_t offset, size_t size);
+        // дʱļյҳҵλ
+        bool read_page(void* block, off_t offset, size_t size);
+        // ӿյĸ½ key ڵҶӣ 0
+        off_t find_leaf(const key_t& key);
+    };
+
 }
 
 #endif /* end of BPT_H */
@@ -0,0 +1,265 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "csv_export.h"
+#include "field_codec.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdint.h>
+
+static bool writeU32(FILE* fp, size_t value)
+{
+    uint32_t v = static_cast<uint32_t>(value);
+    return fwrite(&v, sizeof(v), 1, fp) == 1;
+}
+
+static bool readU32(const char* data, size_t size, size_t& pos, size_t& value)
+{
+    uint32_t v;
+    if (pos + sizeof(v) > size)
+    {
+        return false;
+    }
+    std::memcpy(&v, data + pos, sizeof(v));
+    pos += sizeof(v);
+    value = v;
+    return true;
+}
+
+static size_t layoutFlags(const TableDef& def)
+{
+    return (def.variableRows ? 1 : 0) | (def.nullBitmap ? 2 : 0);
+}
+
+static bool hasDictionary(const TableDef& def)
+{
+    for (const auto& field : def.fields)
+    {
+        if (field.dictionary)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool writeBinaryHeader(FILE* fp, const TableDef& def)
+{
+    if (fwrite(COPY_BINARY_MAGIC, strlen(COPY_BINARY_MAGIC), 1, fp) != 1 ||
+        !writeU32(fp, def.fields.size()))
+    {
+        return false;
+    }
+    for (const auto& field : def.fields)
+    {
+        if (!writeU32(fp, static_cast<size_t>(field.type)) || !writeU32(fp, field.size) ||
+            !writeU32(fp, field.name.size()) ||
+            (!field.name.empty() && fwrite(field.name.data(), field.name.size(), 1, fp) != 1))
+        {
+            return false;
+        }
+    }
+    return writeU32(fp, def.recordSize) && writeU32(fp, layoutFlags(def));
+}
+
+bool checkBinaryHeader(const char* data, size_t size, const TableDef& def,
+    size_t& headerSize, std::string& error)
+{
+    size_t magic = strlen(COPY_BINARY_MAGIC);
+    if (size < magic || memcmp(data, COPY_BINARY_MAGIC, magic) != 0)
+    {
+        error = "not a binary COPY file";
+        return false;
+    }
+
+    if (hasDictionary(def))
+    {
+        error = "binary COPY does not support dictionary columns";
+        return false;
+    }
+
+    size_t pos = magic;
+    size_t count;
+    if (!readU32(data, size, pos, count))
+    {
+        error = "truncated header";
+        return false;
+    }
+    if (count != def.fields.size())
+    {
+        error = "file has " + std::to_string(count) + " fields, table has " + std::to_string(def.fields.size());
+        return false;
+    }
+
+    // ֶԲͬͺͳȱͬ
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t type, fieldSize, nameLength;
+        if (!readU32(data, size, pos, type) || !readU32(data, size, pos, fieldSize) ||
+            !readU32(data, size, pos, nameLength) || pos + nameLength > size)
+        {
+            error = "truncated header";
+            return false;
+        }
+        pos += nameLength;
+        if (type != static_cast<size_t>(def.fields[i].type) || fieldSize != def.fields[i].size)
+        {
+            error = "field " + std::to_string(i + 1) + " does not match " + def.fields[i].name;
+            return false;
+        }
+    }
+
+    size_t recordSize, flags;
+    if (!readU32(data, size, pos, recordSize) || !readU32(data, size, pos, flags) ||
+        recordSize != def.recordSize || flags != layoutFlags(def))
+    {
+        error = "record layout does not match";
+        return false;
+    }
+    if ((size - pos) % recordSize != 0)
+    {
+        error = "truncated record";
+        return false;
+    }
+    headerSize = pos;
+    return true;
+}
+
+RowExporter::RowExporter(const TableDef& def, const CopyOptions& options)
+    : def(def), layout(def.layout), options(options), buffer(COPY_WRITE_BUFFER)
+{
+}
+
+RowExporter::~RowExporter()
+{
+    if (fp)
+    {
+        fclose(fp);
+    }
+}
+
+bool RowExporter::open(const std::string& path)
+{
+    if (options.binary && hasDictionary(def))
+    {
+        std::cerr << "Binary COPY does not support dictionary columns" << std::endl;
+        return false;
+    }
+
+    fp = fopen(path.c_str(), "wb");
+    if (!fp)
+    {
+        std::cerr << "Failed to create file: " << path << std::endl;
+        return false;
+    }
+    setvbuf(fp, buffer.data(), _IOFBF, buffer.size());
+
+    if (options.binary)
+    {
+        return writeBinaryHeader(fp, def);
+    }
+
+    if (options.header)
+    {
+        line.clear();
+        for (size_t i = 0; i < def.fields.size(); i++)
+        {
+            if (i > 0)
+            {
+                line += options.delimiter;
+            }
+            appendField(def.fields[i].name.data(), def.fields[i].name.size());
+        }
+        line += '\n';
+        return fwrite(line.data(), line.size(), 1, fp) == 1;
+    }
+    return true;
+}
+
+bool RowExporter::write(const char* row, size_t size)
+{
+    rows++;
+    if (options.binary)
+    {
+        // 䳤¼㵽 recordSizeʱ԰̶п
+        line.assign(row, std::min(size, def.recordSize));
+        line.resize(def.recordSize, '\0');
+        return fwrite(line.data(), line.size(), 1, fp) == 1;
+    }
+
+    line.clear();
+    for (size_t i = 0; i < def.fields.size(); i++)
+    {
+        if (i > 0)
+        {
+            line += options.delimiter;
+        }
+        const ColumnLayout& column = layout.column(i);
+        const FieldDef& field = column.field;
+        size_t offset = column.offset;
+        if (column.isNull(row))
+        {
+            continue; // NULL дɲŵĿֶ
+        }
+        if (field.type != FieldType::VARCHAR)
+        {
+            if (offset + column.width <= size)
+            {
+                // ں͸ '-'ָ֮ͬͬ߼ŵ߼
+                fieldText.clear();
+                column.decode(field, row + offset, fieldText);
+                appendField(fieldText.data(), fieldText.size());
+            }
+        }
+        else
+        {
+            std::string_view text = column.text(row, size);
+            if (text.empty() && column.nullBit >= 0)
+            {
+                line += "\"\""; //  NULL 
+                continue;
+            }
+            appendField(text.data(), text.size());
+        }
+    }
+    line += '\n';
+    return fwrite(line.data(), line.size(), 1, fp) == 1;
+}
+
+void RowExporter::appendField(const char* text, size_t length)
+{
+    // ָŻеֶμţд ""
+    bool quote = false;
+    for (size_t i = 0; i < length && !quote; i++)
+    {
+        char c = text[i];
+        quote = c == options.delimiter || c == '"' || c == '\n' || c == '\r';
+    }
+    if (!quote)
+    {
+        line.append(text, length);
+        return;
+    }
+
+    line += '"';
+    for (size_t i = 0; i < length; i++)
+    {
+        if (text[i] == '"')
+        {
+            line += '"';
+        }
+        line += text[i];
+    }
+    line += '"';
+}
+
+bool RowExporter::close()
+{
+    if (!fp)
+    {
+        return false;
+    }
+    bool ok = fflush(fp) == 0;
+    ok = fclose(fp) == 0 && ok;
+    fp = nullptr;
+    return ok;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "query_def.h"
+#include "table_def.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/* write buffer of COPY TO */
+#define COPY_WRITE_BUFFER (1024 * 1024)
+
+/* first bytes of a binary COPY file */
+#define COPY_BINARY_MAGIC "AOLIAOB2"
+
+// Ƹʽħֶθÿֶε //֣¼ȣֱ־1 䳤¼2 ֵλͼ
+// ֮ԭʼ¼ uint32¼ļеĲͬ뵽¼ȣʱֻУṹ
+// ֵֻڱЧֵеıֶ֧Ƹʽ
+
+// дƸʽıṹͷ
+bool writeBinaryHeader(FILE* fp, const TableDef& def);
+
+// Уļıṹͷṹһ£headerSize ؼ¼ʼλ
+bool checkBinaryHeader(const char* data, size_t size, const TableDef& def,
+    size_t& headerSize, std::string& error);
+
+// COPY TO д¼ʹô󻺳˳дļڴб
+class RowExporter
+{
+public:
+    RowExporter(const TableDef& def, const CopyOptions& options);
+    ~RowExporter();
+
+    // ļд CSV ͷƽṹͷ
+    bool open(const std::string& path);
+
+    bool write(const char* row, size_t size);
+
+    // ˢ»رļ
+    bool close();
+
+    size_t rowCount() const
+    {
+        return rows;
+    }
+
+private:
+    const TableDef& def;
+    const RowLayout& layout;
+    CopyOptions options;
+    FILE* fp = nullptr;
+    std::vector<char> buffer;
+    std::string line;
+    std::string fieldText; // ֶתɵı
+    size_t rows = 0;
+
+    void appendField(const char* text, size_t length);
+};
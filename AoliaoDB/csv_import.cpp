@@ -0,0 +1,484 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "csv_import.h"
+#include "csv_export.h"
+#include "field_codec.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <queue>
+#include <thread>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open(const std::string& path)
+{
+    close();
+#ifdef _WIN32
+    HANDLE h = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (h == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    file = h;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(h, &fileSize))
+    {
+        close();
+        return false;
+    }
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (length == 0)
+    {
+        return true; // ļӳ
+    }
+
+    mapping = CreateFileMappingA(h, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping)
+    {
+        close();
+        return false;
+    }
+    base = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close();
+        return false;
+    }
+    length = static_cast<size_t>(st.st_size);
+    if (length == 0)
+    {
+        return true;
+    }
+
+    void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+    madvise(p, length, MADV_SEQUENTIAL);
+    base = static_cast<const char*>(p);
+#endif
+    if (!base)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (base)
+    {
+        UnmapViewOfFile(base);
+    }
+    if (mapping)
+    {
+        CloseHandle(mapping);
+    }
+    if (file)
+    {
+        CloseHandle(file);
+    }
+    mapping = nullptr;
+    file = nullptr;
+#else
+    if (base)
+    {
+        munmap(const_cast<char*>(base), length);
+    }
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+    fd = -1;
+#endif
+    base = nullptr;
+    length = 0;
+}
+
+CsvImporter::CsvImporter(const TableDef& def, const CopyOptions& options, const KeyFunction& makeKey)
+    : def(def), layout(def.layout), options(options), makeKey(makeKey)
+{
+}
+
+bool CsvImporter::load(const std::string& path)
+{
+    keys.clear();
+    sorted.clear();
+    rowLengths.clear();
+    message.clear();
+
+    MappedFile file;
+    if (!file.open(path))
+    {
+        message = "cannot open file: " + path;
+        return false;
+    }
+    const char* data = file.data();
+    const char* end = data + file.size();
+
+    const char* begin = data;
+    if (options.binary)
+    {
+        size_t headerSize;
+        if (!checkBinaryHeader(data, file.size(), def, headerSize, message))
+        {
+            return false;
+        }
+        begin = data + headerSize;
+    }
+    else if (options.header && begin < end)
+    {
+        const char* eol = static_cast<const char*>(memchr(begin, '\n', end - begin));
+        begin = eol ? eol + 1 : end;
+    }
+
+    size_t threads = options.threads;
+    if (threads == 0)
+    {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::max<size_t>(1, std::min(threads, static_cast<size_t>(end - begin) / CSV_MIN_CHUNK_BYTES + 1));
+
+    // ֽƽп飺CSV ÿĽβƵһ֮󣬶ư¼
+    std::vector<Chunk> chunks;
+    const char* pos = begin;
+    size_t records = options.binary ? static_cast<size_t>(end - begin) / def.recordSize : 0;
+    for (size_t i = 0; i < threads && pos < end; i++)
+    {
+        const char* stop;
+        if (i + 1 == threads)
+        {
+            stop = end;
+        }
+        else if (options.binary)
+        {
+            stop = begin + records * (i + 1) / threads * def.recordSize;
+        }
+        else
+        {
+            stop = pos + (end - begin) / threads;
+            if (stop < end)
+            {
+                const char* eol = static_cast<const char*>(memchr(stop, '\n', end - stop));
+                stop = eol ? eol + 1 : end;
+            }
+        }
+        if (stop <= pos)
+        {
+            continue;
+        }
+        Chunk chunk;
+        chunk.begin = pos;
+        chunk.end = stop;
+        chunks.push_back(std::move(chunk));
+        pos = stop;
+    }
+
+    std::cout << "Parsing " << file.size() << " bytes with " << chunks.size() << " threads" << std::endl;
+
+    auto work = [this, data](Chunk& chunk)
+    {
+        if (options.binary)
+        {
+            keyChunk(chunk);
+        }
+        else
+        {
+            parseChunk(chunk, data);
+        }
+        if (chunk.error.empty())
+        {
+            sortChunk(chunk);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < chunks.size(); i++)
+    {
+        workers.emplace_back(work, std::ref(chunks[i]));
+    }
+    if (!chunks.empty())
+    {
+        work(chunks[0]);
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+
+    for (const auto& chunk : chunks)
+    {
+        if (!chunk.error.empty())
+        {
+            message = chunk.error;
+            return false;
+        }
+    }
+
+    merge(chunks);
+
+    for (size_t i = 1; i < keys.size(); i++)
+    {
+        if (bpt::keycmp(keys[i - 1], keys[i]) == 0)
+        {
+            // ǱıΪ룩ʱԭеֵ
+            message = "duplicate key in file: " + keyText(sorted.data() + i * def.recordSize, rowLengths[i]);
+            keys.clear();
+            sorted.clear();
+            rowLengths.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+void CsvImporter::parseChunk(Chunk& chunk, const char* file) const
+{
+    const char* pos = chunk.begin;
+    while (pos < chunk.end)
+    {
+        const char* eol = static_cast<const char*>(memchr(pos, '\n', chunk.end - pos));
+        const char* lineEnd = eol ? eol : chunk.end;
+        const char* next = eol ? eol + 1 : chunk.end;
+        if (lineEnd > pos && lineEnd[-1] == '\r')
+        {
+            lineEnd--;
+        }
+
+        if (lineEnd > pos) // 
+        {
+            size_t index = chunk.keys.size();
+            chunk.rows.resize((index + 1) * def.recordSize);
+            bpt::key_t key;
+            size_t length;
+            std::string error;
+            if (!parseLine(pos, lineEnd, chunk.rows.data() + index * def.recordSize, length, key, error))
+            {
+                chunk.error = error + " at byte offset " + std::to_string(pos - file);
+                return;
+            }
+            chunk.keys.push_back(key);
+            chunk.lengths.push_back(length);
+        }
+        pos = next;
+    }
+}
+
+void CsvImporter::keyChunk(Chunk& chunk) const
+{
+    // ¼ѾǱеĲֻ֣ɵһɼ
+    chunk.source = chunk.begin;
+    const FieldDef& field = def.fields[0];
+    for (const char* row = chunk.begin; row < chunk.end; row += def.recordSize)
+    {
+        size_t length = layout.rowLength(row);
+        if (length > def.recordSize)
+        {
+            chunk.error = "corrupt record at byte offset " + std::to_string(row - chunk.begin);
+            return;
+        }
+        chunk.lengths.push_back(length);
+
+        std::string text = keyText(row, length);
+        if (field.type == FieldType::VARCHAR && text.size() >= sizeof(bpt::key_t().k))
+        {
+            chunk.error = "key value too long: " + text;
+            return;
+        }
+        chunk.keys.push_back(makeKey(text));
+    }
+}
+
+std::string CsvImporter::keyText(const char* row, size_t length) const
+{
+    const FieldDef& field = def.fields[0];
+    const ColumnLayout& column = layout.column(0);
+    return field.type == FieldType::VARCHAR ?
+        std::string(column.text(row, length)) : decodeField(field, row + column.offset);
+}
+
+void CsvImporter::sortChunk(Chunk& chunk) const
+{
+    chunk.order.resize(chunk.keys.size());
+    for (size_t i = 0; i < chunk.order.size(); i++)
+    {
+        chunk.order[i] = i;
+    }
+    const std::vector<bpt::key_t>& keys = chunk.keys;
+    std::sort(chunk.order.begin(), chunk.order.end(), [&keys](size_t a, size_t b)
+        {
+            return bpt::keycmp(keys[a], keys[b]) < 0;
+        });
+}
+
+bool CsvImporter::parseLine(const char* begin, const char* end, char* row, size_t& length,
+    bpt::key_t& key, std::string& error) const
+{
+    memset(row, 0, layout.variable() ? layout.fixedSize() : def.recordSize);
+    length = layout.fixedSize(); // 䳤ݴӶ֮ʼд
+
+    std::string text;
+    const char* pos = begin;
+    for (size_t i = 0; i < def.fields.size(); i++)
+    {
+        if (i > 0)
+        {
+            if (pos >= end || *pos != options.delimiter)
+            {
+                error = "expected " + std::to_string(def.fields.size()) + " fields";
+                return false;
+            }
+            pos++;
+        }
+
+        // һֶΣȥŲԭ ""
+        text.clear();
+        bool quoted = pos < end && *pos == '"';
+        if (quoted)
+        {
+            pos++;
+            while (true)
+            {
+                const char* quote = static_cast<const char*>(memchr(pos, '"', end - pos));
+                if (!quote)
+                {
+                    error = "unterminated quoted field";
+                    return false;
+                }
+                text.append(pos, quote);
+                pos = quote + 1;
+                if (pos < end && *pos == '"')
+                {
+                    text += '"';
+                    pos++;
+                    continue;
+                }
+                break;
+            }
+        }
+        else
+        {
+            const char* stop = static_cast<const char*>(memchr(pos, options.delimiter, end - pos));
+            if (!stop)
+            {
+                stop = end;
+            }
+            text.assign(pos, stop);
+            pos = stop;
+        }
+
+        // ŵĿֶ NULL"" ǿմ
+        const ColumnLayout& column = layout.column(i);
+        const FieldDef& field = column.field;
+        if (!quoted && text.empty() && column.nullBit >= 0)
+        {
+            text = nullText();
+        }
+        if (!layout.encodeColumn(i, text, row, length))
+        {
+            error = "invalid value '" + text + "' for field " + field.name;
+            return false;
+        }
+
+        if (i == 0)
+        {
+            if (field.type == FieldType::VARCHAR && text.size() >= sizeof(key.k))
+            {
+                error = "key value too long: " + text;
+                return false;
+            }
+            key = makeKey(text);
+        }
+    }
+
+    if (pos != end)
+    {
+        error = "expected " + std::to_string(def.fields.size()) + " fields";
+        return false;
+    }
+    if (!layout.variable())
+    {
+        length = def.recordSize;
+    }
+    return true;
+}
+
+void CsvImporter::merge(std::vector<Chunk>& chunks)
+{
+    size_t total = 0;
+    for (const auto& chunk : chunks)
+    {
+        total += chunk.keys.size();
+    }
+    keys.reserve(total);
+    rowLengths.reserve(total);
+    sorted.resize(total * def.recordSize);
+
+    //  (, ĸ)ǰС
+    typedef std::pair<size_t, size_t> Cursor;
+    auto greater = [&chunks](const Cursor& a, const Cursor& b)
+    {
+        const Chunk& ca = chunks[a.first];
+        const Chunk& cb = chunks[b.first];
+        return bpt::keycmp(ca.keys[ca.order[a.second]], cb.keys[cb.order[b.second]]) > 0;
+    };
+    std::priority_queue<Cursor, std::vector<Cursor>, decltype(greater)> heap(greater);
+    for (size_t i = 0; i < chunks.size(); i++)
+    {
+        if (!chunks[i].keys.empty())
+        {
+            heap.push(Cursor(i, 0));
+        }
+    }
+
+    while (!heap.empty())
+    {
+        Cursor cursor = heap.top();
+        heap.pop();
+        const Chunk& chunk = chunks[cursor.first];
+        size_t index = chunk.order[cursor.second];
+        const char* rows = chunk.source ? chunk.source : chunk.rows.data();
+        std::memcpy(sorted.data() + keys.size() * def.recordSize,
+            rows + index * def.recordSize, chunk.lengths[index]);
+        keys.push_back(chunk.keys[index]);
+        rowLengths.push_back(chunk.lengths[index]);
+        if (++cursor.second < chunk.keys.size())
+        {
+            heap.push(cursor);
+        }
+    }
+
+    // ڵѾƳ
+    for (auto& chunk : chunks)
+    {
+        std::vector<char>().swap(chunk.rows);
+        std::vector<bpt::key_t>().swap(chunk.keys);
+        std::vector<size_t>().swap(chunk.lengths);
+    }
+}
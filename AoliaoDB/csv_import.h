@@ -0,0 +1,119 @@
+#pragma once
+#include "bpt.h"
+#include "query_def.h"
+#include "table_def.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+/* smallest chunk given to one CSV parsing worker */
+#define CSV_MIN_CHUNK_BYTES (1024 * 1024)
+
+// ֻӳļWindows ʹ CreateFileMappingƽ̨ʹ mmap
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    const char* data() const
+    {
+        return base;
+    }
+
+    size_t size() const
+    {
+        return length;
+    }
+
+private:
+    const char* base = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* file = nullptr;    // HANDLE
+    void* mapping = nullptr; // HANDLE
+#else
+    int fd = -1;
+#endif
+};
+
+//  CSV 룺ļӳ䵽ڴڻдгɿ飬ÿ̰߳ԼĿ
+// ֱӽ TableDef ֵĶƼ¼ k ·鲢һ鰴
+// ֶο˫ŰΧڵ "" ʾһţ֧ڻС
+// options.binary ʱȡ COPY TO Ķļ¼Ҫ¼пֻ
+class CsvImporter
+{
+public:
+    typedef std::function<bpt::key_t(const std::string&)> KeyFunction;
+
+    CsvImporter(const TableDef& def, const CopyOptions& options, const KeyFunction& makeKey);
+
+    // ļظʽʱ falseerror() ԭ
+    bool load(const std::string& path);
+
+    size_t rowCount() const
+    {
+        return keys.size();
+    }
+
+    //  keycmp ļ rows() еļ¼һһӦ
+    const std::vector<bpt::key_t>& sortedKeys() const
+    {
+        return keys;
+    }
+
+    // ļ¼ÿռ def.recordSize ֽڵĿ
+    const char* rows() const
+    {
+        return sorted.data();
+    }
+
+    // ÿ¼ʵʳ
+    const size_t* lengths() const
+    {
+        return rowLengths.data();
+    }
+
+    const std::string& error() const
+    {
+        return message;
+    }
+
+private:
+    struct Chunk
+    {
+        const char* begin;
+        const char* end;
+        const char* source = nullptr; // Ƶʱ¼ֱӳļƵ rows
+        std::vector<char> rows;
+        std::vector<bpt::key_t> keys;
+        std::vector<size_t> lengths;
+        std::vector<size_t> order; // ļ¼±
+        std::string error;
+    };
+
+    const TableDef& def;
+    const RowLayout& layout;
+    CopyOptions options;
+    KeyFunction makeKey;
+
+    std::vector<bpt::key_t> keys;
+    std::vector<char> sorted;
+    std::vector<size_t> rowLengths;
+    std::string message;
+
+    void parseChunk(Chunk& chunk, const char* file) const;
+    void keyChunk(Chunk& chunk) const;
+    // ֵļ¼еһУı
+    std::string keyText(const char* row, size_t length) const;
+    void sortChunk(Chunk& chunk) const;
+    bool parseLine(const char* begin, const char* end, char* row, size_t& length,
+        bpt::key_t& key, std::string& error) const;
+    void merge(std::vector<Chunk>& chunks);
+};
@@ -0,0 +1,105 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "dictionary.h"
+#include <stdio.h>
+#include <iostream>
+
+// ļʽÿֵΪ | uint32  |  |˳
+
+bool Dictionary::load()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& chunk : chunks)
+    {
+        chunk.reset();
+    }
+    count = 0;
+    codes.clear();
+
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (!fp)
+    {
+        return true;
+    }
+
+    bool ok = true;
+    uint32_t length;
+    while (fread(&length, sizeof(length), 1, fp) == 1)
+    {
+        std::string value(length, '\0');
+        if ((length > 0 && fread(&value[0], length, 1, fp) != 1) || count >= DICTIONARY_MAX_ENTRIES)
+        {
+            std::cerr << "Corrupt dictionary file: " << path << std::endl;
+            ok = false;
+            break;
+        }
+        add(std::move(value));
+    }
+    fclose(fp);
+
+    std::cout << "Loaded " << count << " dictionary values from " << path << std::endl;
+    return ok;
+}
+
+bool Dictionary::encode(std::string_view value, uint16_t& code)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = codes.find(value);
+    if (it != codes.end())
+    {
+        code = it->second;
+        return true;
+    }
+
+    if (count >= DICTIONARY_MAX_ENTRIES)
+    {
+        std::cerr << "Dictionary is full: " << path << std::endl;
+        return false;
+    }
+
+    // ֵٳ֣ÿδļ׷ӣռļ
+    FILE* fp = fopen(path.c_str(), "ab");
+    if (!fp)
+    {
+        std::cerr << "Failed to open dictionary file: " << path << std::endl;
+        return false;
+    }
+    uint32_t length = static_cast<uint32_t>(value.size());
+    bool ok = fwrite(&length, sizeof(length), 1, fp) == 1 &&
+        (length == 0 || fwrite(value.data(), length, 1, fp) == 1);
+    ok = fclose(fp) == 0 && ok;
+    if (!ok)
+    {
+        std::cerr << "Failed to write dictionary file: " << path << std::endl;
+        return false;
+    }
+
+    code = static_cast<uint16_t>(count.load());
+    add(std::string(value));
+    return true;
+}
+
+bool Dictionary::find(std::string_view value, uint16_t& code) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = codes.find(value);
+    if (it == codes.end())
+    {
+        return false;
+    }
+    code = it->second;
+    return true;
+}
+
+void Dictionary::add(std::string value)
+{
+    size_t code = count.load();
+    std::unique_ptr<std::string[]>& chunk = chunks[code / DICTIONARY_CHUNK];
+    if (!chunk)
+    {
+        chunk.reset(new std::string[DICTIONARY_CHUNK]);
+    }
+    std::string& slot = chunk[code % DICTIONARY_CHUNK];
+    slot = std::move(value);
+    codes.emplace(std::string_view(slot), static_cast<uint16_t>(code));
+    count.store(code + 1, std::memory_order_release);
+}
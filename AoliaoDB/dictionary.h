@@ -0,0 +1,62 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/* a dictionary column holds at most this many distinct values, codes are uint16 */
+#define DICTIONARY_MAX_ENTRIES 65536
+
+/* values are stored in chunks of this many, allocated as the dictionary grows */
+#define DICTIONARY_CHUNK 256
+
+// ͻ VARCHAR еֵ䣺¼ֻ 2 ֽڵı룬밴ֵһγֵ˳䡣
+// ֵֻ׷ӣֵ׷ӵ ..dict ļٷر룬¼вļûеı
+class Dictionary
+{
+public:
+    explicit Dictionary(const std::string& path) : path(path)
+    {
+    }
+
+    // ֵļļʱΪֵ
+    bool load();
+
+    // ֵı룬ʱ׷ӡֵдļʧܷ false
+    // еʱ߳ͬʱãڲ
+    bool encode(std::string_view value, uint16_t& code);
+
+    // ֻң׷
+    bool find(std::string_view value, uint16_t& code) const;
+
+    // ӦֵԽ緵ؿմ
+    // ֻ䲻бɨʱв׷ӡֵд֮ count
+    // еĿֵƶ
+    std::string_view at(uint16_t code) const
+    {
+        return code < count.load(std::memory_order_acquire) ?
+            std::string_view(chunks[code / DICTIONARY_CHUNK][code % DICTIONARY_CHUNK]) : std::string_view();
+    }
+
+    size_t size() const
+    {
+        return count.load(std::memory_order_acquire);
+    }
+
+    const std::string& fileName() const
+    {
+        return path;
+    }
+
+private:
+    std::string path;
+    std::unique_ptr<std::string[]> chunks[DICTIONARY_MAX_ENTRIES / DICTIONARY_CHUNK]; //  -> ֵ
+    std::atomic<size_t> count{ 0 };
+    std::unordered_map<std::string_view, uint16_t> codes; // ֵ -> 룬ָ chunks еĴ
+    mutable std::mutex mutex;
+
+    void add(std::string value);
+};
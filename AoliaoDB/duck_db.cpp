@@ -5,6 +5,8 @@
 #include "bpt.h"
 #include "TextTable.h"
 #include "table_manager.h"
+#include "sql_parser.h"
+#include "server.h"
 #include <direct.h>		// for _mkdir
 #include <sys/stat.h> // for mkdir
 #include <stdio.h>
@@ -15,6 +17,17 @@
 #include <sys/stat.h>
 #include <vector>
 #include <sstream>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <ctime>
+#include <iomanip>
+#include <csignal>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
 
 using namespace bpt;
 using namespace std;
@@ -25,23 +38,40 @@ const char* exitMessage = "> bye!\n";
 
 TableManager* tm = nullptr;
 
+// Ự PREPARE 
+map<string, shared_ptr<const QueryPlan>> preparedStatements;
+
+// ģʽִʱĵϢ
+bool quietEngine = false;
+
+// ģʽյ SIGINT / SIGTERM ʱֹͣ
+DatabaseServer* server = nullptr;
+
 // function prototype
 void printHelpMess();
 void selectCommand();
-void processCreateTable(const string& cmd);
-void processInsert(const string& cmd);
-void processSelect(const string& cmd);
-void processDropTable(const string& cmd);
-vector<string> splitString(const string& str, char delimiter);
+bool runStatement(const string& cmd);
+QueryResult executePlan(const QueryPlan& plan, const vector<string>& params);
+bool processPrepare(const Statement& stmt);
+bool processExecute(const Statement& stmt);
+bool processDeallocate(const Statement& stmt);
+bool printResult(const QueryPlan& plan, const QueryResult& result);
+void printResults(const vector<string>& headers, const vector<vector<string>>& rows);
+int runBatch(const string& script, bool timing);
+void splitStatements(const string& script, vector<string>& statements);
+double cpuSeconds();
+int runServer(const string& dbPath, const ServerOptions& options, bool verbose);
+int runClient(DatabaseClient& client, const string& script, bool batch);
+bool runRemoteStatement(DatabaseClient& client, const string& cmd);
 
 // initial
-void initialSystem()
+void initialSystem(const string& dbPath)
 {
 	// step 1: print help message
 	printHelpMess();
 
 	// step 2: initialize table manager
-	tm = new TableManager("./data/");
+	tm = new TableManager(dbPath);
 
 	// step 3: REPL select command
 	selectCommand();
@@ -61,10 +91,30 @@ void printHelpMess()
 		<< "  .help                           print help message;" << endl
 		<< "  .exit                           exit program;" << endl
 		<< "  CREATE TABLE tablename (field1 TYPE1, field2 TYPE2, ...);   create new table;" << endl
+		<< "  CREATE TABLE tablename (...) WITH (COPY_ON_WRITE);          blocks are appended, never overwritten;" << endl
 		<< "  DROP TABLE tablename;                                       delete table;" << endl
+		<< "  TRUNCATE TABLE tablename;                                   delete all records;" << endl
 		<< "  INSERT INTO tablename VALUES (val1, val2, ...);            insert record;" << endl
+		<< "  INSERT INTO tablename VALUES (...), (...), ...;            insert records in one batch;" << endl
+		<< "  INSERT OR REPLACE INTO tablename VALUES (...);             insert or replace by key;" << endl
+		<< "  INSERT INTO tablename VALUES (...) ON CONFLICT DO UPDATE SET col = v | DO NOTHING;   upsert;" << endl
+		<< "  UPDATE tablename SET col = v, ... [WHERE condition];       update records;" << endl
+		<< "  DELETE FROM tablename [WHERE condition];                   delete records;" << endl
+		<< "  DELETE FROM tablename WHERE key BETWEEN a AND b;           delete a key range;" << endl
 		<< "  SELECT * FROM tablename;                                   query all records;" << endl
 		<< "  SELECT * FROM tablename WHERE condition;                   query with condition;" << endl
+		<< "  SELECT * FROM tablename [WHERE ...] ORDER BY col [ASC|DESC] [LIMIT n];   sorted query;" << endl
+		<< "  SELECT * FROM tablename [...] LIMIT n [OFFSET m];                                    paged query;" << endl
+		<< "  SELECT COUNT(*), SUM(f), MIN(f), MAX(f), AVG(f) FROM tablename [WHERE condition];   aggregate;" << endl
+		<< "  SELECT col, AGG(f), ... FROM tablename [WHERE condition] GROUP BY col, ...;           group by;" << endl
+		<< "  SELECT * | a.col, b.col, ... FROM a JOIN b ON a.x = b.y [WHERE a.f = v AND ...];   join;" << endl
+		<< "  COPY tablename FROM 'file' [FORMAT CSV|BINARY] [WITH (DELIMITER ',', HEADER, THREADS n)];   bulk load;" << endl
+		<< "  COPY tablename TO 'file' [FORMAT CSV|BINARY] [WHERE condition] [WITH (DELIMITER ',', HEADER)];   export;" << endl
+		<< "  PREPARE name AS statement-with-?;  EXECUTE name(v1, ...);  DEALLOCATE name;       prepared statements;" << endl
+		<< "  BEGIN;  statements...;  COMMIT | ROLLBACK;                   transaction, written to disk once at COMMIT;" << endl
+		<< "  column types: INT, BIGINT, FLOAT, DOUBLE, BOOLEAN, DATE ('YYYY-MM-DD'), VARCHAR[(n)] [DICTIONARY]" << endl
+		<< "  NULL: INSERT ... VALUES (1, NULL); WHERE col IS [NOT] NULL; aggregates skip NULL values" << endl
+		<< "  keywords are case-insensitive, strings may be quoted with ' or \", the trailing ; is optional" << endl
 		<< "*********************************************************************************************" << endl
 		<< endl
 		<< nextLineHeader;
@@ -76,272 +126,515 @@ void selectCommand()
 	string cmd;
 	while (true)
 	{
-		getline(cin, cmd);
+		if (!getline(cin, cmd))
+		{
+			cout << exitMessage;
+			break;
+		}
 
 		if (cmd == ".exit")
 		{
+			if (tm->inTransaction())
+			{
+				cout << "> Transaction not committed, changes discarded" << endl;
+			}
 			cout << exitMessage;
 			break;
 		}
 		else if (cmd == ".help")
 		{
 			printHelpMess();
+			continue;
 		}
-		else if (cmd.find("CREATE TABLE") == 0)
-		{
-			processCreateTable(cmd);
-		}
-		else if (cmd.find("INSERT INTO") == 0)
-		{
-			processInsert(cmd);
-		}
-		else if (cmd.find("SELECT") == 0)
+
+		runStatement(cmd);
+	}
+}
+
+// ִһ䲢Ƿɹ
+bool runStatement(const string& cmd)
+{
+	// ﷨﷨Ựиãʱظڴ
+	static Parser parser;
+	static Statement stmt;
+	static vector<string> params;
+	static string error;
+
+	// PREPARE / EXECUTE / DEALLOCATE Ựе
+	Token first = Lexer(cmd).next();
+	if (first.type == TokenType::IDENT && (equalsKeyword(first.text, "PREPARE") ||
+		equalsKeyword(first.text, "EXECUTE") || equalsKeyword(first.text, "DEALLOCATE")))
+	{
+		if (!parser.parse(cmd, stmt))
 		{
-			processSelect(cmd);
+			cerr << "Syntax error: " << parser.error() << endl;
+			cout << errorMessage << nextLineHeader;
+			return false;
 		}
-		else if (cmd.find("DROP TABLE") == 0)
+		else if (stmt.type == StatementType::PREPARE)
 		{
-			processDropTable(cmd);
+			return processPrepare(stmt);
 		}
-		else
+		else if (stmt.type == StatementType::EXECUTE)
 		{
-			cout << errorMessage << nextLineHeader;
+			return processExecute(stmt);
 		}
+		return processDeallocate(stmt);
 	}
+
+	// Զͬ״мƻ棬ظ
+	auto plan = tm->prepare(cmd, params, error);
+	if (!plan)
+	{
+		cerr << "Error: " << error << endl;
+		cout << errorMessage << nextLineHeader;
+		return false;
+	}
+	return printResult(*plan, executePlan(*plan, params));
 }
 
-void processCreateTable(const string& cmd)
+// ִмƻģʽִڼرĵ
+QueryResult executePlan(const QueryPlan& plan, const vector<string>& params)
 {
-	// CREATE TABLE
-	// ʽ: CREATE TABLE tablename (field1 TYPE1(size), field2 TYPE2, ...)
-	size_t leftParen = cmd.find('(');
-	size_t rightParen = cmd.find_last_of(')');
+	if (!quietEngine)
+	{
+		return tm->execute(plan, params);
+	}
+	streambuf* out = cout.rdbuf(nullptr);
+	QueryResult result = tm->execute(plan, params);
+	cout.rdbuf(out);
+	return result;
+}
 
-	if (leftParen == string::npos || rightParen == string::npos)
+bool processPrepare(const Statement& stmt)
+{
+	string error;
+	auto plan = tm->prepare(string(stmt.body), error);
+	if (!plan)
 	{
+		cerr << "Error: " << error << endl;
 		cout << errorMessage << nextLineHeader;
-		return;
+		return false;
 	}
+	preparedStatements[string(stmt.name)] = plan;
+	cout << "> Statement prepared with " << plan->paramCount << " parameters" << nextLineHeader;
+	return true;
+}
 
-	// ȡ
-	string tableName = cmd.substr(13, leftParen - 13);
-	tableName = tableName.substr(0, tableName.find_last_not_of(" ") + 1);
-
-	// ֶζ
-	string fieldsDef = cmd.substr(leftParen + 1, rightParen - leftParen - 1);
-	vector<string> fields = splitString(fieldsDef, ',');
-
-	TableDef def;
-	def.tableName = tableName;
-	size_t totalSize = 0;
-
-	for (const auto& field : fields)
+bool processExecute(const Statement& stmt)
+{
+	auto it = preparedStatements.find(string(stmt.name));
+	if (it == preparedStatements.end())
 	{
-		istringstream iss(field);
-		string fieldName, fieldType;
-		size_t fieldSize = 0;
-
-		iss >> fieldName >> fieldType;
-
-		FieldDef fieldDef;
-		fieldDef.name = fieldName;
-		if (fieldType == "INT")
-		{
-			fieldDef.type = FieldType::INT;
-			fieldDef.size = sizeof(int);
-		}
-		else if (fieldType.substr(0, 7) == "VARCHAR")
-		{
-			fieldDef.type = FieldType::VARCHAR;
-			size_t sizeStart = fieldType.find('(');
-			size_t sizeEnd = fieldType.find(')');
-			if (sizeStart != string::npos && sizeEnd != string::npos)
-			{
-				fieldDef.size = stoi(fieldType.substr(sizeStart + 1, sizeEnd - sizeStart - 1));
-			}
-			else
-			{
-				fieldDef.size = 256; // ĬϴС
-			}
-			cout << fieldDef.size << endl;
-		}
+		cout << "> Prepared statement not found: " << stmt.name << nextLineHeader;
+		return false;
+	}
 
-		totalSize += fieldDef.size;
-		def.fields.push_back(fieldDef);
+	vector<string> params;
+	for (const auto& value : stmt.values)
+	{
+		params.push_back(string(value.text));
+	}
+	if (params.size() != it->second->paramCount)
+	{
+		cerr << "Expected " << it->second->paramCount << " parameters, got " << params.size() << endl;
+		cout << errorMessage << nextLineHeader;
+		return false;
 	}
+	return printResult(*it->second, executePlan(*it->second, params));
+}
 
-	def.recordSize = totalSize;
+bool processDeallocate(const Statement& stmt)
+{
+	if (preparedStatements.erase(string(stmt.name)) == 0)
+	{
+		cout << "> Prepared statement not found: " << stmt.name << nextLineHeader;
+		return false;
+	}
+	cout << "> Statement deallocated" << nextLineHeader;
+	return true;
+}
 
-	if (tm->createTable(def))
+bool printResult(const QueryPlan& plan, const QueryResult& result)
+{
+	string message = resultMessage(plan, result);
+	if (message.empty())
 	{
-		cout << "> Table created successfully" << nextLineHeader;
+		printResults(result.headers, result.rows);
 	}
 	else
 	{
-		cout << "> Failed to create table" << nextLineHeader;
+		cout << "> " << message << nextLineHeader;
 	}
+	return result.ok;
 }
 
-void processInsert(const string& cmd)
+void printResults(const vector<string>& headers, const vector<vector<string>>& rows)
 {
-	// INSERT INTO
-	// ʽ: INSERT INTO tablename VALUES (val1, val2, ...)
-	size_t valuesPos = cmd.find("VALUES");
-	if (valuesPos == string::npos)
+	TextTable t('-', '|', '+');
+
+	// ӱͷ
+	for (const auto& header : headers)
 	{
-		cout << errorMessage << nextLineHeader;
-		return;
+		t.add(" " + header + " ");
 	}
+	t.endOfRow();
 
-	string tableName = cmd.substr(12, valuesPos - 13);
-
-	size_t leftParen = cmd.find('(', valuesPos);
-	size_t rightParen = cmd.find(')', valuesPos);
-
-	if (leftParen == string::npos || rightParen == string::npos)
+	// 
+	for (const auto& row : rows)
 	{
-		cout << errorMessage << nextLineHeader;
-		return;
+		for (const auto& value : row)
+		{
+			t.add(" " + value + " ");
+		}
+		t.endOfRow();
 	}
 
-	string valuesStr = cmd.substr(leftParen + 1, rightParen - leftParen - 1);
-	vector<string> values = splitString(valuesStr, ',');
+	cout << t << nextLineHeader;
+}
 
-	// ֵеĿո
-	for (auto& value : values)
+void ensure_data_directory()
+{
+#ifdef _WIN32
+	_mkdir(".\\data");
+#else
+	mkdir("./data", 0777);
+#endif
+}
+
+// ѽűзֳ䣺ķֺŽһ䣬 -- ʼע͵βΪֹ
+void splitStatements(const string& script, vector<string>& statements)
+{
+	string current;
+	char quote = 0;
+	for (size_t i = 0; i < script.size(); i++)
 	{
-		value = value.substr(value.find_first_not_of(" \""));
-		value = value.substr(0, value.find_last_not_of(" \"") + 1);
+		char c = script[i];
+		if (quote)
+		{
+			quote = c == quote ? 0 : quote;
+		}
+		else if (c == '\'' || c == '"')
+		{
+			quote = c;
+		}
+		else if (c == '-' && i + 1 < script.size() && script[i + 1] == '-')
+		{
+			while (i < script.size() && script[i] != '\n')
+			{
+				i++;
+			}
+			c = ' ';
+		}
+		else if (c == ';')
+		{
+			statements.push_back(current);
+			current.clear();
+			continue;
+		}
+		current += (c == '\n' || c == '\r' || c == '\t') ? ' ' : c;
 	}
+	statements.push_back(current);
 
-	if (tm->insert(tableName, values))
+	// ȥβհ
+	size_t n = 0;
+	for (auto& statement : statements)
 	{
-		cout << "> Record inserted successfully" << nextLineHeader;
+		size_t begin = statement.find_first_not_of(' ');
+		if (begin == string::npos)
+		{
+			continue;
+		}
+		size_t end = statement.find_last_not_of(' ');
+		statements[n++] = statement.substr(begin, end - begin + 1);
 	}
-	else
+	statements.resize(n);
+}
+
+// ռõ CPU ʱ䣨룩
+double cpuSeconds()
+{
+#ifdef _WIN32
+	FILETIME creation, exit, kernel, user;
+	if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
 	{
-		cout << "> Failed to insert record" << nextLineHeader;
+		return 0;
 	}
+	ULARGE_INTEGER k, u;
+	k.LowPart = kernel.dwLowDateTime;
+	k.HighPart = kernel.dwHighDateTime;
+	u.LowPart = user.dwLowDateTime;
+	u.HighPart = user.dwHighDateTime;
+	return (k.QuadPart + u.QuadPart) / 1e7; // 100ns Ϊλ
+#else
+	return static_cast<double>(clock()) / CLOCKS_PER_SEC;
+#endif
 }
 
-void processSelect(const string& cmd)
+// ִнűе䣬ʾʾʧܵ
+int runBatch(const string& script, bool timing)
 {
-	// SELECT
-	// ʽ: SELECT * FROM tablename [WHERE condition]
-	size_t fromPos = cmd.find("FROM");
-	if (fromPos == string::npos)
+	vector<string> statements;
+	splitStatements(script, statements);
+
+	int failed = 0;
+	double totalWall = 0;
+	double totalCpu = 0;
+	cout << fixed << setprecision(3);
+	for (const auto& statement : statements)
 	{
-		cout << errorMessage << nextLineHeader;
-		return;
-	}
+		auto wallStart = chrono::steady_clock::now();
+		double cpuStart = cpuSeconds();
 
-	size_t wherePos = cmd.find("WHERE");
-	string tableName = cmd.substr(fromPos + 5,
-		wherePos == string::npos ? string::npos : wherePos - fromPos - 6);
+		if (!runStatement(statement))
+		{
+			failed++;
+		}
 
-	// еĿո
-	tableName = tableName.substr(0, tableName.find_last_not_of(" "));
+		double wall = chrono::duration<double, milli>(chrono::steady_clock::now() - wallStart).count();
+		double cpu = (cpuSeconds() - cpuStart) * 1000;
+		totalWall += wall;
+		totalCpu += cpu;
+		if (timing)
+		{
+			cout << "Time: " << wall << " ms wall, " << cpu << " ms cpu" << endl;
+		}
+	}
 
-	string whereClause = "";
-	if (wherePos != string::npos)
+	if (timing)
 	{
-		whereClause = cmd.substr(wherePos + 6);
+		cout << "Total: " << statements.size() << " statements, " << failed << " failed, "
+			<< totalWall << " ms wall, " << totalCpu << " ms cpu" << endl;
 	}
+	return failed;
+}
 
-	auto results = tm->select(tableName, whereClause);
+static void stopServer(int)
+{
+	if (server)
+	{
+		server->stop();
+	}
+}
 
-	if (!results.empty())
+// ģʽؽͨ׽ֹݿ⣬Ctrl+C ֹͣ
+int runServer(const string& dbPath, const ServerOptions& options, bool verbose)
+{
+	if (!verbose)
 	{
-		// ȡʾ
-		TableDef def = tm->getTableDef(tableName);
+		cout.rdbuf(nullptr); // ĵԼ־д cerr
+	}
+	tm = new TableManager(dbPath);
 
-		TextTable t('-', '|', '+');
+	DatabaseServer instance(*tm, options);
+	server = &instance;
+	signal(SIGINT, stopServer);
+	signal(SIGTERM, stopServer);
+	bool ok = instance.run();
+	server = nullptr;
 
-		// ӱͷ
-		for (const auto& field : def.fields)
-		{
-			t.add(" " + field.name + " ");
-		}
-		t.endOfRow();
+	delete tm;
+	return ok ? 0 : 1;
+}
 
-		// 
-		for (const auto& row : results)
+// ͻģʽ䷢ִУ뱾ִͬʧܵ
+int runClient(DatabaseClient& client, const string& script, bool batch)
+{
+	if (batch)
+	{
+		vector<string> statements;
+		splitStatements(script, statements);
+		int failed = 0;
+		for (const auto& statement : statements)
 		{
-			for (const auto& value : row)
+			if (!runRemoteStatement(client, statement))
 			{
-				t.add(" " + value + " ");
+				failed++;
 			}
-			t.endOfRow();
 		}
-
-		cout << t << nextLineHeader;
+		return failed;
 	}
-	else
+
+	string cmd;
+	cout << nextLineHeader;
+	while (getline(cin, cmd) && cmd != ".exit")
 	{
-		cout << "> No records found" << nextLineHeader;
+		if (cmd == ".help")
+		{
+			printHelpMess();
+			continue;
+		}
+		runRemoteStatement(client, cmd);
 	}
+	cout << exitMessage;
+	return 0;
 }
 
-void processDropTable(const string& cmd)
+bool runRemoteStatement(DatabaseClient& client, const string& cmd)
 {
-	// DROP TABLE
-	string tableName = cmd.substr(11); // "DROP TABLE "
-	// еĿոͷֺ
-	size_t lastChar = tableName.find_last_not_of(" \t\r\n;");
-	if (lastChar != string::npos)
+	QueryResult result;
+	string message;
+	bool ok = client.execute(cmd, result, message);
+	if (message.empty())
 	{
-		tableName = tableName.substr(0, lastChar + 1);
+		printResults(result.headers, result.rows);
 	}
-	// ǰĿո
-	size_t firstChar = tableName.find_first_not_of(" \t\r\n");
-	if (firstChar != string::npos)
+	else
 	{
-		tableName = tableName.substr(firstChar);
+		cout << "> " << message << nextLineHeader;
 	}
+	return ok;
+}
+
+void printUsage(const char* program)
+{
+	cout << "usage: " << program << " [--db dir] [--file script.sql] [-c statement]... [--timing] [--verbose]" << endl
+		<< "       " << program << " [--db dir] --serve socket | --tcp port [--threads n] [--lock-wait ms] [--verbose]" << endl
+		<< "       " << program << " --connect socket | --connect-tcp port [--file script.sql] [-c statement]..." << endl
+		<< "  --db dir          database directory, default ./data/" << endl
+		<< "  --file script     run the statements in script and exit" << endl
+		<< "  -c statement      run one statement and exit, may be repeated" << endl
+		<< "  --timing          print wall and cpu time of each statement and the totals" << endl
+		<< "  --verbose         keep the engine's debug output in batch and server mode" << endl
+		<< "  --serve socket    serve clients on a Unix domain socket" << endl
+		<< "  --tcp port        serve clients on 127.0.0.1:port, may be combined with --serve" << endl
+		<< "  --threads n       statements executed at the same time, default 4" << endl
+		<< "  --lock-wait ms    how long a statement waits for another session's transaction, default 10000" << endl
+		<< "  --connect socket  run the statements on a server, --connect-tcp port for TCP" << endl
+		<< "without --file or -c the interactive shell is started" << endl;
+}
 
-	if (tm->dropTable(tableName))
+int main(int argc, char* argv[])
+{
+	string dbPath = "./data/";
+	string script;
+	bool batch = false;
+	bool timing = false;
+	bool verbose = false;
+	ServerOptions serverOptions;
+	string connectPath;
+	int connectPort = 0;
+
+	for (int i = 1; i < argc; i++)
 	{
-		cout << "> Table dropped successfully" << nextLineHeader;
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--db" && hasValue)
+		{
+			dbPath = argv[++i];
+			if (dbPath.back() != '/' && dbPath.back() != '\\')
+			{
+				dbPath += '/';
+			}
+		}
+		else if (arg == "--file" && hasValue)
+		{
+			ifstream ifs(argv[++i], ios::binary);
+			if (!ifs)
+			{
+				cerr << "Cannot open script: " << argv[i] << endl;
+				return 2;
+			}
+			stringstream ss;
+			ss << ifs.rdbuf();
+			script += ss.str();
+			script += ";\n";
+			batch = true;
+		}
+		else if (arg == "-c" && hasValue)
+		{
+			script += argv[++i];
+			script += ";\n";
+			batch = true;
+		}
+		else if (arg == "--timing")
+		{
+			timing = true;
+		}
+		else if (arg == "--verbose")
+		{
+			verbose = true;
+		}
+		else if (arg == "--serve" && hasValue)
+		{
+			serverOptions.socketPath = argv[++i];
+		}
+		else if (arg == "--tcp" && hasValue)
+		{
+			serverOptions.tcpPort = atoi(argv[++i]);
+		}
+		else if (arg == "--threads" && hasValue)
+		{
+			serverOptions.threads = static_cast<size_t>(max(atoi(argv[++i]), 1));
+		}
+		else if (arg == "--lock-wait" && hasValue)
+		{
+			serverOptions.lockWaitMs = max(atoi(argv[++i]), 0);
+		}
+		else if (arg == "--connect" && hasValue)
+		{
+			connectPath = argv[++i];
+		}
+		else if (arg == "--connect-tcp" && hasValue)
+		{
+			connectPort = atoi(argv[++i]);
+		}
+		else
+		{
+			printUsage(argv[0]);
+			return arg == "--help" ? 0 : 2;
+		}
 	}
-	else
+
+	if (!connectPath.empty() || connectPort != 0)
 	{
-		cout << "> Failed to drop table" << nextLineHeader;
+		DatabaseClient client;
+		if (!(connectPath.empty() ? client.connectTcp(connectPort) : client.connectUnix(connectPath)))
+		{
+			cerr << "Cannot connect to " << (connectPath.empty() ? "127.0.0.1:" + to_string(connectPort) : connectPath) << endl;
+			return 2;
+		}
+		if (batch)
+		{
+			nextLineHeader = "\n";
+		}
+		return runClient(client, script, batch) == 0 ? 0 : 1;
 	}
-}
 
-vector<string> splitString(const string& str, char delimiter)
-{
-	vector<string> tokens;
-	string token;
-	istringstream tokenStream(str);
+	if (!serverOptions.socketPath.empty() || serverOptions.tcpPort != 0)
+	{
+		return runServer(dbPath, serverOptions, verbose);
+	}
 
-	while (getline(tokenStream, token, delimiter))
+	if (!batch)
 	{
-		// ȥβո
-		token = token.substr(token.find_first_not_of(" "));
-		token = token.substr(0, token.find_last_not_of(" ") + 1);
-		if (!token.empty())
+		if (dbPath == "./data/")
 		{
-			tokens.push_back(token);
+			ensure_data_directory();
 		}
+		initialSystem(dbPath);
+		delete tm;
+		return 0;
 	}
 
-	return tokens;
-}
+	// ģʽÿһУʾʾ
+	nextLineHeader = "\n";
+	quietEngine = !verbose;
 
-void ensure_data_directory()
-{
-#ifdef _WIN32
-	_mkdir(".\\data");
-#else
-	mkdir("./data", 0777);
-#endif
-}
+	streambuf* out = cout.rdbuf();
+	if (quietEngine)
+	{
+		cout.rdbuf(nullptr); // رʱĵ
+	}
+	tm = new TableManager(dbPath);
+	cout.rdbuf(out);
+
+	int failed = runBatch(script, timing);
+	if (tm->inTransaction())
+	{
+		cout << "> Transaction not committed, changes discarded" << endl;
+	}
 
-int main(int argc, char* argv[])
-{
-	ensure_data_directory();
-	initialSystem();
 	delete tm;
-	return 0;
+	return failed == 0 ? 0 : 1;
 }
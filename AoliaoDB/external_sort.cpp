@@ -0,0 +1,372 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "external_sort.h"
+#include "field_codec.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <queue>
+
+bool SortKeyLayout::compile(const TableDef& def, const std::vector<OrderByItem>& orderBy)
+{
+    parts.clear();
+    keyWidth = 0;
+    for (const auto& item : orderBy)
+    {
+        int index = def.fieldIndex(item.field);
+        if (index < 0)
+        {
+            std::cerr << "Unknown field in ORDER BY: " << item.field << std::endl;
+            return false;
+        }
+
+        KeyPart part;
+        part.rowOffset = def.fieldOffset(index);
+        part.keyOffset = keyWidth;
+        part.column = def.layout.column(index);
+        part.field = part.column.field;
+        part.size = fieldWidth(part.field); // 䳤 VARCHAR ڼҲĳȲ
+        part.descending = item.descending;
+        part.nullable = part.column.nullBit >= 0;
+        parts.push_back(part);
+        keyWidth += part.nullable + part.size;
+    }
+    return !parts.empty();
+}
+
+void SortKeyLayout::extract(const char* row, size_t size, unsigned char* key) const
+{
+    for (const auto& part : parts)
+    {
+        unsigned char* dst = key + part.keyOffset;
+        if (part.nullable)
+        {
+            *dst++ = part.column.isNull(row);
+        }
+
+        if (part.nullable && dst[-1])
+        {
+            memset(dst, 0, part.size);
+        }
+        else if (part.column.variable || part.column.dictionary)
+        {
+            // ˳ֵ˳ֵҲַ
+            std::string_view text = part.column.text(row, size);
+            memcpy(dst, text.data(), text.size());
+            memset(dst + text.size(), 0, part.size - text.size());
+        }
+        else if (part.rowOffset + part.size > size)
+        {
+            memset(dst, 0, part.size);
+        }
+        else if (part.field.type != FieldType::VARCHAR)
+        {
+            encodeSortable(part.field, row + part.rowOffset, dst);
+        }
+        else
+        {
+            // VARCHAR β֮Ѿ㣬Ķ memcmp Ƚ strcmp һ
+            memcpy(dst, row + part.rowOffset, part.size);
+        }
+
+        if (part.descending)
+        {
+            dst = key + part.keyOffset;
+            for (size_t i = 0; i < part.nullable + part.size; i++)
+            {
+                dst[i] = static_cast<unsigned char>(~dst[i]);
+            }
+        }
+    }
+}
+
+ExternalSorter::ExternalSorter(const SortKeyLayout* layout, const std::string& runPrefix, size_t limit,
+    size_t rowSize)
+    : layout(layout), runPrefix(runPrefix), limit(limit), sequence(0), spare(0)
+{
+    entryKeyWidth = layout->width() + sizeof(unsigned long long);
+    slotWidth = entryKeyWidth + sizeof(size_t) + rowSize;
+
+    // ѼһʱĿŵýڴԤʱʹ top-N LIMIT / OFFSET ڴ
+    topN = limit != NO_LIMIT && rowSize > 0 &&
+        limit < SORT_MEMORY_BUDGET / (slotWidth + sizeof(size_t));
+}
+
+ExternalSorter::~ExternalSorter()
+{
+    removeRuns();
+}
+
+void ExternalSorter::makeKey(const char* row, size_t size, unsigned char* key)
+{
+    layout->extract(row, size, key);
+
+    // ŷڼ
+    unsigned long long seq = sequence++;
+    for (size_t i = 0; i < sizeof(seq); i++)
+    {
+        key[layout->width() + i] = static_cast<unsigned char>(seq >> (8 * (sizeof(seq) - 1 - i)));
+    }
+}
+
+bool ExternalSorter::addTopN(const char* row, size_t size)
+{
+    if (limit == 0)
+    {
+        return true;
+    }
+    if (entryKeyWidth + sizeof(size_t) + size > slotWidth)
+    {
+        std::cerr << "Sort row larger than the record size: " << size << std::endl;
+        return false;
+    }
+
+    auto less = [this](size_t a, size_t b)
+    {
+        return memcmp(&slots[a], &slots[b], entryKeyWidth) < 0;
+    };
+
+    // δʱĿ׷ӵ slots ĩβʱдʱĿ
+    size_t offset = spare;
+    if (heap.size() < limit)
+    {
+        offset = slots.size();
+        slots.resize(offset + slotWidth);
+    }
+
+    makeKey(row, size, reinterpret_cast<unsigned char*>(&slots[offset]));
+    memcpy(&slots[offset + entryKeyWidth], &size, sizeof(size_t));
+    memcpy(&slots[offset + entryKeyWidth + sizeof(size_t)], row, size);
+
+    if (heap.size() < limit)
+    {
+        heap.push_back(offset);
+        std::push_heap(heap.begin(), heap.end(), less);
+        if (heap.size() == limit)
+        {
+            spare = slots.size();
+            slots.resize(spare + slotWidth);
+        }
+    }
+    else if (less(offset, heap.front()))
+    {
+        // ʱֻбȶѶСļ¼ҪĿΪµʱĿ
+        std::pop_heap(heap.begin(), heap.end(), less);
+        spare = heap.back();
+        heap.back() = offset;
+        std::push_heap(heap.begin(), heap.end(), less);
+    }
+    return true;
+}
+
+bool ExternalSorter::add(const char* row, size_t size)
+{
+    if (topN)
+    {
+        return addTopN(row, size);
+    }
+
+    size_t offset = arena.size();
+    arena.resize(offset + entryKeyWidth + sizeof(size_t) + size);
+    makeKey(row, size, reinterpret_cast<unsigned char*>(&arena[offset]));
+    memcpy(&arena[offset + entryKeyWidth], &size, sizeof(size_t));
+    memcpy(&arena[offset + entryKeyWidth + sizeof(size_t)], row, size);
+    entries.push_back(offset);
+
+    if (arena.size() + entries.size() * sizeof(size_t) > SORT_MEMORY_BUDGET)
+    {
+        return writeRun();
+    }
+    return true;
+}
+
+void ExternalSorter::sortEntries()
+{
+    const char* base = arena.data();
+    size_t width = entryKeyWidth;
+    std::sort(entries.begin(), entries.end(), [base, width](size_t a, size_t b)
+        {
+            return memcmp(base + a, base + b, width) < 0;
+        });
+}
+
+bool ExternalSorter::writeRun()
+{
+    sortEntries();
+
+    std::string name = runPrefix + "run" + std::to_string(runFiles.size()) + ".tmp";
+    FILE* f = nullptr;
+#ifdef _WIN32
+    fopen_s(&f, name.c_str(), "wb");
+#else
+    f = fopen(name.c_str(), "wb");
+#endif
+    if (!f)
+    {
+        std::cerr << "Failed to create sort run: " << name << std::endl;
+        return false;
+    }
+    runFiles.push_back(name);
+
+    //  LIMIT ʱ limit ֮ļ¼ܽ
+    size_t count = 0;
+    for (size_t offset : entries)
+    {
+        if (count++ == limit)
+        {
+            break;
+        }
+        size_t len;
+        memcpy(&len, &arena[offset + entryKeyWidth], sizeof(size_t));
+        if (fwrite(&arena[offset], entryKeyWidth + sizeof(size_t) + len, 1, f) != 1)
+        {
+            std::cerr << "Failed to write sort run: " << name << std::endl;
+            fclose(f);
+            return false;
+        }
+    }
+    fclose(f);
+
+    std::cout << "Sort run " << name << ": " << std::min(entries.size(), limit) << " rows" << std::endl;
+    arena.clear();
+    entries.clear();
+    return true;
+}
+
+bool ExternalSorter::finish(const RowCallback& callback)
+{
+    if (topN)
+    {
+        auto less = [this](size_t a, size_t b)
+        {
+            return memcmp(&slots[a], &slots[b], entryKeyWidth) < 0;
+        };
+        std::sort_heap(heap.begin(), heap.end(), less);
+        for (size_t offset : heap)
+        {
+            size_t len;
+            memcpy(&len, &slots[offset + entryKeyWidth], sizeof(size_t));
+            if (!callback(&slots[offset + entryKeyWidth + sizeof(size_t)], len))
+            {
+                break;
+            }
+        }
+        heap.clear();
+        slots.clear();
+        return true;
+    }
+
+    if (runFiles.empty())
+    {
+        // ȫڴ
+        sortEntries();
+        size_t count = 0;
+        for (size_t offset : entries)
+        {
+            if (count++ == limit)
+            {
+                break;
+            }
+            size_t len;
+            memcpy(&len, &arena[offset + entryKeyWidth], sizeof(size_t));
+            if (!callback(&arena[offset + entryKeyWidth + sizeof(size_t)], len))
+            {
+                break;
+            }
+        }
+        return true;
+    }
+
+    if (!entries.empty() && !writeRun())
+    {
+        return false;
+    }
+    return mergeRuns(callback);
+}
+
+bool ExternalSorter::mergeRuns(const RowCallback& callback)
+{
+    struct RunReader
+    {
+        FILE* f;
+        std::vector<char> entry; // key + row
+    };
+
+    std::vector<RunReader> readers(runFiles.size());
+    auto readNext = [this](RunReader& r) -> bool
+    {
+        size_t len;
+        r.entry.resize(entryKeyWidth);
+        if (fread(r.entry.data(), entryKeyWidth, 1, r.f) != 1 ||
+            fread(&len, sizeof(size_t), 1, r.f) != 1)
+        {
+            return false;
+        }
+        r.entry.resize(entryKeyWidth + len);
+        return len == 0 || fread(r.entry.data() + entryKeyWidth, len, 1, r.f) == 1;
+    };
+
+    // СѣѶǵǰС
+    auto greater = [this, &readers](size_t a, size_t b)
+    {
+        return memcmp(readers[a].entry.data(), readers[b].entry.data(), entryKeyWidth) > 0;
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> queue(greater);
+
+    bool ok = true;
+    for (size_t i = 0; i < runFiles.size(); i++)
+    {
+        readers[i].f = nullptr;
+#ifdef _WIN32
+        fopen_s(&readers[i].f, runFiles[i].c_str(), "rb");
+#else
+        readers[i].f = fopen(runFiles[i].c_str(), "rb");
+#endif
+        if (!readers[i].f)
+        {
+            std::cerr << "Failed to open sort run: " << runFiles[i] << std::endl;
+            ok = false;
+            continue;
+        }
+        if (readNext(readers[i]))
+        {
+            queue.push(i);
+        }
+    }
+
+    std::cout << "Merging " << runFiles.size() << " sort runs" << std::endl;
+    size_t count = 0;
+    while (ok && !queue.empty() && count++ < limit)
+    {
+        size_t i = queue.top();
+        queue.pop();
+
+        RunReader& r = readers[i];
+        if (!callback(r.entry.data() + entryKeyWidth, r.entry.size() - entryKeyWidth))
+        {
+            break;
+        }
+        if (readNext(r))
+        {
+            queue.push(i);
+        }
+    }
+
+    for (auto& r : readers)
+    {
+        if (r.f)
+        {
+            fclose(r.f);
+        }
+    }
+    removeRuns();
+    return ok;
+}
+
+void ExternalSorter::removeRuns()
+{
+    for (const auto& name : runFiles)
+    {
+        remove(name.c_str());
+    }
+    runFiles.clear();
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include "query_def.h"
+#include "table_def.h"
+#include <functional>
+#include <stdio.h>
+
+/* memory budget of in-memory sort, write sorted runs to disk when exceeded */
+#ifndef SORT_MEMORY_BUDGET
+#define SORT_MEMORY_BUDGET (64 * 1024 * 1024)
+#endif
+
+// һÿתɿֱ memcmp Ƚϵֽڴ
+// ʹñ루 encodeSortableVARCHAR ʹòĶֽڣDESC аλȡ
+// Ϊ NULL ǰһֽڣNULL 󡢽ǰ
+class SortKeyLayout
+{
+public:
+    bool compile(const TableDef& def, const std::vector<OrderByItem>& orderBy);
+
+    size_t width() const
+    {
+        return keyWidth;
+    }
+
+    void extract(const char* row, size_t size, unsigned char* key) const;
+
+private:
+    struct KeyPart
+    {
+        size_t rowOffset;
+        size_t keyOffset;
+        size_t size;
+        FieldDef field;
+        ColumnLayout column;
+        bool descending;
+        bool nullable;
+    };
+
+    std::vector<KeyPart> parts;
+    size_t keyWidth = 0;
+};
+
+// ⲿڴа򣬳ڴԤʱдʱļ k ·鲢
+// ָ limit  limit ¼ŵýڴԤʱôСΪ limit Ķѣֻǰ N 
+// ȻдΣÿֻдǰ limit 
+class ExternalSorter
+{
+public:
+    typedef std::function<bool(const char*, size_t)> RowCallback;
+
+    // rowSize Ϊ¼ĴСڹ top-N ռõڴ
+    ExternalSorter(const SortKeyLayout* layout, const std::string& runPrefix, size_t limit = NO_LIMIT,
+        size_t rowSize = 0);
+    ~ExternalSorter();
+
+    bool add(const char* row, size_t size);
+
+    // ˳м¼callback  false ʱֹͣ
+    bool finish(const RowCallback& callback);
+
+private:
+    const SortKeyLayout* layout;
+    std::string runPrefix;
+    size_t limit;
+    size_t entryKeyWidth; //  + 8 ֽţű֤ȼɨ˳
+    unsigned long long sequence;
+
+    // Ŀʽ: | key | size_t len | row |
+    std::vector<char> arena;
+    std::vector<size_t> entries;
+    std::vector<std::string> runFiles;
+
+    // top-N ģʽslots ÿĿռ slotWidth ֽڣʽ arena ͬ
+    // heap ΪĿƫѣѶǵǰĿspare һ¼ʱĿ
+    bool topN;
+    size_t slotWidth;
+    std::vector<char> slots;
+    std::vector<size_t> heap;
+    size_t spare;
+
+    bool addTopN(const char* row, size_t size);
+
+    void makeKey(const char* row, size_t size, unsigned char* key);
+    void sortEntries();
+    bool writeRun();
+    bool mergeRuns(const RowCallback& callback);
+    void removeRuns();
+};
@@ -0,0 +1,419 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "field_codec.h"
+#include <charconv>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+static std::string_view trimSpaces(std::string_view text)
+{
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+    {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r'))
+    {
+        text.remove_suffix(1);
+    }
+    if (text.size() > 1 && text.front() == '+')
+    {
+        text.remove_prefix(1); // from_chars ǰ +
+    }
+    return text;
+}
+
+// ı뱻
+template <typename T>
+static bool parseNumber(std::string_view text, T& value)
+{
+    text = trimSpaces(text);
+    if (text.empty())
+    {
+        return false;
+    }
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+/* days since 1970-01-01 of a proleptic Gregorian date */
+static int daysFromCivil(int y, int m, int d)
+{
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static void civilFromDays(int z, int& y, int& m, int& d)
+{
+    z += 719468;
+    int era = (z >= 0 ? z : z - 146096) / 146097;
+    int doe = z - era * 146097;
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    d = doy - (153 * mp + 2) / 5 + 1;
+    m = mp < 10 ? mp + 3 : mp - 9;
+    y = yoe + era * 400 + (m <= 2);
+}
+
+// ڸʽ YYYY-MM-DD
+static bool parseDate(std::string_view text, int& days)
+{
+    text = trimSpaces(text);
+    size_t first = text.find('-', 1);
+    size_t second = first == std::string_view::npos ? first : text.find('-', first + 1);
+    if (second == std::string_view::npos)
+    {
+        return false;
+    }
+
+    int y, m, d;
+    if (!parseNumber(text.substr(0, first), y) ||
+        !parseNumber(text.substr(first + 1, second - first - 1), m) ||
+        !parseNumber(text.substr(second + 1), d))
+    {
+        return false;
+    }
+    if (y < 1 || y > 9999 || m < 1 || m > 12 || d < 1)
+    {
+        return false;
+    }
+
+    static const int monthDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    if (d > monthDays[m - 1] + (m == 2 && leap ? 1 : 0))
+    {
+        return false;
+    }
+    days = daysFromCivil(y, m, d);
+    return true;
+}
+
+static bool parseBoolean(std::string_view text, bool& value)
+{
+    text = trimSpaces(text);
+    std::string lower(text);
+    for (char& c : lower)
+    {
+        c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    }
+    if (lower == "true" || lower == "t" || lower == "1" || lower == "yes")
+    {
+        value = true;
+        return true;
+    }
+    if (lower == "false" || lower == "f" || lower == "0" || lower == "no")
+    {
+        value = false;
+        return true;
+    }
+    return false;
+}
+
+// ÿһԱ/뺯 fieldEncoder/fieldDecoder ѡ
+
+template <typename T>
+static bool encodeNumber(const FieldDef&, std::string_view text, char* out)
+{
+    T val;
+    if (!parseNumber(text, val))
+    {
+        return false;
+    }
+    std::memcpy(out, &val, sizeof(val));
+    return true;
+}
+
+template <typename T>
+static bool encodeReal(const FieldDef&, std::string_view text, char* out)
+{
+    T val;
+    if (!parseNumber(text, val) || std::isnan(val))
+    {
+        return false;
+    }
+    val = val == 0 ? T(0) : val; // -0  0 ͬ
+    std::memcpy(out, &val, sizeof(val));
+    return true;
+}
+
+static bool encodeBoolean(const FieldDef&, std::string_view text, char* out)
+{
+    bool val;
+    if (!parseBoolean(text, val))
+    {
+        return false;
+    }
+    *out = val ? 1 : 0;
+    return true;
+}
+
+static bool encodeDate(const FieldDef&, std::string_view text, char* out)
+{
+    int days;
+    if (!parseDate(text, days))
+    {
+        return false;
+    }
+    std::memcpy(out, &days, sizeof(days));
+    return true;
+}
+
+static bool encodeVarchar(const FieldDef& field, std::string_view text, char* out)
+{
+    size_t len = std::min(text.size(), field.size - 1);
+    std::memcpy(out, text.data(), len);
+    std::memset(out + len, 0, field.size - len);
+    return true;
+}
+
+// ̵Ŀɻԭʾ
+template <typename T>
+static void decodeNumber(const FieldDef&, const char* data, std::string& out)
+{
+    T val;
+    std::memcpy(&val, data, sizeof(val));
+    char buf[32];
+    out.append(buf, std::to_chars(buf, buf + sizeof(buf), val).ptr);
+}
+
+static void decodeBoolean(const FieldDef&, const char* data, std::string& out)
+{
+    out += *data ? "true" : "false";
+}
+
+static void decodeDate(const FieldDef&, const char* data, std::string& out)
+{
+    int days, y, m, d;
+    std::memcpy(&days, data, sizeof(days));
+    civilFromDays(days, y, m, d);
+    char buf[16];
+    out.append(buf, snprintf(buf, sizeof(buf), "%04d-%02d-%02d", y, m, d));
+}
+
+static void decodeVarchar(const FieldDef& field, const char* data, std::string& out)
+{
+    out.append(data, strnlen(data, field.size - 1));
+}
+
+FieldEncoder fieldEncoder(FieldType type)
+{
+    switch (type)
+    {
+    case FieldType::INT:
+        return encodeNumber<int>;
+    case FieldType::BIGINT:
+        return encodeNumber<long long>;
+    case FieldType::FLOAT:
+        return encodeReal<float>;
+    case FieldType::DOUBLE:
+        return encodeReal<double>;
+    case FieldType::BOOLEAN:
+        return encodeBoolean;
+    case FieldType::DATE:
+        return encodeDate;
+    default:
+        return encodeVarchar;
+    }
+}
+
+FieldDecoder fieldDecoder(FieldType type)
+{
+    switch (type)
+    {
+    case FieldType::INT:
+        return decodeNumber<int>;
+    case FieldType::BIGINT:
+        return decodeNumber<long long>;
+    case FieldType::FLOAT:
+        return decodeNumber<float>;
+    case FieldType::DOUBLE:
+        return decodeNumber<double>;
+    case FieldType::BOOLEAN:
+        return decodeBoolean;
+    case FieldType::DATE:
+        return decodeDate;
+    default:
+        return decodeVarchar;
+    }
+}
+
+bool encodeField(const FieldDef& field, std::string_view text, char* out)
+{
+    return fieldEncoder(field.type)(field, text, out);
+}
+
+void appendField(const FieldDef& field, const char* data, std::string& out)
+{
+    fieldDecoder(field.type)(field, data, out);
+}
+
+std::string decodeField(const FieldDef& field, const char* data)
+{
+    std::string text;
+    appendField(field, data, text);
+    return text;
+}
+
+template <typename T>
+static int compareValues(const char* a, const char* b)
+{
+    T x, y;
+    std::memcpy(&x, a, sizeof(T));
+    std::memcpy(&y, b, sizeof(T));
+    return x < y ? -1 : (y < x ? 1 : 0);
+}
+
+int compareField(const FieldDef& field, const char* a, const char* b)
+{
+    switch (field.type)
+    {
+    case FieldType::INT:
+    case FieldType::DATE:
+        return compareValues<int>(a, b);
+    case FieldType::BIGINT:
+        return compareValues<long long>(a, b);
+    case FieldType::FLOAT:
+        return compareValues<float>(a, b);
+    case FieldType::DOUBLE:
+        return compareValues<double>(a, b);
+    case FieldType::BOOLEAN:
+        return compareValues<unsigned char>(a, b);
+    case FieldType::VARCHAR:
+    {
+        size_t lenA = strnlen(a, field.size);
+        size_t lenB = strnlen(b, field.size);
+        int cmp = memcmp(a, b, std::min(lenA, lenB));
+        if (cmp == 0 && lenA != lenB)
+        {
+            cmp = lenA < lenB ? -1 : 1;
+        }
+        return cmp;
+    }
+    }
+    return 0;
+}
+
+// ת޷󰴴СȽϼɵõֵ˳
+static uint32_t sortable32(const FieldDef& field, const char* data)
+{
+    uint32_t bits;
+    std::memcpy(&bits, data, sizeof(bits));
+    if (field.type == FieldType::FLOAT)
+    {
+        return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+    }
+    return bits ^ 0x80000000u;
+}
+
+static uint64_t sortable64(const FieldDef& field, const char* data)
+{
+    uint64_t bits;
+    std::memcpy(&bits, data, sizeof(bits));
+    const uint64_t sign = 1ull << 63;
+    if (field.type == FieldType::DOUBLE)
+    {
+        return (bits & sign) ? ~bits : bits | sign;
+    }
+    return bits ^ sign;
+}
+
+void encodeSortable(const FieldDef& field, const char* data, unsigned char* out)
+{
+    size_t width = fieldWidth(field);
+    if (width == 8)
+    {
+        uint64_t key = sortable64(field, data);
+        for (int i = 7; i >= 0; i--, key >>= 8)
+        {
+            out[i] = static_cast<unsigned char>(key);
+        }
+    }
+    else if (width == 4)
+    {
+        uint32_t key = sortable32(field, data);
+        for (int i = 3; i >= 0; i--, key >>= 8)
+        {
+            out[i] = static_cast<unsigned char>(key);
+        }
+    }
+    else
+    {
+        out[0] = static_cast<unsigned char>(*data);
+    }
+}
+
+std::string orderedKeyText(const FieldDef& field, const char* data)
+{
+    char buf[16];
+    switch (fieldWidth(field))
+    {
+    case 8:
+    {
+        // 64 λŲʮƵ 15 ַ 13 λ 32 ƣĸ ASCII 
+        static const char digits[] = "0123456789ABCDEFGHIJKLMNOPQRSTUV";
+        uint64_t key = sortable64(field, data);
+        for (int i = 12; i >= 0; i--, key >>= 5)
+        {
+            buf[i] = digits[key & 31];
+        }
+        buf[13] = '\0';
+        break;
+    }
+    case 4:
+        snprintf(buf, sizeof(buf), "%010u", sortable32(field, data));
+        break;
+    default:
+        buf[0] = *data ? '1' : '0';
+        buf[1] = '\0';
+        break;
+    }
+    return buf;
+}
+
+long long fieldAsInteger(const FieldDef& field, const char* data)
+{
+    switch (field.type)
+    {
+    case FieldType::BIGINT:
+    {
+        long long val;
+        std::memcpy(&val, data, sizeof(val));
+        return val;
+    }
+    case FieldType::BOOLEAN:
+        return *data ? 1 : 0;
+    default:
+    {
+        int val;
+        std::memcpy(&val, data, sizeof(val));
+        return val;
+    }
+    }
+}
+
+double fieldAsDouble(const FieldDef& field, const char* data)
+{
+    switch (field.type)
+    {
+    case FieldType::FLOAT:
+    {
+        float val;
+        std::memcpy(&val, data, sizeof(val));
+        return val;
+    }
+    case FieldType::DOUBLE:
+    {
+        double val;
+        std::memcpy(&val, data, sizeof(val));
+        return val;
+    }
+    default:
+        return static_cast<double>(fieldAsInteger(field, data));
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include "row_layout.h"
+#include <string>
+#include <string_view>
+
+// ֵֶĶƱ룺ͰֽȻţVARCHAR Ϊ '\0' βĶ
+// Ƚ϶νʡۺϡ򡢵뵼ͬһ׹
+
+// ѡı/뺯RowLayout Ϊÿбһ
+FieldEncoder fieldEncoder(FieldType type);
+FieldDecoder fieldDecoder(FieldType type);
+
+// ıֶεĶֵд fieldWidth(field) ֽڣıϷ false
+bool encodeField(const FieldDef& field, std::string_view text, char* out);
+
+// ֵתı׷ӵ out 
+void appendField(const FieldDef& field, const char* data, std::string& out);
+
+std::string decodeField(const FieldDef& field, const char* data);
+
+// ȽͬһֶεĶֵ <0 / 0 / >0
+int compareField(const FieldDef& field, const char* a, const char* b);
+
+// ͵ı룺ֽתλ㰴 IEEE ת
+// memcmp ˳ֵ˳д fieldWidth(field) ֽڣVARCHAR 
+void encodeSortable(const FieldDef& field, const char* data, unsigned char* out);
+
+// ļıͬһ͵ļͬkeycmp ˳ֵ˳
+// INT/DATE/FLOAT ΪʮλʮƣBIGINT/DOUBLE Ϊ 13 λ 32 ƣBOOLEAN Ϊһλ
+std::string orderedKeyText(const FieldDef& field, const char* data);
+
+// SUM/AVG õֵ
+inline bool isNumericType(FieldType type)
+{
+    return type == FieldType::INT || type == FieldType::BIGINT ||
+        type == FieldType::FLOAT || type == FieldType::DOUBLE;
+}
+
+// ͵ֵINT/BIGINT/BOOLEAN/DATE
+long long fieldAsInteger(const FieldDef& field, const char* data);
+
+// ֵ͵ֵ
+double fieldAsDouble(const FieldDef& field, const char* data);
@@ -0,0 +1,394 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "group_by.h"
+#include "field_codec.h"
+#include <iostream>
+
+bool GroupKeyLayout::compile(const TableDef& def, const std::vector<std::string>& columns)
+{
+    parts.clear();
+    keyWidth = 0;
+    for (const auto& column : columns)
+    {
+        int index = def.fieldIndex(column);
+        if (index < 0)
+        {
+            std::cerr << "Unknown field in GROUP BY: " << column << std::endl;
+            return false;
+        }
+
+        KeyPart part;
+        part.rowOffset = def.fieldOffset(index);
+        part.column = def.layout.column(index);
+        part.field = part.column.field;
+        part.nullable = part.column.nullBit >= 0;
+        part.keyOffset = keyWidth + part.nullable;
+        // ֱֵñ䳤 VARCHAR ڼаĳȲ
+        part.size = part.column.dictionary ? part.column.width : fieldWidth(part.field);
+        parts.push_back(part);
+        keyWidth += part.nullable;
+        keyWidth += part.size;
+    }
+    return !parts.empty();
+}
+
+void GroupKeyLayout::extract(const char* row, size_t size, char* key) const
+{
+    for (const auto& part : parts)
+    {
+        if (part.nullable)
+        {
+            bool null = part.column.isNull(row);
+            key[part.keyOffset - 1] = null;
+            if (null)
+            {
+                memset(key + part.keyOffset, 0, part.size);
+                continue;
+            }
+        }
+
+        if (part.column.variable)
+        {
+            // 䳤 VARCHAR ƵĶλã붨ֵļͬ
+            std::string_view text = part.column.text(row, size);
+            memcpy(key + part.keyOffset, text.data(), text.size());
+            memset(key + part.keyOffset + text.size(), 0, part.size - text.size());
+        }
+        // serializeValues  VARCHAR βֽ֮㣬ԭʼֽڿֱΪ
+        else if (part.rowOffset + part.size <= size)
+        {
+            memcpy(key + part.keyOffset, row + part.rowOffset, part.size);
+        }
+        else
+        {
+            memset(key + part.keyOffset, 0, part.size);
+        }
+    }
+}
+
+std::vector<std::string> GroupKeyLayout::decode(const char* key) const
+{
+    std::vector<std::string> values;
+    for (const auto& part : parts)
+    {
+        bool null = part.nullable && key[part.keyOffset - 1];
+        if (null)
+        {
+            values.push_back("NULL");
+        }
+        else if (part.column.dictionary)
+        {
+            uint16_t code;
+            memcpy(&code, key + part.keyOffset, sizeof(code));
+            values.push_back(std::string(part.column.dictionary->at(code)));
+        }
+        else
+        {
+            values.push_back(decodeField(part.field, key + part.keyOffset));
+        }
+    }
+    return values;
+}
+
+GroupHashTable::GroupHashTable(size_t keyWidth, const AggregateEvaluator* evaluator)
+    : keyWidth(keyWidth), evaluator(evaluator)
+{
+    slotSize = sizeof(uint64_t) + sizeof(size_t) + ((keyWidth + 7) & ~7);
+    clear();
+}
+
+uint64_t GroupHashTable::hashKey(const char* key, size_t len)
+{
+    // FNV-1a
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= static_cast<unsigned char>(key[i]);
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+size_t GroupHashTable::findOrInsert(const char* key, uint64_t hash)
+{
+    size_t mask = capacity - 1;
+    size_t slot = hash & mask;
+    while (true)
+    {
+        char* p = &slots[slot * slotSize];
+        size_t g;
+        memcpy(&g, p + sizeof(uint64_t), sizeof(size_t));
+
+        if (g == 0)
+        {
+            // ղλ·
+            size_t group = groupSlots.size();
+            size_t stored = group + 1;
+            memcpy(p, &hash, sizeof(uint64_t));
+            memcpy(p + sizeof(uint64_t), &stored, sizeof(size_t));
+            memcpy(p + sizeof(uint64_t) + sizeof(size_t), key, keyWidth);
+            groupSlots.push_back(slot);
+            if (evaluator)
+            {
+                aggStates.resize(aggStates.size() + evaluator->size());
+            }
+
+            // ӳ 0.7 ʱ
+            if (groupSlots.size() * 10 >= capacity * 7)
+            {
+                grow();
+            }
+            return group;
+        }
+
+        if (slotHash(slot) == hash && memcmp(slotKey(slot), key, keyWidth) == 0)
+        {
+            return g - 1;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+size_t GroupHashTable::find(const char* key, uint64_t hash) const
+{
+    size_t mask = capacity - 1;
+    size_t slot = hash & mask;
+    while (true)
+    {
+        size_t g = slotGroup(slot);
+        if (g == 0)
+        {
+            return NOT_FOUND;
+        }
+        if (slotHash(slot) == hash && memcmp(slotKey(slot), key, keyWidth) == 0)
+        {
+            return g - 1;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+void GroupHashTable::grow()
+{
+    std::vector<char> old;
+    old.swap(slots);
+    capacity *= 2;
+    slots.assign(capacity * slotSize, 0);
+
+    size_t mask = capacity - 1;
+    for (size_t group = 0; group < groupSlots.size(); group++)
+    {
+        const char* src = &old[groupSlots[group] * slotSize];
+        uint64_t h;
+        memcpy(&h, src, sizeof(uint64_t));
+
+        size_t slot = h & mask;
+        while (slotGroup(slot) != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        memcpy(&slots[slot * slotSize], src, slotSize);
+        groupSlots[group] = slot;
+    }
+}
+
+size_t GroupHashTable::memoryUsage() const
+{
+    return slots.size() + groupSlots.size() * sizeof(size_t) +
+        aggStates.size() * sizeof(AggregateState);
+}
+
+void GroupHashTable::clear()
+{
+    capacity = 1024;
+    slots.assign(capacity * slotSize, 0);
+    groupSlots.clear();
+    aggStates.clear();
+}
+
+GroupAggregator::GroupAggregator(const GroupKeyLayout* layout, const AggregateEvaluator* evaluator,
+    size_t workers, const std::string& spillPrefix)
+    : layout(layout), evaluator(evaluator), spillPrefix(spillPrefix)
+{
+    workers = std::max<size_t>(workers, 1);
+    for (size_t i = 0; i < workers; i++)
+    {
+        locals.push_back(new LocalState(layout->width(), evaluator));
+    }
+
+    // ԤҪɿձĳʼλÿһ鶼
+    workerBudget = std::max<size_t>(GROUP_BY_MEMORY_BUDGET / workers,
+        2 * locals[0]->table.memoryUsage());
+}
+
+GroupAggregator::~GroupAggregator()
+{
+    removeSpillFiles();
+    for (auto* local : locals)
+    {
+        delete local;
+    }
+    locals.clear();
+}
+
+bool GroupAggregator::accumulate(size_t worker, const char* row, size_t size)
+{
+    LocalState& local = *locals[worker];
+    layout->extract(row, size, local.keyBuffer.data());
+
+    uint64_t h = GroupHashTable::hashKey(local.keyBuffer.data(), layout->width());
+    size_t group = local.table.findOrInsert(local.keyBuffer.data(), h);
+    evaluator->accumulate(local.table.states(group), row, size);
+
+    if (local.table.memoryUsage() > workerBudget)
+    {
+        return spill(worker);
+    }
+    return true;
+}
+
+std::string GroupAggregator::spillFileName(size_t worker, size_t partition) const
+{
+    return spillPrefix + "w" + std::to_string(worker) + "_p" + std::to_string(partition) + ".tmp";
+}
+
+bool GroupAggregator::spill(size_t worker)
+{
+    LocalState& local = *locals[worker];
+
+    if (local.spillFiles.empty())
+    {
+        for (size_t p = 0; p < GROUP_BY_SPILL_PARTITIONS; p++)
+        {
+            std::string name = spillFileName(worker, p);
+            FILE* f = nullptr;
+#ifdef _WIN32
+            fopen_s(&f, name.c_str(), "wb+");
+#else
+            f = fopen(name.c_str(), "wb+");
+#endif
+            if (!f)
+            {
+                std::cerr << "Failed to create spill file: " << name << std::endl;
+                return false;
+            }
+            local.spillFiles.push_back(f);
+        }
+    }
+
+    // ùϣĸλλڱڶλ
+    for (size_t g = 0; g < local.table.size(); g++)
+    {
+        uint64_t h = local.table.hash(g);
+        FILE* f = local.spillFiles[(h >> 60) % GROUP_BY_SPILL_PARTITIONS];
+        if (fwrite(&h, sizeof(uint64_t), 1, f) != 1 ||
+            fwrite(local.table.key(g), layout->width(), 1, f) != 1 ||
+            !evaluator->writeStates(f, local.table.states(g)))
+        {
+            std::cerr << "Failed to write spill file" << std::endl;
+            return false;
+        }
+    }
+
+    local.spilledGroups += local.table.size();
+    std::cout << "Worker " << worker << " spilled " << local.table.size()
+        << " groups (" << local.spilledGroups << " total)" << std::endl;
+    local.table.clear();
+    return true;
+}
+
+void GroupAggregator::emit(GroupHashTable& table, std::vector<std::vector<std::string>>& results) const
+{
+    for (size_t g = 0; g < table.size(); g++)
+    {
+        std::vector<std::string> row = layout->decode(table.key(g));
+        std::vector<std::string> aggs = evaluator->finalize(table.states(g));
+        row.insert(row.end(), aggs.begin(), aggs.end());
+        results.push_back(std::move(row));
+    }
+}
+
+bool GroupAggregator::finish(std::vector<std::vector<std::string>>& results)
+{
+    bool spilled = false;
+    for (auto* local : locals)
+    {
+        spilled = spilled || !local->spillFiles.empty();
+    }
+
+    if (!spilled)
+    {
+        // ȫڴУ̵߳ıرϲһ
+        GroupHashTable& target = locals[0]->table;
+        for (size_t w = 1; w < locals.size(); w++)
+        {
+            GroupHashTable& source = locals[w]->table;
+            for (size_t g = 0; g < source.size(); g++)
+            {
+                size_t to = target.findOrInsert(source.key(g), source.hash(g));
+                evaluator->merge(target.states(to), source.states(g));
+            }
+            source.clear();
+        }
+        emit(target, results);
+        return true;
+    }
+
+    // ʣıرҲдȻϲÿֻһڴ
+    for (size_t w = 0; w < locals.size(); w++)
+    {
+        if (locals[w]->table.size() > 0 && !spill(w))
+        {
+            return false;
+        }
+    }
+
+    GroupHashTable table(layout->width(), evaluator);
+    std::vector<char> key(layout->width());
+    std::vector<AggregateState> states(evaluator->size());
+
+    for (size_t p = 0; p < GROUP_BY_SPILL_PARTITIONS; p++)
+    {
+        table.clear();
+        for (auto* local : locals)
+        {
+            if (local->spillFiles.empty())
+            {
+                continue;
+            }
+
+            FILE* f = local->spillFiles[p];
+            fflush(f);
+            rewind(f);
+
+            uint64_t h;
+            while (fread(&h, sizeof(uint64_t), 1, f) == 1)
+            {
+                if (fread(key.data(), layout->width(), 1, f) != 1 ||
+                    !evaluator->readStates(f, states.data()))
+                {
+                    std::cerr << "Corrupted spill file, partition " << p << std::endl;
+                    return false;
+                }
+                size_t group = table.findOrInsert(key.data(), h);
+                evaluator->merge(table.states(group), states.data());
+            }
+        }
+        emit(table, results);
+    }
+
+    removeSpillFiles();
+    return true;
+}
+
+void GroupAggregator::removeSpillFiles()
+{
+    for (size_t w = 0; w < locals.size(); w++)
+    {
+        for (size_t p = 0; p < locals[w]->spillFiles.size(); p++)
+        {
+            fclose(locals[w]->spillFiles[p]);
+            remove(spillFileName(w, p).c_str());
+        }
+        locals[w]->spillFiles.clear();
+    }
+}
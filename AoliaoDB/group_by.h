@@ -0,0 +1,159 @@
+#pragma once
+#include "aggregate.h"
+#include <stdint.h>
+#include <string.h>
+
+/* memory budget of all hash tables, spill to disk when exceeded */
+#ifndef GROUP_BY_MEMORY_BUDGET
+#define GROUP_BY_MEMORY_BUDGET (64 * 1024 * 1024)
+#endif
+
+/* how many partitions a spilled hash table is split into */
+#define GROUP_BY_SPILL_PARTITIONS 16
+
+// ֶ֣εԭʼֽڰ˳ƴӳɶΪ NULL ǰһֽ
+class GroupKeyLayout
+{
+public:
+    bool compile(const TableDef& def, const std::vector<std::string>& columns);
+
+    size_t width() const
+    {
+        return keyWidth;
+    }
+
+    // ӶƼ¼ȡ
+    void extract(const char* row, size_t size, char* key) const;
+
+    // ѷԭַ
+    std::vector<std::string> decode(const char* key) const;
+
+private:
+    struct KeyPart
+    {
+        size_t rowOffset;
+        size_t keyOffset;
+        size_t size;
+        FieldDef field;
+        ColumnLayout column;
+        bool nullable; // ֵǰһ NULL ֽڣNULL Գһ
+    };
+
+    std::vector<KeyPart> parts;
+    size_t keyWidth = 0;
+};
+
+// Ѱַ̽⣩ϣ洢ڲλУ
+// ̽ʱȱȽϹϣֵٱȽϼҪָת
+// evaluator Ϊʱֻά  -> ± ӳ䣨ϣʹã
+class GroupHashTable
+{
+public:
+    GroupHashTable(size_t keyWidth, const AggregateEvaluator* evaluator);
+
+    // ط±꣬ʱ·
+    size_t findOrInsert(const char* key, uint64_t hash);
+
+    // ֻңڷ NOT_FOUND
+    static const size_t NOT_FOUND = (size_t)-1;
+    size_t find(const char* key, uint64_t hash) const;
+
+    size_t size() const
+    {
+        return groupSlots.size();
+    }
+
+    const char* key(size_t group) const
+    {
+        return slotKey(groupSlots[group]);
+    }
+
+    uint64_t hash(size_t group) const
+    {
+        return slotHash(groupSlots[group]);
+    }
+
+    AggregateState* states(size_t group)
+    {
+        return &aggStates[group * evaluator->size()];
+    }
+
+    // ڴռãֽڣ
+    size_t memoryUsage() const;
+
+    void clear();
+
+    static uint64_t hashKey(const char* key, size_t len);
+
+private:
+    // λ: | hash (8) | group + 1 (8) | key (keyWidth8ֽڲ) |
+    size_t keyWidth;
+    size_t slotSize;
+    size_t capacity;
+    const AggregateEvaluator* evaluator;
+    std::vector<char> slots;
+    std::vector<size_t> groupSlots; // ± -> λ±
+    std::vector<AggregateState> aggStates;
+
+    uint64_t slotHash(size_t slot) const
+    {
+        uint64_t h;
+        memcpy(&h, &slots[slot * slotSize], sizeof(uint64_t));
+        return h;
+    }
+
+    size_t slotGroup(size_t slot) const
+    {
+        size_t g;
+        memcpy(&g, &slots[slot * slotSize + sizeof(uint64_t)], sizeof(size_t));
+        return g;
+    }
+
+    const char* slotKey(size_t slot) const
+    {
+        return &slots[slot * slotSize + sizeof(uint64_t) + sizeof(size_t)];
+    }
+
+    void grow();
+};
+
+// ۺϣÿ߳ӵбعϣڴԤʱϣʱļ
+// ϲ
+class GroupAggregator
+{
+public:
+    GroupAggregator(const GroupKeyLayout* layout, const AggregateEvaluator* evaluator,
+        size_t workers, const std::string& spillPrefix);
+    ~GroupAggregator();
+
+    // ̵߳ãֻԼı״̬
+    bool accumulate(size_t worker, const char* row, size_t size);
+
+    // ϲ̵߳ĽÿΪ  + ۺ
+    bool finish(std::vector<std::vector<std::string>>& results);
+
+private:
+    struct LocalState
+    {
+        GroupHashTable table;
+        std::vector<char> keyBuffer;
+        std::vector<FILE*> spillFiles;
+        size_t spilledGroups;
+
+        LocalState(size_t keyWidth, const AggregateEvaluator* evaluator)
+            : table(keyWidth, evaluator), keyBuffer(keyWidth), spilledGroups(0)
+        {
+        }
+    };
+
+    const GroupKeyLayout* layout;
+    const AggregateEvaluator* evaluator;
+    std::string spillPrefix;
+    size_t workerBudget;
+    std::vector<LocalState*> locals;
+
+    std::string spillFileName(size_t worker, size_t partition) const;
+    bool spill(size_t worker);
+    void emit(GroupHashTable& table, std::vector<std::vector<std::string>>& results) const;
+    void removeSpillFiles();
+};
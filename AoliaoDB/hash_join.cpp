@@ -0,0 +1,279 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "hash_join.h"
+#include <algorithm>
+#include <iostream>
+
+bool JoinKeyColumn::compile(const TableDef& def, const std::string& field)
+{
+    int index = def.fieldIndex(field);
+    if (index < 0)
+    {
+        std::cerr << "Unknown field in JOIN: " << def.tableName << "." << field << std::endl;
+        return false;
+    }
+    layout = def.layout.column(index);
+    offset = layout.offset;
+    this->field = layout.field;
+    size = fieldWidth(this->field);
+    return true;
+}
+
+HashJoiner::HashJoiner(const JoinKeyColumn& buildKey, const JoinKeyColumn& probeKey,
+    const std::string& spillPrefix)
+    : buildKey(buildKey), probeKey(probeKey),
+    keyWidth(std::max(buildKey.size, probeKey.size)), spillPrefix(spillPrefix),
+    table(keyWidth, nullptr), keyBuffer(keyWidth)
+{
+}
+
+HashJoiner::~HashJoiner()
+{
+    removeSpillFiles();
+}
+
+void HashJoiner::extractKey(const JoinKeyColumn& column, const char* row, size_t size, char* key) const
+{
+    memset(key, 0, keyWidth);
+    if (column.offset >= size)
+    {
+        return;
+    }
+
+    if (column.field.type != FieldType::VARCHAR)
+    {
+        memcpy(key, row + column.offset, std::min(column.size, size - column.offset));
+    }
+    else
+    {
+        //  VARCHAR ȺͲֿԲֻͬȡݱ
+        std::string_view text = column.layout.text(row, size);
+        memcpy(key, text.data(), std::min(text.size(), keyWidth));
+    }
+}
+
+void HashJoiner::insertRow(const char* row, size_t size, uint64_t hash)
+{
+    size_t index = rowOffsets.size();
+    rowOffsets.push_back(arena.size());
+    arena.insert(arena.end(), reinterpret_cast<const char*>(&size),
+        reinterpret_cast<const char*>(&size) + sizeof(size_t));
+    arena.insert(arena.end(), row, row + size);
+
+    size_t group = table.findOrInsert(keyBuffer.data(), hash);
+    if (group == heads.size())
+    {
+        heads.push_back(0);
+    }
+    nextRow.push_back(heads[group]);
+    heads[group] = index + 1;
+}
+
+void HashJoiner::probeTable(const char* row, size_t size, uint64_t hash, const JoinCallback& callback)
+{
+    size_t group = table.find(keyBuffer.data(), hash);
+    if (group == GroupHashTable::NOT_FOUND)
+    {
+        return;
+    }
+
+    for (size_t r = heads[group]; r != 0; r = nextRow[r - 1])
+    {
+        const char* entry = &arena[rowOffsets[r - 1]];
+        size_t buildSize;
+        memcpy(&buildSize, entry, sizeof(size_t));
+        callback(entry + sizeof(size_t), buildSize, row, size);
+    }
+}
+
+size_t HashJoiner::memoryUsage() const
+{
+    return table.memoryUsage() + arena.size() +
+        (rowOffsets.size() + nextRow.size() + heads.size()) * sizeof(size_t);
+}
+
+void HashJoiner::clearTable()
+{
+    table.clear();
+    arena.clear();
+    rowOffsets.clear();
+    nextRow.clear();
+    heads.clear();
+}
+
+bool HashJoiner::build(const char* row, size_t size)
+{
+    // NULL κֵΪ NULL ļ¼
+    if (buildKey.layout.isNull(row))
+    {
+        return true;
+    }
+    extractKey(buildKey, row, size, keyBuffer.data());
+    uint64_t h = GroupHashTable::hashKey(keyBuffer.data(), keyWidth);
+
+    if (spilled())
+    {
+        return writeRow(buildFiles[(h >> 60) % JOIN_SPILL_PARTITIONS], h, row, size);
+    }
+
+    insertRow(row, size, h);
+    if (memoryUsage() > JOIN_MEMORY_BUDGET)
+    {
+        return spill();
+    }
+    return true;
+}
+
+bool HashJoiner::probe(const char* row, size_t size, const JoinCallback& callback)
+{
+    if (probeKey.layout.isNull(row))
+    {
+        return true;
+    }
+    extractKey(probeKey, row, size, keyBuffer.data());
+    uint64_t h = GroupHashTable::hashKey(keyBuffer.data(), keyWidth);
+
+    if (spilled())
+    {
+        return writeRow(probeFiles[(h >> 60) % JOIN_SPILL_PARTITIONS], h, row, size);
+    }
+
+    probeTable(row, size, h, callback);
+    return true;
+}
+
+std::string HashJoiner::spillFileName(const char* side, size_t partition) const
+{
+    return spillPrefix + side + "_p" + std::to_string(partition) + ".tmp";
+}
+
+bool HashJoiner::openSpillFiles(const char* side, std::vector<FILE*>& files)
+{
+    for (size_t p = 0; p < JOIN_SPILL_PARTITIONS; p++)
+    {
+        std::string name = spillFileName(side, p);
+        FILE* f = nullptr;
+#ifdef _WIN32
+        fopen_s(&f, name.c_str(), "wb+");
+#else
+        f = fopen(name.c_str(), "wb+");
+#endif
+        if (!f)
+        {
+            std::cerr << "Failed to create spill file: " << name << std::endl;
+            return false;
+        }
+        files.push_back(f);
+    }
+    return true;
+}
+
+bool HashJoiner::writeRow(FILE* fp, uint64_t hash, const char* row, size_t size)
+{
+    if (fwrite(&hash, sizeof(uint64_t), 1, fp) != 1 ||
+        fwrite(&size, sizeof(size_t), 1, fp) != 1 ||
+        fwrite(row, size, 1, fp) != 1)
+    {
+        std::cerr << "Failed to write spill file" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool HashJoiner::spill()
+{
+    if (!openSpillFiles("build", buildFiles) || !openSpillFiles("probe", probeFiles))
+    {
+        return false;
+    }
+
+    // ڴе build ¼ϣĸλд֮ļ¼ֱд
+    for (size_t group = 0; group < table.size(); group++)
+    {
+        uint64_t h = table.hash(group);
+        FILE* f = buildFiles[(h >> 60) % JOIN_SPILL_PARTITIONS];
+        for (size_t r = heads[group]; r != 0; r = nextRow[r - 1])
+        {
+            const char* entry = &arena[rowOffsets[r - 1]];
+            size_t size;
+            memcpy(&size, entry, sizeof(size_t));
+            if (!writeRow(f, h, entry + sizeof(size_t), size))
+            {
+                return false;
+            }
+        }
+    }
+
+    std::cout << "Hash join spilled " << rowOffsets.size() << " build rows" << std::endl;
+    clearTable();
+    return true;
+}
+
+bool HashJoiner::finish(const JoinCallback& callback)
+{
+    if (!spilled())
+    {
+        return true;
+    }
+
+    std::vector<char> row;
+    for (size_t p = 0; p < JOIN_SPILL_PARTITIONS; p++)
+    {
+        // ÿֻһ build ڴУԳԤʱҲ
+        clearTable();
+        bool isBuild = true;
+        for (FILE* f : {buildFiles[p], probeFiles[p]})
+        {
+            fflush(f);
+            rewind(f);
+
+            uint64_t h;
+            size_t size;
+            while (fread(&h, sizeof(uint64_t), 1, f) == 1)
+            {
+                if (fread(&size, sizeof(size_t), 1, f) != 1)
+                {
+                    std::cerr << "Corrupted spill file, partition " << p << std::endl;
+                    return false;
+                }
+                row.resize(std::max<size_t>(size, 1));
+                if (size > 0 && fread(row.data(), size, 1, f) != 1)
+                {
+                    std::cerr << "Corrupted spill file, partition " << p << std::endl;
+                    return false;
+                }
+
+                if (isBuild)
+                {
+                    extractKey(buildKey, row.data(), size, keyBuffer.data());
+                    insertRow(row.data(), size, h);
+                }
+                else
+                {
+                    extractKey(probeKey, row.data(), size, keyBuffer.data());
+                    probeTable(row.data(), size, h, callback);
+                }
+            }
+            isBuild = false;
+        }
+    }
+
+    clearTable();
+    removeSpillFiles();
+    return true;
+}
+
+void HashJoiner::removeSpillFiles()
+{
+    for (size_t p = 0; p < buildFiles.size(); p++)
+    {
+        fclose(buildFiles[p]);
+        remove(spillFileName("build", p).c_str());
+    }
+    for (size_t p = 0; p < probeFiles.size(); p++)
+    {
+        fclose(probeFiles[p]);
+        remove(spillFileName("probe", p).c_str());
+    }
+    buildFiles.clear();
+    probeFiles.clear();
+}
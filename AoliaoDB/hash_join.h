@@ -0,0 +1,87 @@
+#pragma once
+#include "group_by.h"
+#include <functional>
+
+/* memory budget of the build side, partition both inputs to disk when exceeded */
+#ifndef JOIN_MEMORY_BUDGET
+#define JOIN_MEMORY_BUDGET (64 * 1024 * 1024)
+#endif
+
+/* how many partitions a spilled join is split into */
+#define JOIN_SPILL_PARTITIONS 16
+
+/* use an index nested loop join when the indexed side has this many times more leaves */
+#define INDEX_JOIN_LEAF_RATIO 16
+
+/* outer rows buffered, sorted and probed together in an index nested loop join */
+#define INDEX_JOIN_BATCH 4096
+
+// һ¼еλ
+struct JoinKeyColumn
+{
+    size_t offset;
+    size_t size;
+    FieldDef field;
+    ColumnLayout layout;
+
+    bool compile(const TableDef& def, const std::string& field);
+};
+
+// ϣӣڽСһࣨbuildϽϣϴһࣨprobeʽ̽⡣
+// build ڴԤʱתΪ Grace ϣӣ඼Ӽϣдʱļ
+// ڴ
+class HashJoiner
+{
+public:
+    // callback(build ¼, build , probe ¼, probe )
+    typedef std::function<void(const char*, size_t, const char*, size_t)> JoinCallback;
+
+    HashJoiner(const JoinKeyColumn& buildKey, const JoinKeyColumn& probeKey,
+        const std::string& spillPrefix);
+    ~HashJoiner();
+
+    // ȼȫ build ¼
+    bool build(const char* row, size_t size);
+
+    // ̽⣬δʱֱƥ䣬д probe 
+    bool probe(const char* row, size_t size, const JoinCallback& callback);
+
+    // ķ
+    bool finish(const JoinCallback& callback);
+
+    bool spilled() const
+    {
+        return !buildFiles.empty();
+    }
+
+private:
+    JoinKeyColumn buildKey;
+    JoinKeyColumn probeKey;
+    size_t keyWidth;
+    std::string spillPrefix;
+
+    // ͬһ build ¼heads[]  nextRow[¼]  ¼± + 1
+    GroupHashTable table;
+    std::vector<char> arena;        // | size_t  | ¼ |
+    std::vector<size_t> rowOffsets; // ¼± -> arena ƫ
+    std::vector<size_t> nextRow;
+    std::vector<size_t> heads;
+    std::vector<char> keyBuffer;
+
+    std::vector<FILE*> buildFiles;
+    std::vector<FILE*> probeFiles;
+
+    // ӼINT ȡԭʼ4ֽڣVARCHAR ȡı㵽
+    void extractKey(const JoinKeyColumn& column, const char* row, size_t size, char* key) const;
+
+    void insertRow(const char* row, size_t size, uint64_t hash);
+    void probeTable(const char* row, size_t size, uint64_t hash, const JoinCallback& callback);
+    size_t memoryUsage() const;
+    void clearTable();
+
+    std::string spillFileName(const char* side, size_t partition) const;
+    bool openSpillFiles(const char* side, std::vector<FILE*>& files);
+    static bool writeRow(FILE* fp, uint64_t hash, const char* row, size_t size);
+    bool spill();
+    void removeSpillFiles();
+};
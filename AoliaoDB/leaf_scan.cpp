@@ -0,0 +1,131 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "leaf_scan.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+
+LeafScanner::LeafScanner(const bpt::bplus_tree* tree, bool ownWrites) : tree(tree), ownWrites(ownWrites)
+{
+}
+
+size_t LeafScanner::partition(size_t maxThreads)
+{
+    ranges.clear();
+    leaves.clear();
+
+    // ؿеҶֻȡڵͷ
+    bpt::snapshot_reader reader(tree, nullptr, ownWrites);
+    snapshot = reader.get_snapshot();
+    if (!reader.is_open())
+    {
+        std::cerr << "Failed to open: " << tree->get_path() << std::endl;
+        return 0;
+    }
+    size_t leafNum = reader.get_meta().leaf_node_num;
+    off_t current = reader.first_leaf();
+    while (current != 0)
+    {
+        if (leaves.size() >= leafNum)
+        {
+            std::cerr << "Leaf chain longer than leaf_node_num, stop collecting" << std::endl;
+            break;
+        }
+        leaves.push_back(current);
+        if (!reader.read_next(current, &current))
+        {
+            std::cerr << "Failed to read leaf header at offset: " << leaves.back() << std::endl;
+            leaves.clear();
+            return 0;
+        }
+    }
+
+    if (maxThreads == 0)
+    {
+        maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    // иĹҶֻͨԼľܲ
+    if (ownWrites && tree->in_transaction())
+    {
+        maxThreads = 1;
+    }
+
+    size_t workers = std::min(maxThreads, std::max<size_t>(1, leaves.size() / MIN_LEAVES_PER_WORKER));
+    size_t per = leaves.size() / workers;
+    size_t extra = leaves.size() % workers;
+
+    size_t begin = 0;
+    for (size_t i = 0; i < workers; i++)
+    {
+        size_t end = begin + per + (i < extra ? 1 : 0);
+        ranges.push_back(std::make_pair(begin, end));
+        begin = end;
+    }
+
+    std::cout << "Parallel scan: " << leaves.size() << " leaves, "
+        << ranges.size() << " workers" << std::endl;
+    return ranges.size();
+}
+
+bool LeafScanner::scanRange(size_t worker, const LeafCallback& callback) const
+{
+    bpt::snapshot_reader reader(tree, snapshot, ownWrites);
+    if (!reader.is_open())
+    {
+        std::cerr << "Worker " << worker << " failed to open: " << tree->get_path() << std::endl;
+        return false;
+    }
+
+    std::unique_ptr<bpt::leaf_node_t> leaf(new bpt::leaf_node_t);
+    for (size_t i = ranges[worker].first; i < ranges[worker].second; i++)
+    {
+        if (!reader.read_leaf(leaf.get(), leaves[i]))
+        {
+            std::cerr << "Worker " << worker << " failed to read leaf at offset: " << leaves[i] << std::endl;
+            return false;
+        }
+        callback(worker, *leaf);
+    }
+    return true;
+}
+
+bool LeafScanner::run(const LeafCallback& callback) const
+{
+    if (ranges.empty())
+    {
+        return true;
+    }
+
+    // ֱڵǰִ߳
+    if (ranges.size() == 1)
+    {
+        return scanRange(0, callback);
+    }
+
+    std::atomic<bool> ok(true);
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < ranges.size(); i++)
+    {
+        workers.emplace_back([this, i, &callback, &ok]()
+            {
+                try
+                {
+                    if (!scanRange(i, callback))
+                    {
+                        ok = false;
+                    }
+                }
+                catch (const std::exception& e)
+                {
+                    std::cerr << "Worker " << i << " failed: " << e.what() << std::endl;
+                    ok = false;
+                }
+            });
+    }
+
+    for (auto& t : workers)
+    {
+        t.join();
+    }
+    return ok;
+}
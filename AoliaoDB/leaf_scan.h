@@ -0,0 +1,40 @@
+#pragma once
+#include "bpt.h"
+#include <functional>
+#include <utility>
+
+// Ҷɨ裺Ҷ˳г䣬
+// ÿ߳ʹöļȡԼڵҶӡ
+// ʱһգ̶߳ȡͬһ汾ɨڼд벻Ӱ
+// ȡиĹĿ飨ownWritesֻĻỰʱֻһ䣬ͨԼľȡ
+class LeafScanner
+{
+public:
+    typedef std::function<void(size_t, const bpt::leaf_node_t&)> LeafCallback;
+
+    LeafScanner(const bpt::bplus_tree* tree, bool ownWrites = true);
+
+    // ռҶƫ䣬߳
+    // maxThreads Ϊ 0 ʱʹӲ߳
+    size_t partition(size_t maxThreads = 0);
+
+    // ִУcallback(, Ҷӽڵ) ڹ߳е
+    bool run(const LeafCallback& callback) const;
+
+    size_t leafCount() const
+    {
+        return leaves.size();
+    }
+
+private:
+    // ÿ߳ٷֵҶ̫ʱ߳̿
+    static const size_t MIN_LEAVES_PER_WORKER = 4;
+
+    const bpt::bplus_tree* tree;
+    bool ownWrites;
+    std::shared_ptr<const bpt::snapshot_t> snapshot;
+    std::vector<off_t> leaves;
+    std::vector<std::pair<size_t, size_t>> ranges; // [begin, end) ±
+
+    bool scanRange(size_t worker, const LeafCallback& callback) const;
+};
@@ -0,0 +1,148 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "predicate.h"
+#include "field_codec.h"
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+bool RowPredicate::compile(const TableDef& def, const std::vector<Condition>& conditions)
+{
+    conds.clear();
+    notNull = NullMask();
+    isNull = NullMask();
+    nullBytes = def.layout.nullBytes();
+    never = false;
+    for (const auto& cond : conditions)
+    {
+        int index = def.fieldIndex(cond.field);
+        if (index < 0)
+        {
+            std::cerr << "Unknown field in WHERE: " << cond.field << std::endl;
+            return false;
+        }
+
+        const FieldDef& field = def.fields[index];
+        CompiledCondition cc;
+        cc.column = def.layout.column(index);
+        cc.op = cond.op;
+
+        // ֵֻλͼбȽ
+        if (cond.op == CompareOp::IS_NULL)
+        {
+            never = never || cc.column.nullBit < 0;
+            isNull.add(cc.column);
+            continue;
+        }
+        notNull.add(cc.column);
+        if (cond.op == CompareOp::IS_NOT_NULL)
+        {
+            continue;
+        }
+
+        if (isNullText(cond.value))
+        {
+            std::cerr << "Comparison with NULL in WHERE, use IS NULL: " << field.name << std::endl;
+            return false;
+        }
+        cc.code = cc.column.dictionary && (cond.op == CompareOp::EQ || cond.op == CompareOp::NE);
+        if (cc.code)
+        {
+            // ֻȽ 2 ֽڵı룬ȡַ
+            uint16_t code;
+            if (cc.column.dictionary->find(cond.value, code))
+            {
+                cc.value.assign(reinterpret_cast<const char*>(&code), sizeof(code));
+            }
+        }
+        else if (field.type == FieldType::VARCHAR)
+        {
+            cc.value = cond.value;
+        }
+        else
+        {
+            cc.value.resize(fieldWidth(field));
+            if (!encodeField(field, cond.value, &cc.value[0]))
+            {
+                std::cerr << "Invalid value for field " << field.name << " in WHERE: " << cond.value << std::endl;
+                return false;
+            }
+        }
+        conds.push_back(cc);
+    }
+    return true;
+}
+
+static bool compareResult(int cmp, CompareOp op)
+{
+    switch (op)
+    {
+    case CompareOp::EQ:
+        return cmp == 0;
+    case CompareOp::NE:
+        return cmp != 0;
+    case CompareOp::LT:
+        return cmp < 0;
+    case CompareOp::LE:
+        return cmp <= 0;
+    case CompareOp::GT:
+        return cmp > 0;
+    case CompareOp::GE:
+        return cmp >= 0;
+    default:
+        break;
+    }
+    return false;
+}
+
+bool RowPredicate::matches(const char* row, size_t size) const
+{
+    if (never)
+    {
+        return false;
+    }
+    if (!notNull.empty() || !isNull.empty())
+    {
+        if (size < nullBytes || notNull.any(row) || !isNull.all(row))
+        {
+            return false;
+        }
+    }
+
+    for (const auto& cc : conds)
+    {
+        int cmp;
+        const ColumnLayout& column = cc.column;
+        if (cc.code)
+        {
+            bool equal = !cc.value.empty() && column.offset + column.width <= size &&
+                memcmp(row + column.offset, cc.value.data(), column.width) == 0;
+            if (equal != (cc.op == CompareOp::EQ))
+            {
+                return false;
+            }
+            continue;
+        }
+        if (column.field.type != FieldType::VARCHAR)
+        {
+            if (column.offset + column.width > size)
+            {
+                return false;
+            }
+            cmp = compareField(column.field, row + column.offset, cc.value.data());
+        }
+        else
+        {
+            if (column.offset + (column.variable ? column.width : 1) > size)
+            {
+                return false;
+            }
+            cmp = column.text(row, size).compare(cc.value);
+        }
+
+        if (!compareResult(cmp, cc.op))
+        {
+            return false;
+        }
+    }
+    return true;
+}
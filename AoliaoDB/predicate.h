@@ -0,0 +1,32 @@
+#pragma once
+#include "query_def.h"
+#include "table_def.h"
+
+// 뵽вϵνʣֱӱȽϼ¼еֽڣлַ
+class RowPredicate
+{
+public:
+    bool compile(const TableDef& def, const std::vector<Condition>& conditions);
+
+    bool matches(const char* row, size_t size) const;
+
+    bool empty() const
+    {
+        return conds.empty() && !never && notNull.empty() && isNull.empty();
+    }
+
+private:
+    struct CompiledCondition
+    {
+        ColumnLayout column;
+        CompareOp op;
+        std::string value; // VARCHAR ΪıΪĶֵ
+        bool code;         // ֵе = / !=value Ϊı룬ֵʱΪ
+    };
+
+    std::vector<CompiledCondition> conds;
+    NullMask notNull; // IS NOT NULL ԼȽϵУκһΪ NULL ƥ
+    NullMask isNull;  // IS NULL УȫΪ NULL
+    size_t nullBytes = 0;
+    bool never = false; // ԲΪ NULL Ҫ IS NULL
+};
@@ -0,0 +1,92 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Ƚ
+enum class CompareOp
+{
+    EQ,
+    NE,
+    LT,
+    LE,
+    GT,
+    GE,
+    IS_NULL, // ûбȽֵ
+    IS_NOT_NULL
+};
+
+// WHERE field op value֮ AND ϵ
+struct Condition
+{
+    std::string field;
+    CompareOp op;
+    std::string value;
+};
+
+// INSERT ѴڵʱĴʽ
+enum class ConflictAction
+{
+    FAIL,    // ʧ
+    REPLACE, // INSERT OR REPLACE¼¼滻
+    UPDATE,  // ON CONFLICT DO UPDATE SET ...ֵ޸м¼
+    NOTHING  // ON CONFLICT DO NOTHINGм¼
+};
+
+// ۺϺ
+enum class AggregateFunc
+{
+    COUNT,
+    SUM,
+    MIN,
+    MAX,
+    AVG
+};
+
+struct AggregateDef
+{
+    AggregateFunc func;
+    std::string field; // COUNT(*) ʱΪ "*"
+
+    // еıͷ SUM(amount)
+    std::string label() const
+    {
+        static const char* names[] = {"COUNT", "SUM", "MIN", "MAX", "AVG"};
+        return std::string(names[static_cast<int>(func)]) + "(" + field + ")";
+    }
+};
+
+// ORDER BY еһ
+struct OrderByItem
+{
+    std::string field;
+    bool descending;
+};
+
+/* no LIMIT clause */
+#define NO_LIMIT ((size_t)-1)
+
+// SELECT * ѯͷҳѡ
+struct SelectOptions
+{
+    std::vector<OrderByItem> orderBy;
+    size_t limit = NO_LIMIT;
+    size_t offset = 0;
+};
+
+// ֵӣleftTable JOIN rightTable ON leftTable.leftField = rightTable.rightField
+struct JoinDef
+{
+    std::string leftTable;
+    std::string leftField;
+    std::string rightTable;
+    std::string rightField;
+};
+
+// COPY ѡ
+struct CopyOptions
+{
+    char delimiter = ',';
+    bool header = false; // һʱ
+    size_t threads = 0;  // н߳0 ʾʹӲ߳
+    bool binary = false; // Ƹʽṹͷ + ԭʼ¼
+};
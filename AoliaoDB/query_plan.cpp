@@ -0,0 +1,135 @@
+#include "query_plan.h"
+#include "sql_lexer.h"
+
+bool normalizeStatement(std::string_view sql, std::string& normalized,
+    std::vector<std::string>* literals)
+{
+    normalized.clear();
+    Lexer lexer(sql);
+    Token token = lexer.next();
+
+    // DDL еͳȣCOPY ļѡܲ
+    if (token.type == TokenType::IDENT &&
+        (equalsKeyword(token.text, "CREATE") || equalsKeyword(token.text, "DROP") ||
+            equalsKeyword(token.text, "COPY")))
+    {
+        literals = nullptr;
+    }
+
+    bool keepNumber = false;
+    while (token.type != TokenType::END)
+    {
+        if (token.type == TokenType::INVALID)
+        {
+            return false;
+        }
+
+        Token next = lexer.next();
+        if (token.type == TokenType::SYMBOL && token.text == ";" && next.type == TokenType::END)
+        {
+            break;
+        }
+
+        if (!normalized.empty())
+        {
+            normalized += ' ';
+        }
+
+        bool literal = token.type == TokenType::STRING ||
+            (token.type == TokenType::NUMBER && !keepNumber);
+        if (literals && literal)
+        {
+            literals->push_back(token.escaped ? unescapeString(token.text, sql[token.pos]) :
+                std::string(token.text));
+            normalized += '?';
+        }
+        else if (token.type == TokenType::STRING)
+        {
+            char quote = sql[token.pos];
+            normalized += quote;
+            normalized.append(token.text.data(), token.text.size());
+            normalized += quote;
+        }
+        else
+        {
+            normalized.append(token.text.data(), token.text.size());
+        }
+
+        keepNumber = token.type == TokenType::IDENT &&
+            (equalsKeyword(token.text, "LIMIT") || equalsKeyword(token.text, "OFFSET"));
+        token = next;
+    }
+    return true;
+}
+
+std::string resultMessage(const QueryPlan& plan, const QueryResult& result)
+{
+    switch (plan.type)
+    {
+    case StatementType::CREATE_TABLE:
+        return result.ok ? "Table created successfully" : "Failed to create table";
+    case StatementType::DROP_TABLE:
+        return result.ok ? "Table dropped successfully" : "Failed to drop table";
+    case StatementType::TRUNCATE_TABLE:
+        return result.ok ? "Table truncated successfully" : "Failed to truncate table";
+    case StatementType::INSERT:
+        if (plan.conflict != ConflictAction::FAIL)
+        {
+            return result.ok ? std::to_string(result.affected) + " records inserted or updated" : "Failed to upsert records";
+        }
+        if (result.ok && result.affected > 1)
+        {
+            return std::to_string(result.affected) + " records inserted successfully";
+        }
+        return result.ok ? "Record inserted successfully" : "Failed to insert record";
+    case StatementType::COPY_FROM:
+    case StatementType::COPY_TO:
+        return result.ok ? std::to_string(result.affected) + " records copied successfully" : "Failed to copy records";
+    case StatementType::UPDATE:
+        return result.ok ? std::to_string(result.affected) + " records updated" : "Failed to update records";
+    case StatementType::DELETE_FROM:
+        return result.ok ? std::to_string(result.affected) + " records deleted" : "Failed to delete records";
+    case StatementType::BEGIN_TRANSACTION:
+        return result.ok ? "Transaction started" : "Failed to start transaction";
+    case StatementType::COMMIT:
+        return result.ok ? "Transaction committed" : "Failed to commit transaction";
+    case StatementType::ROLLBACK:
+        return result.ok ? "Transaction rolled back" : "Failed to roll back transaction";
+    default:
+        if (!result.ok)
+        {
+            return "Failed to evaluate query";
+        }
+        return result.rows.empty() ? "No records found" : "";
+    }
+}
+
+std::shared_ptr<const QueryPlan> PlanCache::find(const std::string& key)
+{
+    auto it = index.find(key);
+    if (it == index.end())
+    {
+        return nullptr;
+    }
+    entries.splice(entries.begin(), entries, it->second);
+    return it->second->second;
+}
+
+void PlanCache::insert(const std::string& key, const std::shared_ptr<const QueryPlan>& plan)
+{
+    auto it = index.find(key);
+    if (it != index.end())
+    {
+        it->second->second = plan;
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+
+    entries.push_front(std::make_pair(key, plan));
+    index[key] = entries.begin();
+    if (entries.size() > capacity)
+    {
+        index.erase(entries.back().first);
+        entries.pop_back();
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include "sql_ast.h"
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+/* how many plans the LRU plan cache keeps */
+#define PLAN_CACHE_CAPACITY 256
+
+// SELECT ķ·ʱѡ
+enum class AccessPath
+{
+    NONE,           // ǲѯ
+    KEY_ORDER_SCAN, // Ҷ˳ɨ裬ǰ
+    SORT_SCAN,      // ȫɨ
+    AGGREGATE,      // оۺ / ۺ
+    JOIN            // ϣӻǶѭӣִʱСѡ
+};
+
+// ֵ param 
+struct PlanValue
+{
+    std::string literal;
+    int param; // -1 ʾ
+};
+
+struct PlanCondition
+{
+    Condition cond; // cond.value Ϊparam >= 0 ʱִʱ滻
+    int param;
+};
+
+// 䣺ֶѾִʱֻ󶨲
+struct QueryPlan
+{
+    std::string text; // õıṹ仯±
+    StatementType type;
+    unsigned long long schemaVersion; // ʱıṹ汾
+    size_t paramCount = 0;
+    AccessPath path = AccessPath::NONE;
+    std::string tableName;
+
+    // CREATE TABLE
+    TableDef tableDef;
+
+    // COPY
+    std::string fileName;
+    CopyOptions copy;
+
+    // INSERTʱδ
+    std::vector<PlanValue> values;
+    size_t rowCount = 1;
+    ConflictAction conflict = ConflictAction::FAIL;
+
+    // UPDATE  ON CONFLICT DO UPDATE  SETfield Ϊֶ±
+    std::vector<std::pair<size_t, PlanValue>> assignments;
+
+    // SELECT / UPDATE / DELETE / COPY TO
+    std::vector<PlanCondition> where;
+    SelectOptions options;
+    std::vector<std::string> groupBy;
+    std::vector<AggregateDef> aggregates;
+    JoinDef join;
+    std::vector<std::string> headers; // ÿһе
+    std::vector<size_t> columns;      //  SELECT бڽе±
+};
+
+struct QueryResult
+{
+    bool ok = false;
+    size_t affected = 0; // INSERT / COPY дUPDATE / DELETE ޸ĵ
+    std::vector<std::string> headers;
+    std::vector<std::vector<std::string>> rows;
+};
+
+// 淶ıΪʷԪ֮һոָȥĩβֺš
+// literals Ϊʱַֺ滻Ϊ ? ˳ literalsԶ
+// LIMIT / OFFSET ֺ CREATE / DROP / COPY 䱣ԭ
+bool normalizeStatement(std::string_view sql, std::string& normalized,
+    std::vector<std::string>* literals);
+
+// ִнʾ֣ǰ׺ "> "ѯɹнʱؿգɵ÷
+// ͷ
+std::string resultMessage(const QueryPlan& plan, const QueryResult& result);
+
+// ִмƻ LRU 棬Ϊ淶ı
+class PlanCache
+{
+public:
+    explicit PlanCache(size_t capacity = PLAN_CACHE_CAPACITY) : capacity(capacity)
+    {
+    }
+
+    // ʱƵʹõλ
+    std::shared_ptr<const QueryPlan> find(const std::string& key);
+
+    // ʱ̭δʹõļƻ
+    void insert(const std::string& key, const std::shared_ptr<const QueryPlan>& plan);
+
+    void clear()
+    {
+        entries.clear();
+        index.clear();
+    }
+
+    size_t size() const
+    {
+        return entries.size();
+    }
+
+private:
+    typedef std::list<std::pair<std::string, std::shared_ptr<const QueryPlan>>> EntryList;
+
+    size_t capacity;
+    EntryList entries; // ͷΪʹ
+    std::unordered_map<std::string, EntryList::iterator> index;
+};
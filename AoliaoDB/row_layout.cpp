@@ -0,0 +1,192 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "row_layout.h"
+#include "field_codec.h"
+
+void RowLayout::compile(const std::vector<FieldDef>& fields, bool variableRows, bool nullBitmap,
+    const std::vector<std::shared_ptr<Dictionary>>& dictionaries)
+{
+    columns.clear();
+    columns.reserve(fields.size());
+    lastVariable = -1;
+    bitmapBytes = nullBitmap ? (fields.size() + 7) / 8 : 0;
+
+    size_t offset = bitmapBytes;
+    size_t maxAlign = 4;
+    size_t tailMax = 0;
+    for (const auto& field : fields)
+    {
+        size_t align = field.dictionary ? sizeof(uint16_t) : fieldAlignment(field.type);
+        offset = (offset + align - 1) & ~(align - 1);
+
+        ColumnLayout column;
+        column.field = field;
+        column.offset = offset;
+        column.variable = variableRows && field.type == FieldType::VARCHAR && !field.dictionary;
+        column.width = field.dictionary ? sizeof(uint16_t) : column.variable ? VARCHAR_SLOT_SIZE : fieldWidth(field);
+        column.nullBit = nullBitmap && !columns.empty() ? static_cast<int>(columns.size()) : -1;
+        column.encode = fieldEncoder(field.type);
+        column.decode = fieldDecoder(field.type);
+        if (columns.size() < dictionaries.size())
+        {
+            column.dictionary = dictionaries[columns.size()];
+        }
+        if (column.variable)
+        {
+            lastVariable = static_cast<int>(columns.size());
+            tailMax += field.size - 1;
+        }
+        columns.push_back(column);
+
+        offset += column.width;
+        maxAlign = std::max(maxAlign, align);
+    }
+    fixed = offset;
+    size = (offset + tailMax + maxAlign - 1) & ~(maxAlign - 1);
+}
+
+bool RowLayout::encodeColumn(size_t index, std::string_view text, char* row, size_t& tail) const
+{
+    const ColumnLayout& column = columns[index];
+    if (isNullText(text))
+    {
+        if (column.nullBit < 0)
+        {
+            return false;
+        }
+        row[column.nullBit >> 3] |= static_cast<char>(1 << (column.nullBit & 7));
+        if (!column.variable)
+        {
+            return true; // бΪ
+        }
+        text = std::string_view(); // 䳤еݳΪ 0
+    }
+
+    if (column.field.dictionary)
+    {
+        uint16_t code;
+        if (!column.dictionary || !column.dictionary->encode(text.substr(0, column.field.size - 1), code))
+        {
+            return false;
+        }
+        std::memcpy(row + column.offset, &code, sizeof(code));
+        return true;
+    }
+    if (!column.variable)
+    {
+        return column.encode(column.field, text, row + column.offset);
+    }
+
+    uint32_t slot[2];
+    slot[0] = static_cast<uint32_t>(tail);
+    slot[1] = static_cast<uint32_t>(std::min(text.size(), column.field.size - 1));
+    std::memcpy(row + column.offset, slot, sizeof(slot));
+    std::memcpy(row + tail, text.data(), slot[1]);
+    tail += slot[1];
+    return true;
+}
+
+static std::string valueError(const ColumnLayout& column, const std::string& value)
+{
+    return isNullText(value) ? "NULL is not allowed for field " + column.field.name :
+        "invalid value '" + value + "' for field " + column.field.name;
+}
+
+size_t RowLayout::encode(const std::vector<std::string>& values, char* out, std::string& error) const
+{
+    // 䳤ݻֽд룬ֻ㶨
+    memset(out, 0, variable() ? fixed : size);
+
+    size_t tail = fixed;
+    size_t count = std::min(values.size(), columns.size());
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!encodeColumn(i, values[i], out, tail))
+        {
+            error = valueError(columns[i], values[i]);
+            return 0;
+        }
+    }
+    return variable() ? tail : size;
+}
+
+size_t RowLayout::rewrite(const char* row, size_t length,
+    const std::vector<std::pair<size_t, std::string>>& assignments, char* out, std::string& error) const
+{
+    memset(out, 0, variable() ? fixed : size);
+    memcpy(out, row, std::min(bitmapBytes, length));
+
+    // 䳤ݰ˳Уδ޸ĵĶֱӸֽ
+    size_t tail = fixed;
+    for (size_t i = 0; i < columns.size(); i++)
+    {
+        const ColumnLayout& column = columns[i];
+        const std::string* value = nullptr;
+        for (const auto& assignment : assignments)
+        {
+            if (assignment.first == i)
+            {
+                value = &assignment.second;
+            }
+        }
+
+        if (value)
+        {
+            if (column.nullBit >= 0)
+            {
+                out[column.nullBit >> 3] &= static_cast<char>(~(1 << (column.nullBit & 7)));
+            }
+            if (!encodeColumn(i, *value, out, tail))
+            {
+                error = valueError(column, *value);
+                return 0;
+            }
+        }
+        else if (column.variable)
+        {
+            encodeColumn(i, column.text(row, length), out, tail);
+        }
+        else if (column.offset + column.width <= length)
+        {
+            memcpy(out + column.offset, row + column.offset, column.width);
+        }
+    }
+    return variable() ? tail : size;
+}
+
+size_t RowLayout::rowLength(const char* row) const
+{
+    if (!variable())
+    {
+        return size;
+    }
+    uint32_t slot[2];
+    std::memcpy(slot, row + columns[lastVariable].offset, sizeof(slot));
+    return std::max(fixed, slot[0] + static_cast<size_t>(slot[1]));
+}
+
+std::vector<std::string> RowLayout::decode(const char* row, size_t length) const
+{
+    std::vector<std::string> values;
+    values.reserve(columns.size());
+    for (const auto& column : columns)
+    {
+        if (column.offset + column.width > length)
+        {
+            break;
+        }
+        if (column.isNull(row))
+        {
+            values.push_back("NULL");
+            continue;
+        }
+        if (column.field.type == FieldType::VARCHAR)
+        {
+            values.push_back(std::string(column.text(row, length)));
+            continue;
+        }
+        std::string value;
+        column.decode(column.field, row + column.offset, value);
+        values.push_back(std::move(value));
+    }
+    return values;
+}
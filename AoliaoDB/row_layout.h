@@ -0,0 +1,276 @@
+#pragma once
+#include "dictionary.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+//  tables.meta öٵֵֻܼĩβ
+enum class FieldType
+{
+    INT,
+    VARCHAR,
+    FLOAT,
+    DOUBLE,
+    BIGINT,
+    BOOLEAN,
+    DATE // 1970-01-01 
+};
+
+#pragma pack(push, 1) // ȷ1ֽڶ
+struct FieldDef
+{
+    std::string name;
+    FieldType type;
+    size_t size;
+    bool dictionary = false; // ֵ VARCHAR¼ֻ
+};
+#pragma pack(pop)
+
+// ֶڼ¼ռõֽ;VARCHAR Ϊĳ
+inline size_t fieldWidth(const FieldDef& field)
+{
+    switch (field.type)
+    {
+    case FieldType::INT:
+    case FieldType::FLOAT:
+    case FieldType::DATE:
+        return 4;
+    case FieldType::BIGINT:
+    case FieldType::DOUBLE:
+        return 8;
+    case FieldType::BOOLEAN:
+        return 1;
+    default:
+        return field.size;
+    }
+}
+
+// ֶεĶҪ󣺶Ȼ룬VARCHAR  4 ֽڶ
+inline size_t fieldAlignment(FieldType type)
+{
+    switch (type)
+    {
+    case FieldType::BIGINT:
+    case FieldType::DOUBLE:
+        return 8;
+    case FieldType::BOOLEAN:
+        return 1;
+    default:
+        return 4;
+    }
+}
+
+
+// ֶεı/뺯ʱѡдʱж
+typedef bool (*FieldEncoder)(const FieldDef& field, std::string_view text, char* out);
+typedef void (*FieldDecoder)(const FieldDef& field, const char* data, std::string& out);
+
+/* bytes of a VARCHAR slot in a variable-length row: uint32 offset + uint32 length */
+#define VARCHAR_SLOT_SIZE 8
+
+// ֵڸ֮ıݣNULL һ SQL  CSV ֶеĴʾ
+inline const std::string& nullText()
+{
+    static const std::string text(1, '\0');
+    return text;
+}
+
+inline bool isNullText(std::string_view text)
+{
+    return text.size() == 1 && text[0] == '\0';
+}
+
+// ֶڼ¼еλü뺯
+struct ColumnLayout
+{
+    FieldDef field;
+    size_t offset;
+    size_t width;
+    bool variable; // 䳤 VARCHARoffset  (λ, )ڼ¼β
+    int nullBit;   // ڿֵλͼеλ-1 ʾΪ NULL
+    FieldEncoder encode;
+    FieldDecoder decode;
+    std::shared_ptr<Dictionary> dictionary; // ֵУoffset  uint16 
+
+    bool isNull(const char* row) const
+    {
+        return nullBit >= 0 && (row[nullBit >> 3] >> (nullBit & 7) & 1) != 0;
+    }
+
+    // VARCHAR ֶεݣlength Ϊ¼ʵʳ
+    std::string_view text(const char* row, size_t length) const
+    {
+        if (dictionary)
+        {
+            uint16_t code;
+            if (offset + sizeof(code) > length)
+            {
+                return std::string_view();
+            }
+            std::memcpy(&code, row + offset, sizeof(code));
+            return dictionary->at(code);
+        }
+        if (variable)
+        {
+            uint32_t slot[2];
+            if (offset + sizeof(slot) > length)
+            {
+                return std::string_view();
+            }
+            std::memcpy(slot, row + offset, sizeof(slot));
+            if (slot[0] + static_cast<size_t>(slot[1]) > length)
+            {
+                return std::string_view();
+            }
+            return std::string_view(row + slot[0], slot[1]);
+        }
+        if (offset >= length)
+        {
+            return std::string_view();
+        }
+        return std::string_view(row + offset, strnlen(row + offset, std::min(field.size - 1, length - offset)));
+    }
+};
+
+// ¼֣رʱֶбһΣ롢롢νʡۺϡ
+// ֱʹеƫм롣
+// ֶΰȻ룬¼Ȳ뵽ĶҪ
+//  VARCHAR(n) ռ n ֽڲ '\0' β䳤 VARCHAR ֻռһ 8 ֽڵĲλ
+// ݰ˳ڶ֮󣬼¼ֻô
+// ֵֻռ 2 ֽڵı룬dictionaries ֶһһӦֵΪա
+// пֵλͼʱ¼λͼͷ i λʾ i Ϊ NULLNULL еֽڱΪ㣻
+// һΪ NULL
+class RowLayout
+{
+public:
+    void compile(const std::vector<FieldDef>& fields, bool variableRows = false, bool nullBitmap = false,
+        const std::vector<std::shared_ptr<Dictionary>>& dictionaries = {});
+
+    // ¼ĴСҲÿ¼Ŀ
+    size_t recordSize() const
+    {
+        return size;
+    }
+
+    // ֵĴС䳤ݴ￪ʼ
+    size_t fixedSize() const
+    {
+        return fixed;
+    }
+
+    bool variable() const
+    {
+        return lastVariable >= 0;
+    }
+
+    // ֵλͼֽûλͼʱΪ 0
+    size_t nullBytes() const
+    {
+        return bitmapBytes;
+    }
+
+    size_t columnCount() const
+    {
+        return columns.size();
+    }
+
+    const ColumnLayout& column(size_t index) const
+    {
+        return columns[index];
+    }
+
+    // һУtext Ϊ nullText() ʱд NULL
+    // tail Ǳ䳤ݵдλã fixedSize() ʼƽ
+    bool encodeColumn(size_t index, std::string_view text, char* row, size_t& tail) const;
+
+    // ıֵһ¼out  recordSize() ֽڡ
+    // ؼ¼ʵʳȣֵϷʱ 0 ԭ
+    size_t encode(const std::vector<std::string>& values, char* out, std::string& error) const;
+
+    //  assignments±, ıֵ޸һ¼д outout  recordSize() ֽڣ
+    // ԭơ¼¼ĳȣֵϷʱ 0 ԭ
+    size_t rewrite(const char* row, size_t length, const std::vector<std::pair<size_t, std::string>>& assignments,
+        char* out, std::string& error) const;
+
+    // ѱ¼ʵʳ
+    size_t rowLength(const char* row) const;
+
+    // ¼ıֵNULL ʾΪ "NULL"¼ضʱֶֻ
+    std::vector<std::string> decode(const char* row, size_t length) const;
+
+private:
+    std::vector<ColumnLayout> columns;
+    size_t size = 0;
+    size_t fixed = 0;
+    size_t bitmapBytes = 0;
+    int lastVariable = -1; // һ䳤УݵĽβǼ¼Ľβ
+};
+
+// һеĿֵλ롣νʺ;ۺϱʱмʱ 64 λ¼Ŀֵλͼ
+// һ㣬ȡλλͼ i λڵ i / 8 ֽڣС˶еĵ i % 64 λ
+class NullMask
+{
+public:
+    // Ϊ NULL к
+    void add(const ColumnLayout& column)
+    {
+        if (column.nullBit < 0)
+        {
+            return;
+        }
+        size_t word = column.nullBit >> 6;
+        if (words.size() <= word)
+        {
+            words.resize(word + 1, 0);
+        }
+        words[word] |= 1ULL << (column.nullBit & 63);
+        bytes = std::max<size_t>(bytes, (column.nullBit >> 3) + 1);
+    }
+
+    bool empty() const
+    {
+        return words.empty();
+    }
+
+    // Ϊ NULL
+    bool any(const char* row) const
+    {
+        for (size_t i = 0; i < words.size(); i++)
+        {
+            if ((load(row, i) & words[i]) != 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // еȫΪ NULL
+    bool all(const char* row) const
+    {
+        for (size_t i = 0; i < words.size(); i++)
+        {
+            if ((load(row, i) & words[i]) != words[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    std::vector<uint64_t> words;
+    size_t bytes = 0; // ֻһλڵֽڣԽλͼ
+
+    uint64_t load(const char* row, size_t word) const
+    {
+        uint64_t bits = 0;
+        std::memcpy(&bits, row + word * 8, std::min<size_t>(8, bytes - word * 8));
+        return bits;
+    }
+};
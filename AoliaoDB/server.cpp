@@ -0,0 +1,912 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include "server.h"
+#include "sql_parser.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <map>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define FD_SETSIZE 1024 // select Ĭֻܵȴ 64 ׽
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <afunix.h>
+#pragma comment(lib, "Ws2_32.lib")
+#define SEND_FLAGS 0
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define SEND_FLAGS MSG_NOSIGNAL // Զ˹رʱش SIGPIPE
+#endif
+
+static const SocketHandle INVALID_HANDLE = static_cast<SocketHandle>(-1);
+
+// Windows ʹ׽֮ǰʼһ
+static bool initSockets()
+{
+#ifdef _WIN32
+    static bool ready = []()
+    {
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+    }();
+    return ready;
+#else
+    return true;
+#endif
+}
+
+static void closeSocket(SocketHandle sock)
+{
+#ifdef _WIN32
+    closesocket(sock);
+#else
+    ::close(sock);
+#endif
+}
+
+// ڶȡϵ̣߳Լر
+static void shutdownSocket(SocketHandle sock)
+{
+#ifdef _WIN32
+    shutdown(sock, SD_BOTH);
+#else
+    shutdown(sock, SHUT_RDWR);
+#endif
+}
+
+static bool sendAll(SocketHandle sock, const char* data, size_t size)
+{
+    while (size > 0)
+    {
+        int chunk = static_cast<int>(std::min(size, static_cast<size_t>(1 << 20)));
+        int sent = send(sock, data, chunk, SEND_FLAGS);
+        if (sent <= 0)
+        {
+            return false;
+        }
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+static bool receiveAll(SocketHandle sock, char* data, size_t size)
+{
+    while (size > 0)
+    {
+        int chunk = static_cast<int>(std::min(size, static_cast<size_t>(1 << 20)));
+        int got = recv(sock, data, chunk, 0);
+        if (got <= 0)
+        {
+            return false;
+        }
+        data += got;
+        size -= got;
+    }
+    return true;
+}
+
+static void putUint32(std::string& out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+static void putUint64(std::string& out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+}
+
+static void putString(std::string& out, const std::string& value)
+{
+    putUint32(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+}
+
+// ˳ȡ֡ݣԽ ok Ϊ false
+struct PayloadReader
+{
+    const std::string& data;
+    size_t pos = 0;
+    bool ok = true;
+
+    explicit PayloadReader(const std::string& data) : data(data)
+    {
+    }
+
+    uint64_t integer(int bytes)
+    {
+        if (!ok || data.size() - pos < static_cast<size_t>(bytes))
+        {
+            ok = false;
+            return 0;
+        }
+        uint64_t value = 0;
+        for (int i = 0; i < bytes; i++)
+        {
+            value |= static_cast<uint64_t>(static_cast<unsigned char>(data[pos + i])) << (8 * i);
+        }
+        pos += bytes;
+        return value;
+    }
+
+    std::string text()
+    {
+        size_t length = static_cast<size_t>(integer(4));
+        if (!ok || data.size() - pos < length)
+        {
+            ok = false;
+            return std::string();
+        }
+        pos += length;
+        return data.substr(pos - length, length);
+    }
+};
+
+bool sendFrame(SocketHandle sock, FrameType type, const std::string& payload)
+{
+    std::string header;
+    header.push_back(static_cast<char>(type));
+    putUint32(header, static_cast<uint32_t>(payload.size()));
+    return sendAll(sock, header.data(), header.size()) && sendAll(sock, payload.data(), payload.size());
+}
+
+bool receiveFrame(SocketHandle sock, FrameType& type, std::string& payload)
+{
+    std::string header(5, '\0');
+    if (!receiveAll(sock, &header[0], header.size()))
+    {
+        return false;
+    }
+    PayloadReader reader(header);
+    type = static_cast<FrameType>(header[0]);
+    reader.pos = 1;
+    size_t length = static_cast<size_t>(reader.integer(4));
+    if (length > MAX_FRAME_BYTES)
+    {
+        std::cerr << "Frame too large: " << length << " bytes" << std::endl;
+        return false;
+    }
+    payload.resize(length);
+    return length == 0 || receiveAll(sock, &payload[0], length);
+}
+
+// һӵĻỰ״̬
+struct Session
+{
+    TableManager::SessionId id;
+    std::string parked; // ȴỰûִе
+    Parser parser;
+    Statement stmt;
+    std::vector<std::string> params;
+    std::map<std::string, std::shared_ptr<const QueryPlan>> prepared;
+};
+
+// 뽻 runStatement ͬPREPARE / EXECUTE / DEALLOCATE Ựе䣬
+// ԶִСadmit ִмƻ֮ǰã false ʱִ
+static void runQuery(TableManager& tm, Session& session, const std::string& sql,
+    QueryResult& result, std::string& message, const std::function<bool(const QueryPlan&)>& admit)
+{
+    Token first = Lexer(sql).next();
+    if (first.type == TokenType::IDENT && (equalsKeyword(first.text, "PREPARE") ||
+        equalsKeyword(first.text, "EXECUTE") || equalsKeyword(first.text, "DEALLOCATE")))
+    {
+        if (!session.parser.parse(sql, session.stmt))
+        {
+            message = "Syntax error: " + session.parser.error();
+            return;
+        }
+        const Statement& stmt = session.stmt;
+        std::string name(stmt.name);
+        if (stmt.type == StatementType::PREPARE)
+        {
+            auto plan = tm.prepare(std::string(stmt.body), message);
+            if (!plan)
+            {
+                return;
+            }
+            session.prepared[name] = plan;
+            result.ok = true;
+            message = "Statement prepared with " + std::to_string(plan->paramCount) + " parameters";
+            return;
+        }
+
+        auto it = session.prepared.find(name);
+        if (it == session.prepared.end())
+        {
+            message = "Prepared statement not found: " + name;
+            return;
+        }
+        if (stmt.type == StatementType::DEALLOCATE)
+        {
+            session.prepared.erase(it);
+            result.ok = true;
+            message = "Statement deallocated";
+            return;
+        }
+
+        session.params.clear();
+        for (const auto& value : stmt.values)
+        {
+            session.params.push_back(std::string(value.text));
+        }
+        if (session.params.size() != it->second->paramCount)
+        {
+            message = "Expected " + std::to_string(it->second->paramCount) + " parameters, got " +
+                std::to_string(session.params.size());
+            return;
+        }
+        if (!admit(*it->second))
+        {
+            message = "Timed out waiting for another session's transaction";
+            return;
+        }
+        result = tm.execute(*it->second, session.params, session.id);
+        message = resultMessage(*it->second, result);
+        return;
+    }
+
+    auto plan = tm.prepare(sql, session.params, message);
+    if (!plan)
+    {
+        return;
+    }
+    if (!admit(*plan))
+    {
+        message = "Timed out waiting for another session's transaction";
+        return;
+    }
+    result = tm.execute(*plan, session.params, session.id);
+    message = resultMessage(*plan, result);
+}
+
+// ѯȷͷٰ batchRows ֡У DONE
+static bool sendResult(SocketHandle sock, const QueryResult& result, const std::string& message,
+    size_t batchRows)
+{
+    std::string payload;
+    if (!result.headers.empty())
+    {
+        putUint32(payload, static_cast<uint32_t>(result.headers.size()));
+        for (const auto& header : result.headers)
+        {
+            putString(payload, header);
+        }
+        if (!sendFrame(sock, FrameType::HEADER, payload))
+        {
+            return false;
+        }
+
+        size_t batch = std::max(batchRows, static_cast<size_t>(1));
+        for (size_t begin = 0; begin < result.rows.size(); begin += batch)
+        {
+            size_t end = std::min(begin + batch, result.rows.size());
+            payload.clear();
+            putUint32(payload, static_cast<uint32_t>(end - begin));
+            for (size_t i = begin; i < end; i++)
+            {
+                putUint32(payload, static_cast<uint32_t>(result.rows[i].size()));
+                for (const auto& value : result.rows[i])
+                {
+                    putString(payload, value);
+                }
+            }
+            if (!sendFrame(sock, FrameType::ROWS, payload))
+            {
+                return false;
+            }
+        }
+    }
+
+    payload.clear();
+    payload.push_back(result.ok ? 1 : 0);
+    putUint64(payload, result.affected);
+    putString(payload, message);
+    return sendFrame(sock, FrameType::DONE, payload);
+}
+
+DatabaseServer::DatabaseServer(TableManager& tm, const ServerOptions& options)
+    : tm(tm), options(options), stopping(false), wakeSocket(INVALID_HANDLE), transactionOwner(INVALID_HANDLE)
+{
+}
+
+DatabaseServer::~DatabaseServer()
+{
+    closeListeners();
+}
+
+bool DatabaseServer::listenUnix()
+{
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (options.socketPath.size() >= sizeof(address.sun_path))
+    {
+        std::cerr << "Socket path too long: " << options.socketPath << std::endl;
+        return false;
+    }
+    strcpy(address.sun_path, options.socketPath.c_str());
+
+    SocketHandle sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock == INVALID_HANDLE)
+    {
+        std::cerr << "Failed to create Unix socket" << std::endl;
+        return false;
+    }
+
+    // ϴ˳ʱµ׽ļ
+    remove(options.socketPath.c_str());
+    if (bind(sock, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(sock, SOMAXCONN) != 0)
+    {
+        std::cerr << "Failed to listen on " << options.socketPath << std::endl;
+        closeSocket(sock);
+        return false;
+    }
+    listeners.push_back(sock);
+    std::cerr << "Listening on " << options.socketPath << std::endl;
+    return true;
+}
+
+bool DatabaseServer::listenTcp()
+{
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<unsigned short>(options.tcpPort));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // ֻܱ
+
+    SocketHandle sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock == INVALID_HANDLE)
+    {
+        std::cerr << "Failed to create TCP socket" << std::endl;
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse), sizeof(reuse));
+    if (bind(sock, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(sock, SOMAXCONN) != 0)
+    {
+        std::cerr << "Failed to listen on 127.0.0.1:" << options.tcpPort << std::endl;
+        closeSocket(sock);
+        return false;
+    }
+    listeners.push_back(sock);
+    std::cerr << "Listening on 127.0.0.1:" << options.tcpPort << std::endl;
+    return true;
+}
+
+bool DatabaseServer::openWakeSocket()
+{
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = 0;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    socklen_t length = sizeof(address);
+    wakeSocket = socket(AF_INET, SOCK_DGRAM, 0);
+    if (wakeSocket == INVALID_HANDLE ||
+        bind(wakeSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        getsockname(wakeSocket, reinterpret_cast<sockaddr*>(&address), &length) != 0)
+    {
+        std::cerr << "Failed to create wake-up socket" << std::endl;
+        return false;
+    }
+    wakePort = ntohs(address.sin_port);
+    return true;
+}
+
+void DatabaseServer::wake()
+{
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(wakePort);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    char byte = 0;
+    sendto(wakeSocket, &byte, 1, 0, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+}
+
+void DatabaseServer::closeListeners()
+{
+    for (auto sock : listeners)
+    {
+        closeSocket(sock);
+    }
+    if (!listeners.empty() && !options.socketPath.empty())
+    {
+        remove(options.socketPath.c_str());
+    }
+    listeners.clear();
+    if (wakeSocket != INVALID_HANDLE)
+    {
+        closeSocket(wakeSocket);
+        wakeSocket = INVALID_HANDLE;
+    }
+}
+
+bool DatabaseServer::run()
+{
+    if (!initSockets())
+    {
+        std::cerr << "Failed to initialize sockets" << std::endl;
+        return false;
+    }
+    if (options.socketPath.empty() && options.tcpPort == 0)
+    {
+        std::cerr << "No socket path or TCP port to listen on" << std::endl;
+        return false;
+    }
+    if ((!options.socketPath.empty() && !listenUnix()) || (options.tcpPort != 0 && !listenTcp()) ||
+        !openWakeSocket())
+    {
+        closeListeners();
+        return false;
+    }
+
+    size_t threads = std::max(options.threads, static_cast<size_t>(1));
+    for (size_t i = 0; i < threads; i++)
+    {
+        workers.emplace_back(&DatabaseServer::workerLoop, this);
+    }
+
+    // ʱ stoppingźŴֻ־
+    while (!stopping)
+    {
+        fd_set ready;
+        FD_ZERO(&ready);
+        SocketHandle highest = wakeSocket;
+        FD_SET(wakeSocket, &ready);
+        for (auto sock : listeners)
+        {
+            FD_SET(sock, &ready);
+            highest = std::max(highest, sock);
+        }
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            for (auto sock : idleSessions)
+            {
+                FD_SET(sock, &ready);
+                highest = std::max(highest, sock);
+            }
+        }
+        timeval timeout;
+        timeout.tv_sec = 0;
+        timeout.tv_usec = 200 * 1000;
+        if (select(static_cast<int>(highest + 1), &ready, nullptr, nullptr, &timeout) <= 0)
+        {
+            continue;
+        }
+
+        if (FD_ISSET(wakeSocket, &ready))
+        {
+            char bytes[64];
+            recv(wakeSocket, bytes, sizeof(bytes), 0);
+        }
+        for (auto sock : listeners)
+        {
+            if (FD_ISSET(sock, &ready))
+            {
+                acceptConnection(sock);
+            }
+        }
+
+        // ɶĿӽ߳
+        std::lock_guard<std::mutex> lock(queueMutex);
+        for (auto it = idleSessions.begin(); it != idleSessions.end();)
+        {
+            if (FD_ISSET(*it, &ready))
+            {
+                readySessions.emplace_back(*it, Clock::now() + std::chrono::milliseconds(options.lockWaitMs));
+                queueReady.notify_one();
+                it = idleSessions.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    // ٽӣִе߳˳ٹر
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        for (auto sock : activeSessions)
+        {
+            shutdownSocket(sock);
+        }
+    }
+    queueReady.notify_all();
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+
+    std::vector<SocketHandle> remaining;
+    for (const auto& entry : sessions)
+    {
+        remaining.push_back(entry.first);
+    }
+    for (auto sock : remaining)
+    {
+        closeSession(sock);
+    }
+    closeListeners();
+    std::cerr << "Server stopped" << std::endl;
+    return true;
+}
+
+void DatabaseServer::acceptConnection(SocketHandle listener)
+{
+    SocketHandle client = accept(listener, nullptr, nullptr);
+    if (client == INVALID_HANDLE)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(queueMutex);
+    // select ֻܵȴ FD_SETSIZE ڵ׽֣Windows Ƹƽ̨ƾֵ
+#ifdef _WIN32
+    bool full = sessions.size() + listeners.size() + 1 >= FD_SETSIZE;
+#else
+    bool full = client >= FD_SETSIZE;
+#endif
+    if (full)
+    {
+        std::cerr << "Too many connections, refusing a new one" << std::endl;
+        sendResult(client, QueryResult(), "Too many connections", options.batchRows);
+        closeSocket(client);
+        return;
+    }
+    sessions[client].reset(new Session());
+    sessions[client]->id = nextSessionId++;
+    idleSessions.insert(client);
+}
+
+std::deque<std::pair<SocketHandle, DatabaseServer::Clock::time_point>>::iterator DatabaseServer::nextRunnable()
+{
+    bool open = transactionOwner == INVALID_HANDLE && waitingBegins == 0;
+    Clock::time_point now = Clock::now();
+    for (auto it = readySessions.begin(); it != readySessions.end(); ++it)
+    {
+        // յ䶼ȡ enterGate Żضе
+        // ѾʱҲȡ enterGate ش
+        if (sessions[it->first]->parked.empty() || open || it->second <= now)
+        {
+            return it;
+        }
+    }
+    return readySessions.end();
+}
+
+void DatabaseServer::workerLoop()
+{
+    while (true)
+    {
+        SocketHandle sock;
+        Clock::time_point deadline;
+        Session* session;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            auto next = readySessions.end();
+            while (!stopping && (next = nextRunnable()) == readySessions.end())
+            {
+                // ȴе䵽˽ֹʱҲҪ
+                queueReady.wait_for(lock, std::chrono::milliseconds(100));
+            }
+            if (stopping)
+            {
+                return;
+            }
+            sock = next->first;
+            deadline = next->second;
+            readySessions.erase(next);
+            activeSessions.insert(sock);
+            session = sessions[sock].get();
+        }
+
+        bool parked = false;
+        bool open = serveStatement(sock, *session, deadline, parked);
+
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            activeSessions.erase(sock);
+            if (open && !stopping)
+            {
+                if (parked)
+                {
+                    // 仹ûִУԭĽֹʱ
+                    readySessions.emplace_back(sock, deadline);
+                }
+                else
+                {
+                    idleSessions.insert(sock);
+                }
+            }
+        }
+        if (!open)
+        {
+            closeSession(sock);
+        }
+        else
+        {
+            wake();
+        }
+    }
+}
+
+bool DatabaseServer::serveStatement(SocketHandle sock, Session& session, Clock::time_point deadline,
+    bool& parked)
+{
+    FrameType type = FrameType::QUERY;
+    std::string sql;
+    bool received = true;
+    if (!session.parked.empty())
+    {
+        // ϴεȴỰŻضе䣬Ѿ϶
+        sql.swap(session.parked);
+    }
+    else
+    {
+        received = !stopping && receiveFrame(sock, type, sql);
+    }
+
+    QueryResult result;
+    std::string message;
+    bool counted = false;
+    if (received && type == FrameType::QUERY)
+    {
+        runQuery(tm, session, sql, result, message, [&](const QueryPlan& plan)
+            {
+                GateResult gate = enterGate(sock, plan, deadline, counted);
+                parked = gate == GateResult::WAIT;
+                return gate == GateResult::RUN;
+            });
+    }
+    leaveGate(sock, counted);
+
+    if (parked)
+    {
+        session.parked.swap(sql);
+        return true;
+    }
+    if (!received)
+    {
+        return false;
+    }
+    if (type != FrameType::QUERY)
+    {
+        sendResult(sock, result, "Unexpected frame type", options.batchRows);
+        return false;
+    }
+    return sendResult(sock, result, message, options.batchRows);
+}
+
+void DatabaseServer::closeSession(SocketHandle sock)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        // ϿʱعԼûύ
+        if (transactionOwner == sock)
+        {
+            TableManager::SessionId id = sessions[sock]->id;
+            if (tm.inTransaction(id))
+            {
+                std::cerr << "Session closed inside a transaction, changes discarded" << std::endl;
+                tm.rollback(id);
+            }
+            transactionOwner = INVALID_HANDLE;
+            gateChanged.notify_all();
+            queueReady.notify_all();
+        }
+        sessions.erase(sock);
+        idleSessions.erase(sock);
+    }
+    closeSocket(sock);
+}
+
+DatabaseServer::GateResult DatabaseServer::enterGate(SocketHandle sock, const QueryPlan& plan,
+    Clock::time_point deadline, bool& counted)
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
+    if (transactionOwner == sock)
+    {
+        return GateResult::RUN; // е
+    }
+
+    switch (plan.type)
+    {
+    case StatementType::SELECT:
+    case StatementType::COPY_TO:
+        return GateResult::RUN; // ڿ϶Ự
+    case StatementType::COMMIT:
+    case StatementType::ROLLBACK:
+        return GateResult::RUN; // ûԼ TableManager 
+    default:
+        break;
+    }
+
+    bool begin = plan.type == StatementType::BEGIN_TRANSACTION;
+    if (transactionOwner != INVALID_HANDLE || (!begin && waitingBegins > 0))
+    {
+        return Clock::now() < deadline ? GateResult::WAIT : GateResult::TIMEOUT;
+    }
+    if (!begin)
+    {
+        runningWrites++;
+        counted = true;
+        return GateResult::RUN;
+    }
+
+    // BEGIN Ựִед֮ǲдҪдıϡ
+    // ͬʱȴ BEGIN ĳΪߣķŻض
+    waitingBegins++;
+    bool ok = gateChanged.wait_until(lock, deadline, [this]() { return transactionOwner != INVALID_HANDLE || runningWrites == 0; });
+    waitingBegins--;
+    queueReady.notify_all(); // µ߻߷ȴöеִ
+    if (!ok)
+    {
+        return GateResult::TIMEOUT;
+    }
+    if (transactionOwner != INVALID_HANDLE)
+    {
+        return Clock::now() < deadline ? GateResult::WAIT : GateResult::TIMEOUT;
+    }
+    transactionOwner = sock;
+    return GateResult::RUN;
+}
+
+void DatabaseServer::leaveGate(SocketHandle sock, bool counted)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (counted)
+    {
+        runningWrites--;
+    }
+    // BEGIN ʧܻѾ
+    if (transactionOwner == sock && !tm.inTransaction(sessions[sock]->id))
+    {
+        transactionOwner = INVALID_HANDLE;
+        queueReady.notify_all();
+    }
+    gateChanged.notify_all();
+}
+
+DatabaseClient::~DatabaseClient()
+{
+    close();
+}
+
+bool DatabaseClient::connectUnix(const std::string& path)
+{
+    close();
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (!initSockets() || path.size() >= sizeof(address.sun_path))
+    {
+        return false;
+    }
+    strcpy(address.sun_path, path.c_str());
+
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    connected = sock != INVALID_HANDLE &&
+        connect(sock, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    if (!connected)
+    {
+        close();
+    }
+    return connected;
+}
+
+bool DatabaseClient::connectTcp(int port)
+{
+    close();
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<unsigned short>(port));
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (!initSockets())
+    {
+        return false;
+    }
+
+    sock = socket(AF_INET, SOCK_STREAM, 0);
+    connected = sock != INVALID_HANDLE &&
+        connect(sock, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    if (!connected)
+    {
+        close();
+    }
+    return connected;
+}
+
+void DatabaseClient::close()
+{
+    if (sock != INVALID_HANDLE)
+    {
+        closeSocket(sock);
+        sock = INVALID_HANDLE;
+    }
+    connected = false;
+}
+
+bool DatabaseClient::execute(const std::string& sql, QueryResult& result, std::string& message)
+{
+    result = QueryResult();
+    message.clear();
+    if (!connected || !sendFrame(sock, FrameType::QUERY, sql))
+    {
+        message = "Not connected to the server";
+        close();
+        return false;
+    }
+
+    FrameType type;
+    std::string payload;
+    while (receiveFrame(sock, type, payload))
+    {
+        PayloadReader reader(payload);
+        if (type == FrameType::HEADER)
+        {
+            size_t count = static_cast<size_t>(reader.integer(4));
+            for (size_t i = 0; i < count && reader.ok; i++)
+            {
+                result.headers.push_back(reader.text());
+            }
+        }
+        else if (type == FrameType::ROWS)
+        {
+            size_t count = static_cast<size_t>(reader.integer(4));
+            for (size_t i = 0; i < count && reader.ok; i++)
+            {
+                size_t columns = static_cast<size_t>(reader.integer(4));
+                result.rows.emplace_back();
+                for (size_t j = 0; j < columns && reader.ok; j++)
+                {
+                    result.rows.back().push_back(reader.text());
+                }
+            }
+        }
+        else if (type == FrameType::DONE)
+        {
+            result.ok = reader.integer(1) != 0;
+            result.affected = static_cast<size_t>(reader.integer(8));
+            message = reader.text();
+            if (reader.ok)
+            {
+                return result.ok;
+            }
+        }
+        else
+        {
+            reader.ok = false;
+        }
+
+        if (!reader.ok)
+        {
+            break;
+        }
+    }
+
+    message = "Connection to the server lost";
+    close();
+    result.ok = false;
+    return false;
+}
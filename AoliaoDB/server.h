@@ -0,0 +1,155 @@
+#pragma once
+#include "table_manager.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+typedef uintptr_t SocketHandle; // SOCKET
+#else
+typedef int SocketHandle;
+#endif
+
+// ؿͻ/Э飺ÿ֡Ϊ 1 ֽ + 4 ֽС˳ + ݣ
+// еΪСˣַΪ 4 ֽڳ + ֽڡ
+// ͻÿ䷢һ QUERYλظѯ HEADER
+//  ROWSÿ֡ batchRows Уһ DONE
+enum class FrameType : char
+{
+    QUERY = 'Q',  // ı
+    HEADER = 'H', //  + 
+    ROWS = 'R',   //  + еֵ
+    DONE = 'C'    // 1 ֽڳɹ־ + 8 ֽӰ + Ϣ
+};
+
+/* largest frame accepted from the other side */
+#define MAX_FRAME_BYTES (64 * 1024 * 1024)
+
+// дһ֡ӶϿ֡ʱ false
+bool sendFrame(SocketHandle sock, FrameType type, const std::string& payload);
+bool receiveFrame(SocketHandle sock, FrameType& type, std::string& payload);
+
+struct ServerOptions
+{
+    std::string socketPath; // Unix ׽·Ϊʱ
+    int tcpPort = 0;        // ֻ 127.0.0.10 ʾ
+    size_t threads = 4;     // ߳ͬʱִееӲռ߳
+    size_t batchRows = 256; // ÿ ROWS ֡
+    int lockWaitMs = 10000; // ȴỰʱ䣬ʱ䷵ش
+};
+
+struct Session;
+
+// ÿỰԼ﷨ PREPARE 䣬һ TableManager ƻ档
+// еɽӵ߳һȴյʱŽ̳߳أִһŻء
+//  select  FD_SETSIZE ƣʱյر
+class DatabaseServer
+{
+public:
+    DatabaseServer(TableManager& tm, const ServerOptions& options);
+    ~DatabaseServer();
+
+    DatabaseServer(const DatabaseServer&) = delete;
+    DatabaseServer& operator=(const DatabaseServer&) = delete;
+
+    // ֱ stopʧʱ false
+    bool run();
+
+    // ֻñ־źŴе
+    void stop()
+    {
+        stopping = true;
+    }
+
+private:
+    TableManager& tm;
+    ServerOptions options;
+    std::atomic<bool> stopping;
+
+    std::vector<SocketHandle> listeners;
+    std::vector<std::thread> workers;
+
+    // ̷߳Żʱ UDP ׽ַһֽڣѵȴ select ϵ߳
+    SocketHandle wakeSocket;
+    unsigned short wakePort = 0;
+
+    typedef std::chrono::steady_clock Clock;
+
+    //  queueMutex 
+    std::mutex queueMutex;
+    std::condition_variable queueReady;
+    std::map<SocketHandle, std::unique_ptr<Session>> sessions;
+    std::set<SocketHandle> idleSessions;  // ȴһ
+    std::deque<std::pair<SocketHandle, Clock::time_point>> readySessions; // յ䣬ȴ̣߳ԼȴĽֹʱ
+    std::set<SocketHandle> activeSessions; // ߳ڷֹͣʱرǻĶȡ
+    TableManager::SessionId nextSessionId = 1; // Ự 0 ǽ
+
+    // ţҲ queueMutex ͬһʱֻһỰ񡣲ѯ COPY TO ڿ϶
+    // ţỰҲִУϴύİ汾
+    // BEGIN ȵỰִедʱΪߣֱ COMMIT / ROLLBACK Ͽӣ
+    // ڼỰд BEGIN յŻضУռụ̀߳
+    // ȡִУֹʱ仹ûֵʱشͬһỰڲִͬ߳У
+    // ԲûȨʾ
+    std::condition_variable gateChanged;
+    size_t runningWrites = 0; // ѾͨšִеỰд
+    size_t waitingBegins = 0; //  BEGIN ڵȴʱµдҲŻضУBEGIN һֱȥ
+    SocketHandle transactionOwner;
+
+    bool listenUnix();
+    bool listenTcp();
+    bool openWakeSocket();
+    void wake();
+    void closeListeners();
+
+    void acceptConnection(SocketHandle listener);
+    void workerLoop();
+    // ִϵһ䣬ӶϿʱ false
+    // ҪỰʱظparked Ϊ trueڻỰ
+    bool serveStatement(SocketHandle sock, Session& session, Clock::time_point deadline, bool& parked);
+    // رӣعûύ
+    void closeSession(SocketHandle sock);
+
+    // ʱ queueMutexеһڿִе
+    std::deque<std::pair<SocketHandle, Clock::time_point>>::iterator nextRunnable();
+
+    enum class GateResult
+    {
+        RUN,     // ִ
+        WAIT,    // ỰŻض
+        TIMEOUT  // Ѿֹʱ
+    };
+    // 俪ʼǰţ runningWrites д counted Ϊ true뿪
+    GateResult enterGate(SocketHandle sock, const QueryPlan& plan, Clock::time_point deadline, bool& counted);
+    void leaveGate(SocketHandle sock, bool counted);
+};
+
+// ͻˣ䣬
+class DatabaseClient
+{
+public:
+    DatabaseClient() = default;
+    ~DatabaseClient();
+
+    DatabaseClient(const DatabaseClient&) = delete;
+    DatabaseClient& operator=(const DatabaseClient&) = delete;
+
+    bool connectUnix(const std::string& path);
+    bool connectTcp(int port);
+    void close();
+
+    // ִһ䣬طǷִгɹӳʱ message ˵ԭ
+    bool execute(const std::string& sql, QueryResult& result, std::string& message);
+
+private:
+    SocketHandle sock = static_cast<SocketHandle>(-1);
+    bool connected = false;
+};
@@ -0,0 +1,153 @@
+#pragma once
+#include "query_def.h"
+#include "table_def.h"
+#include <deque>
+#include <string>
+#include <string_view>
+
+// ﷨еֵֺԭʼƬΣı﷨þ
+
+// ãtable Ϊձʾûд
+struct ColumnRef
+{
+    std::string_view table;
+    std::string_view field;
+};
+
+// ֵռλ ?
+struct ValueNode
+{
+    std::string_view text;
+    int param; // ţ0ʼ-1 ʾ
+};
+
+// CREATE TABLE еһ
+struct ColumnDefNode
+{
+    std::string_view name;
+    FieldType type;
+    size_t size;
+    bool dictionary; // VARCHAR ... DICTIONARY
+};
+
+// WHERE еһ֮ AND ϵ
+struct ConditionNode
+{
+    ColumnRef column;
+    CompareOp op;
+    ValueNode value;
+};
+
+// UPDATE  SET field = value
+struct AssignmentNode
+{
+    std::string_view field;
+    ValueNode value;
+};
+
+// SELECT беһ*СۺϺ
+struct SelectItemNode
+{
+    bool isAggregate;
+    bool star; // *  COUNT(*)
+    AggregateFunc func;
+    ColumnRef column;
+};
+
+// ORDER BY еһ
+struct OrderByNode
+{
+    std::string_view field;
+    bool descending;
+};
+
+enum class StatementType
+{
+    CREATE_TABLE,
+    DROP_TABLE,
+    TRUNCATE_TABLE,
+    INSERT,
+    SELECT,
+    COPY_FROM,
+    COPY_TO,
+    PREPARE,
+    EXECUTE,
+    DEALLOCATE,
+    UPDATE,
+    DELETE_FROM, // windows.h  DELETE Ϊ
+    BEGIN_TRANSACTION,
+    COMMIT,
+    ROLLBACK
+};
+
+struct Statement
+{
+    StatementType type;
+    std::string_view table;
+    size_t paramCount; // ռλ ? ĸ
+
+    // PREPARE name AS body / EXECUTE name(values) / DEALLOCATE name
+    std::string_view name;
+    std::string_view body;
+
+    // CREATE TABLE
+    std::vector<ColumnDefNode> columns;
+    bool copyOnWrite; // WITH (COPY_ON_WRITE)
+
+    // INSERTԼ EXECUTE Ĳ INSERT δţÿ values.size() / rowCount 
+    std::vector<ValueNode> values;
+    size_t rowCount;
+    ConflictAction conflict; // OR REPLACE / ON CONFLICT
+    std::string_view conflictTarget; // ON CONFLICT (key)ʡ
+
+    // UPDATE table SET ... where УDELETE ֻ where
+    // Ҳ INSERT ... ON CONFLICT DO UPDATE SET ĸֵ
+    std::vector<AssignmentNode> assignments;
+
+    // COPY table FROM / TO 'file'COPY TO Ĺ where 
+    std::string_view fileName;
+    CopyOptions copy;
+
+    // SELECT
+    std::vector<SelectItemNode> selectList;
+    std::string_view joinTable; // Ϊձʾû JOIN
+    ColumnRef joinLeft;
+    ColumnRef joinRight;
+    std::vector<ConditionNode> where;
+    std::vector<std::string_view> groupBy;
+    std::vector<OrderByNode> orderBy;
+    size_t limit;
+    size_t offset;
+
+    // תŵַԭıжӦ string_view ָ
+    // deque ׷ʱеԪزƶ
+    std::deque<std::string> unescaped;
+
+    // ݵ vector һʱٷڴ
+    void clear()
+    {
+        table = std::string_view();
+        paramCount = 0;
+        name = std::string_view();
+        body = std::string_view();
+        fileName = std::string_view();
+        copy = CopyOptions();
+        columns.clear();
+        copyOnWrite = false;
+        values.clear();
+        rowCount = 0;
+        conflict = ConflictAction::FAIL;
+        conflictTarget = std::string_view();
+        assignments.clear();
+        selectList.clear();
+        joinTable = std::string_view();
+        joinLeft = ColumnRef();
+        joinRight = ColumnRef();
+        where.clear();
+        groupBy.clear();
+        orderBy.clear();
+        limit = NO_LIMIT;
+        offset = 0;
+        unescaped.clear();
+    }
+};
@@ -0,0 +1,158 @@
+#include "sql_lexer.h"
+
+static bool isIdentStart(unsigned char c)
+{
+    //  ASCII ֽڣʹ
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c >= 0x80;
+}
+
+static bool isIdentChar(unsigned char c)
+{
+    return isIdentStart(c) || (c >= '0' && c <= '9');
+}
+
+static bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+Token Lexer::next()
+{
+    while (pos < sql.size() && (sql[pos] == ' ' || sql[pos] == '\t' || sql[pos] == '\r' || sql[pos] == '\n'))
+    {
+        pos++;
+    }
+
+    size_t start = pos;
+    if (pos >= sql.size())
+    {
+        return Token{TokenType::END, sql.substr(pos, 0), pos};
+    }
+
+    char c = sql[pos];
+    if (isIdentStart(static_cast<unsigned char>(c)))
+    {
+        while (pos < sql.size() && isIdentChar(static_cast<unsigned char>(sql[pos])))
+        {
+            pos++;
+        }
+        return Token{TokenType::IDENT, sql.substr(start, pos - start), start};
+    }
+
+    if (isDigit(c) || (c == '-' && pos + 1 < sql.size() && isDigit(sql[pos + 1])))
+    {
+        pos++;
+        while (pos < sql.size() && isDigit(sql[pos]))
+        {
+            pos++;
+        }
+        if (pos + 1 < sql.size() && sql[pos] == '.' && isDigit(sql[pos + 1]))
+        {
+            pos++;
+            while (pos < sql.size() && isDigit(sql[pos]))
+            {
+                pos++;
+            }
+        }
+        // ָ֣1e102.5E-3
+        if (pos < sql.size() && (sql[pos] == 'e' || sql[pos] == 'E'))
+        {
+            size_t digits = pos + 1;
+            if (digits < sql.size() && (sql[digits] == '+' || sql[digits] == '-'))
+            {
+                digits++;
+            }
+            if (digits < sql.size() && isDigit(sql[digits]))
+            {
+                pos = digits;
+                while (pos < sql.size() && isDigit(sql[pos]))
+                {
+                    pos++;
+                }
+            }
+        }
+        return Token{TokenType::NUMBER, sql.substr(start, pos - start), start};
+    }
+
+    if (c == '\'' || c == '"')
+    {
+        // 'O''Brien'ıед
+        bool escaped = false;
+        size_t close = sql.find(c, pos + 1);
+        while (close != std::string_view::npos && close + 1 < sql.size() && sql[close + 1] == c)
+        {
+            escaped = true;
+            close = sql.find(c, close + 2);
+        }
+        if (close == std::string_view::npos)
+        {
+            pos = sql.size();
+            return Token{TokenType::INVALID, sql.substr(start), start};
+        }
+        pos = close + 1;
+        return Token{TokenType::STRING, sql.substr(start + 1, close - start - 1), start, escaped};
+    }
+
+    // ַıȽ
+    if (pos + 1 < sql.size())
+    {
+        char d = sql[pos + 1];
+        if ((c == '<' && (d == '=' || d == '>')) || (c == '>' && d == '=') || (c == '!' && d == '='))
+        {
+            pos += 2;
+            return Token{TokenType::SYMBOL, sql.substr(start, 2), start};
+        }
+    }
+
+    switch (c)
+    {
+    case '(':
+    case ')':
+    case ',':
+    case ';':
+    case '*':
+    case '.':
+    case '=':
+    case '<':
+    case '>':
+    case '?':
+        pos++;
+        return Token{TokenType::SYMBOL, sql.substr(start, 1), start};
+    default:
+        pos++;
+        return Token{TokenType::INVALID, sql.substr(start, 1), start};
+    }
+}
+
+std::string unescapeString(std::string_view text, char quote)
+{
+    std::string result;
+    result.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        result += text[i];
+        if (text[i] == quote && i + 1 < text.size() && text[i + 1] == quote)
+        {
+            i++;
+        }
+    }
+    return result;
+}
+
+bool equalsKeyword(std::string_view text, const char* keyword)
+{
+    size_t i = 0;
+    for (; i < text.size(); i++)
+    {
+        char c = text[i];
+        if (c >= 'a' && c <= 'z')
+        {
+            c = c - 'a' + 'A';
+        }
+        if (keyword[i] == '\0' || c != keyword[i])
+        {
+            return false;
+        }
+    }
+    return keyword[i] == '\0';
+}
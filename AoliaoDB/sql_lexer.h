@@ -0,0 +1,48 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+enum class TokenType
+{
+    IDENT,  // ʶ͹ؼ
+    NUMBER, // Сɴ
+    STRING, // еıtext ţűʾű
+    SYMBOL, // ( ) , ; * . = < > <= >= != <> ?
+    END,
+    INVALID
+};
+
+// ʷԪֻԭʼеһΣı
+struct Token
+{
+    TokenType type;
+    std::string_view text;
+    size_t pos; // еλãڱ
+    bool escaped = false; // STRING кתţtext ԭģ unescapeString ԭ
+};
+
+// ʷÿε next() һʷԪ
+class Lexer
+{
+public:
+    explicit Lexer(std::string_view sql = std::string_view()) : sql(sql), pos(0)
+    {
+    }
+
+    Token next();
+
+    std::string_view source() const
+    {
+        return sql;
+    }
+
+private:
+    std::string_view sql;
+    size_t pos;
+};
+
+// ȥ STRING еת壺 quote ԭΪһquote ΪΧı
+std::string unescapeString(std::string_view text, char quote);
+
+// ؼֱȽϣִСдkeyword Ǵд
+bool equalsKeyword(std::string_view text, const char* keyword);
@@ -0,0 +1,839 @@
+#include "sql_parser.h"
+#include <charconv>
+
+bool Parser::parse(std::string_view sql, Statement& statement)
+{
+    lexer = Lexer(sql);
+    stmt = &statement;
+    stmt->clear();
+    message.clear();
+    advance();
+
+    bool ok;
+    if (acceptKeyword("CREATE"))
+    {
+        ok = parseCreateTable();
+    }
+    else if (acceptKeyword("DROP"))
+    {
+        ok = parseDropTable();
+    }
+    else if (acceptKeyword("TRUNCATE"))
+    {
+        ok = parseTruncate();
+    }
+    else if (acceptKeyword("INSERT"))
+    {
+        ok = parseInsert();
+    }
+    else if (acceptKeyword("UPDATE"))
+    {
+        ok = parseUpdate();
+    }
+    else if (acceptKeyword("DELETE"))
+    {
+        ok = parseDelete();
+    }
+    else if (acceptKeyword("SELECT"))
+    {
+        ok = parseSelect();
+    }
+    else if (acceptKeyword("COPY"))
+    {
+        ok = parseCopy();
+    }
+    else if (acceptKeyword("PREPARE"))
+    {
+        // ԭɵ÷
+        return parsePrepare();
+    }
+    else if (acceptKeyword("EXECUTE"))
+    {
+        ok = parseExecute();
+    }
+    else if (acceptKeyword("DEALLOCATE"))
+    {
+        stmt->type = StatementType::DEALLOCATE;
+        ok = expectIdent(stmt->name);
+    }
+    else if (acceptKeyword("BEGIN"))
+    {
+        stmt->type = StatementType::BEGIN_TRANSACTION;
+        acceptKeyword("TRANSACTION");
+        ok = true;
+    }
+    else if (acceptKeyword("COMMIT"))
+    {
+        stmt->type = StatementType::COMMIT;
+        acceptKeyword("TRANSACTION");
+        ok = true;
+    }
+    else if (acceptKeyword("ROLLBACK"))
+    {
+        stmt->type = StatementType::ROLLBACK;
+        acceptKeyword("TRANSACTION");
+        ok = true;
+    }
+    else
+    {
+        return fail("CREATE, DROP, TRUNCATE, INSERT, UPDATE, DELETE, SELECT, COPY, PREPARE, EXECUTE, DEALLOCATE, BEGIN, COMMIT or ROLLBACK");
+    }
+
+    if (!ok)
+    {
+        return false;
+    }
+
+    acceptSymbol(";");
+    if (current.type != TokenType::END)
+    {
+        return fail("end of statement");
+    }
+    return true;
+}
+
+bool Parser::acceptKeyword(const char* keyword)
+{
+    if (isKeyword(keyword))
+    {
+        advance();
+        return true;
+    }
+    return false;
+}
+
+bool Parser::acceptSymbol(const char* symbol)
+{
+    if (isSymbol(symbol))
+    {
+        advance();
+        return true;
+    }
+    return false;
+}
+
+bool Parser::expectKeyword(const char* keyword)
+{
+    return acceptKeyword(keyword) || fail(keyword);
+}
+
+bool Parser::expectSymbol(const char* symbol)
+{
+    return acceptSymbol(symbol) || fail(symbol);
+}
+
+bool Parser::expectIdent(std::string_view& name)
+{
+    if (current.type != TokenType::IDENT)
+    {
+        return fail("a name");
+    }
+    name = current.text;
+    advance();
+    return true;
+}
+
+bool Parser::expectNumber(size_t& value)
+{
+    if (current.type != TokenType::NUMBER)
+    {
+        return fail("a number");
+    }
+    const char* begin = current.text.data();
+    const char* end = begin + current.text.size();
+    auto result = std::from_chars(begin, end, value);
+    if (result.ec != std::errc() || result.ptr != end)
+    {
+        return fail("a non-negative integer");
+    }
+    advance();
+    return true;
+}
+
+bool Parser::expectString(std::string_view& text)
+{
+    if (current.type != TokenType::STRING)
+    {
+        return fail("a quoted string");
+    }
+    text = tokenText();
+    advance();
+    return true;
+}
+
+std::string_view Parser::tokenText()
+{
+    if (!current.escaped)
+    {
+        return current.text;
+    }
+    stmt->unescaped.push_back(unescapeString(current.text, lexer.source()[current.pos]));
+    return stmt->unescaped.back();
+}
+
+bool Parser::fail(const char* expected)
+{
+    // ֻڳʱڴ
+    message = "expected ";
+    message += expected;
+    message += " at position " + std::to_string(current.pos);
+    if (current.type == TokenType::END)
+    {
+        message += ", got end of statement";
+    }
+    else
+    {
+        message += ", got '";
+        message.append(current.text.data(), current.text.size());
+        message += "'";
+    }
+    return false;
+}
+
+bool Parser::parseCreateTable()
+{
+    // ͼ;
+    static const struct
+    {
+        const char* name;
+        FieldType type;
+    } fixedTypes[] = {
+        {"INT", FieldType::INT},
+        {"INTEGER", FieldType::INT},
+        {"BIGINT", FieldType::BIGINT},
+        {"FLOAT", FieldType::FLOAT},
+        {"REAL", FieldType::FLOAT},
+        {"DOUBLE", FieldType::DOUBLE},
+        {"BOOLEAN", FieldType::BOOLEAN},
+        {"BOOL", FieldType::BOOLEAN},
+        {"DATE", FieldType::DATE}};
+
+    stmt->type = StatementType::CREATE_TABLE;
+    if (!expectKeyword("TABLE") || !expectIdent(stmt->table) || !expectSymbol("("))
+    {
+        return false;
+    }
+
+    do
+    {
+        ColumnDefNode column;
+        column.dictionary = false;
+        std::string_view typeName;
+        if (!expectIdent(column.name) || !expectIdent(typeName))
+        {
+            return false;
+        }
+
+        bool fixed = false;
+        for (const auto& t : fixedTypes)
+        {
+            if (equalsKeyword(typeName, t.name))
+            {
+                FieldDef field;
+                field.type = t.type;
+                field.size = 0;
+                column.type = t.type;
+                column.size = fieldWidth(field);
+                fixed = true;
+                break;
+            }
+        }
+
+        if (fixed)
+        {
+            // ȷ
+        }
+        else if (equalsKeyword(typeName, "VARCHAR"))
+        {
+            column.type = FieldType::VARCHAR;
+            column.size = 256; // ĬϴС
+            if (acceptSymbol("("))
+            {
+                if (!expectNumber(column.size) || !expectSymbol(")"))
+                {
+                    return false;
+                }
+                if (column.size == 0)
+                {
+                    message = "VARCHAR size must be positive";
+                    return false;
+                }
+            }
+            // ͻֵ룬¼ֻ
+            column.dictionary = acceptKeyword("DICTIONARY");
+        }
+        else
+        {
+            message = "unknown column type: ";
+            message.append(typeName.data(), typeName.size());
+            return false;
+        }
+        stmt->columns.push_back(column);
+    } while (acceptSymbol(","));
+
+    if (!expectSymbol(")"))
+    {
+        return false;
+    }
+
+    // ѡĿǰֻдʱ
+    if (!acceptKeyword("WITH"))
+    {
+        return true;
+    }
+    if (!expectSymbol("(") || !expectKeyword("COPY_ON_WRITE"))
+    {
+        return false;
+    }
+    stmt->copyOnWrite = true;
+    return expectSymbol(")");
+}
+
+bool Parser::parseDropTable()
+{
+    stmt->type = StatementType::DROP_TABLE;
+    return expectKeyword("TABLE") && expectIdent(stmt->table);
+}
+
+bool Parser::parseTruncate()
+{
+    stmt->type = StatementType::TRUNCATE_TABLE;
+    acceptKeyword("TABLE");
+    return expectIdent(stmt->table);
+}
+
+bool Parser::parseInsert()
+{
+    stmt->type = StatementType::INSERT;
+    if (acceptKeyword("OR"))
+    {
+        if (!expectKeyword("REPLACE"))
+        {
+            return false;
+        }
+        stmt->conflict = ConflictAction::REPLACE;
+    }
+    if (!expectKeyword("INTO") || !expectIdent(stmt->table) || !expectKeyword("VALUES"))
+    {
+        return false;
+    }
+
+    // в룺(...), (...), ... ֵη valuesÿиͬ
+    size_t width = 0;
+    do
+    {
+        if (!parseValueList())
+        {
+            return false;
+        }
+        if (stmt->rowCount == 0)
+        {
+            width = stmt->values.size();
+        }
+        else if (stmt->values.size() != width * (stmt->rowCount + 1))
+        {
+            return fail("the same number of values in every row");
+        }
+        stmt->rowCount++;
+    } while (acceptSymbol(","));
+
+    if (stmt->conflict != ConflictAction::FAIL || !acceptKeyword("ON"))
+    {
+        return true;
+    }
+
+    // ON CONFLICT [(key)] DO NOTHING | DO UPDATE SET ...ͻֻɼƻ
+    if (!expectKeyword("CONFLICT"))
+    {
+        return false;
+    }
+    if (acceptSymbol("("))
+    {
+        if (!expectIdent(stmt->conflictTarget) || !expectSymbol(")"))
+        {
+            return false;
+        }
+    }
+    if (!expectKeyword("DO"))
+    {
+        return false;
+    }
+    if (acceptKeyword("NOTHING"))
+    {
+        stmt->conflict = ConflictAction::NOTHING;
+        return true;
+    }
+    stmt->conflict = ConflictAction::UPDATE;
+    return expectKeyword("UPDATE") && expectKeyword("SET") && parseAssignments();
+}
+
+bool Parser::parseUpdate()
+{
+    stmt->type = StatementType::UPDATE;
+    if (!expectIdent(stmt->table) || !expectKeyword("SET") || !parseAssignments())
+    {
+        return false;
+    }
+    return !isKeyword("WHERE") || parseWhere();
+}
+
+bool Parser::parseAssignments()
+{
+    do
+    {
+        AssignmentNode assignment;
+        if (!expectIdent(assignment.field) || !expectSymbol("=") || !parseValue(assignment.value, true))
+        {
+            return false;
+        }
+        stmt->assignments.push_back(assignment);
+    } while (acceptSymbol(","));
+    return true;
+}
+
+bool Parser::parseDelete()
+{
+    stmt->type = StatementType::DELETE_FROM;
+    if (!expectKeyword("FROM") || !expectIdent(stmt->table))
+    {
+        return false;
+    }
+    return !isKeyword("WHERE") || parseWhere();
+}
+
+bool Parser::parseValueList()
+{
+    if (!expectSymbol("("))
+    {
+        return false;
+    }
+
+    do
+    {
+        ValueNode value;
+        if (!parseValue(value, stmt->type != StatementType::EXECUTE))
+        {
+            return false;
+        }
+        stmt->values.push_back(value);
+    } while (acceptSymbol(","));
+
+    return expectSymbol(")");
+}
+
+bool Parser::parseValue(ValueNode& value, bool allowParam)
+{
+    if (allowParam && isSymbol("?"))
+    {
+        value.text = current.text;
+        value.param = static_cast<int>(stmt->paramCount++);
+        advance();
+        return true;
+    }
+
+    if (acceptKeyword("NULL"))
+    {
+        value.text = nullText();
+        value.param = -1;
+        return true;
+    }
+
+    // ݾɵдŵĵҲΪַ
+    if (current.type != TokenType::NUMBER && current.type != TokenType::STRING &&
+        current.type != TokenType::IDENT)
+    {
+        return fail("a value");
+    }
+    value.text = tokenText();
+    value.param = -1;
+    advance();
+    return true;
+}
+
+bool Parser::parsePrepare()
+{
+    stmt->type = StatementType::PREPARE;
+    if (!expectIdent(stmt->name) || !expectKeyword("AS"))
+    {
+        return false;
+    }
+    if (current.type == TokenType::END)
+    {
+        return fail("a statement");
+    }
+
+    std::string_view sql = lexer.source();
+    stmt->body = sql.substr(current.pos);
+    return true;
+}
+
+bool Parser::parseExecute()
+{
+    stmt->type = StatementType::EXECUTE;
+    if (!expectIdent(stmt->name))
+    {
+        return false;
+    }
+    return !isSymbol("(") || parseValueList();
+}
+
+bool Parser::parseCopy()
+{
+    if (!expectIdent(stmt->table))
+    {
+        return false;
+    }
+    if (acceptKeyword("FROM"))
+    {
+        stmt->type = StatementType::COPY_FROM;
+    }
+    else if (acceptKeyword("TO"))
+    {
+        stmt->type = StatementType::COPY_TO;
+    }
+    else
+    {
+        return fail("FROM or TO");
+    }
+    if (!expectString(stmt->fileName))
+    {
+        return false;
+    }
+
+    // FORMAT ֱӸļ棬Ҳд WITH 
+    if (isKeyword("FORMAT") && !parseCopyOption())
+    {
+        return false;
+    }
+
+    if (stmt->type == StatementType::COPY_TO && isKeyword("WHERE") && !parseWhere())
+    {
+        return false;
+    }
+
+    if (!acceptKeyword("WITH"))
+    {
+        return true;
+    }
+    if (!expectSymbol("("))
+    {
+        return false;
+    }
+    do
+    {
+        if (!parseCopyOption())
+        {
+            return false;
+        }
+    } while (acceptSymbol(","));
+    return expectSymbol(")");
+}
+
+bool Parser::parseCopyOption()
+{
+    if (acceptKeyword("FORMAT"))
+    {
+        if (acceptKeyword("BINARY"))
+        {
+            stmt->copy.binary = true;
+        }
+        else if (acceptKeyword("CSV"))
+        {
+            stmt->copy.binary = false;
+        }
+        else
+        {
+            return fail("CSV or BINARY");
+        }
+    }
+    else if (acceptKeyword("DELIMITER"))
+    {
+        std::string_view delimiter;
+        if (!expectString(delimiter))
+        {
+            return false;
+        }
+        if (delimiter.size() != 1)
+        {
+            return fail("a single-character delimiter");
+        }
+        stmt->copy.delimiter = delimiter[0];
+    }
+    else if (acceptKeyword("HEADER"))
+    {
+        stmt->copy.header = true;
+        if (acceptKeyword("FALSE"))
+        {
+            stmt->copy.header = false;
+        }
+        else
+        {
+            acceptKeyword("TRUE");
+        }
+    }
+    else if (acceptKeyword("THREADS"))
+    {
+        return expectNumber(stmt->copy.threads);
+    }
+    else
+    {
+        return fail("FORMAT, DELIMITER, HEADER or THREADS");
+    }
+    return true;
+}
+
+bool Parser::parseSelect()
+{
+    stmt->type = StatementType::SELECT;
+
+    if (acceptSymbol("*"))
+    {
+        SelectItemNode item = SelectItemNode();
+        item.star = true;
+        stmt->selectList.push_back(item);
+    }
+    else
+    {
+        do
+        {
+            if (!parseSelectItem())
+            {
+                return false;
+            }
+        } while (acceptSymbol(","));
+    }
+
+    if (!expectKeyword("FROM") || !expectIdent(stmt->table))
+    {
+        return false;
+    }
+
+    if (acceptKeyword("JOIN"))
+    {
+        if (!expectIdent(stmt->joinTable) || !expectKeyword("ON") ||
+            !parseColumnRef(stmt->joinLeft) || !expectSymbol("=") || !parseColumnRef(stmt->joinRight))
+        {
+            return false;
+        }
+    }
+
+    if (isKeyword("WHERE") && !parseWhere())
+    {
+        return false;
+    }
+
+    if (acceptKeyword("GROUP"))
+    {
+        if (!expectKeyword("BY"))
+        {
+            return false;
+        }
+        do
+        {
+            std::string_view column;
+            if (!expectIdent(column))
+            {
+                return false;
+            }
+            stmt->groupBy.push_back(column);
+        } while (acceptSymbol(","));
+    }
+
+    if (acceptKeyword("ORDER"))
+    {
+        if (!expectKeyword("BY"))
+        {
+            return false;
+        }
+        do
+        {
+            OrderByNode item;
+            if (!expectIdent(item.field))
+            {
+                return false;
+            }
+            item.descending = acceptKeyword("DESC");
+            if (!item.descending)
+            {
+                acceptKeyword("ASC");
+            }
+            stmt->orderBy.push_back(item);
+        } while (acceptSymbol(","));
+    }
+
+    if (acceptKeyword("LIMIT"))
+    {
+        if (!expectNumber(stmt->limit))
+        {
+            return false;
+        }
+        if (acceptKeyword("OFFSET") && !expectNumber(stmt->offset))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Parser::parseSelectItem()
+{
+    static const struct
+    {
+        const char* name;
+        AggregateFunc func;
+    } funcs[] = {
+        {"COUNT", AggregateFunc::COUNT},
+        {"SUM", AggregateFunc::SUM},
+        {"MIN", AggregateFunc::MIN},
+        {"MAX", AggregateFunc::MAX},
+        {"AVG", AggregateFunc::AVG}};
+
+    SelectItemNode item = SelectItemNode();
+    if (!parseColumnRef(item.column))
+    {
+        return false;
+    }
+
+    // ֺŵǾۺϺ
+    if (item.column.table.empty() && acceptSymbol("("))
+    {
+        std::string_view name = item.column.field;
+        bool found = false;
+        for (const auto& f : funcs)
+        {
+            if (equalsKeyword(name, f.name))
+            {
+                item.func = f.func;
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+        {
+            message = "unknown aggregate function: ";
+            message.append(name.data(), name.size());
+            return false;
+        }
+
+        item.isAggregate = true;
+        item.column = ColumnRef();
+        if (acceptSymbol("*"))
+        {
+            item.star = true;
+        }
+        else if (!parseColumnRef(item.column))
+        {
+            return false;
+        }
+        if (!expectSymbol(")"))
+        {
+            return false;
+        }
+    }
+
+    stmt->selectList.push_back(item);
+    return true;
+}
+
+bool Parser::parseColumnRef(ColumnRef& column)
+{
+    column = ColumnRef();
+    if (!expectIdent(column.field))
+    {
+        return false;
+    }
+    if (acceptSymbol("."))
+    {
+        column.table = column.field;
+        return expectIdent(column.field);
+    }
+    return true;
+}
+
+bool Parser::parseWhere()
+{
+    if (!expectKeyword("WHERE"))
+    {
+        return false;
+    }
+    do
+    {
+        if (!parseCondition())
+        {
+            return false;
+        }
+    } while (acceptKeyword("AND"));
+    return true;
+}
+
+bool Parser::parseCondition()
+{
+    static const struct
+    {
+        const char* symbol;
+        CompareOp op;
+    } ops[] = {
+        {"=", CompareOp::EQ},
+        {"!=", CompareOp::NE},
+        {"<>", CompareOp::NE},
+        {"<", CompareOp::LT},
+        {"<=", CompareOp::LE},
+        {">", CompareOp::GT},
+        {">=", CompareOp::GE}};
+
+    ConditionNode cond;
+    if (!parseColumnRef(cond.column))
+    {
+        return false;
+    }
+
+    // field IS [NOT] NULL
+    if (acceptKeyword("IS"))
+    {
+        cond.op = acceptKeyword("NOT") ? CompareOp::IS_NOT_NULL : CompareOp::IS_NULL;
+        if (!expectKeyword("NULL"))
+        {
+            return false;
+        }
+        cond.value.param = -1;
+        stmt->where.push_back(cond);
+        return true;
+    }
+
+    // field BETWEEN a AND b  field >= a  field <= b 
+    if (acceptKeyword("BETWEEN"))
+    {
+        ConditionNode upper = cond;
+        cond.op = CompareOp::GE;
+        upper.op = CompareOp::LE;
+        if (!parseValue(cond.value, true) || !expectKeyword("AND") || !parseValue(upper.value, true))
+        {
+            return false;
+        }
+        stmt->where.push_back(cond);
+        stmt->where.push_back(upper);
+        return true;
+    }
+
+    bool found = false;
+    for (const auto& o : ops)
+    {
+        if (acceptSymbol(o.symbol))
+        {
+            cond.op = o.op;
+            found = true;
+            break;
+        }
+    }
+    if (!found)
+    {
+        return fail("a comparison operator");
+    }
+
+    if (!parseValue(cond.value, true))
+    {
+        return false;
+    }
+    stmt->where.push_back(cond);
+    return true;
+}
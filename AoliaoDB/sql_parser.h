@@ -0,0 +1,88 @@
+#pragma once
+#include "sql_ast.h"
+#include "sql_lexer.h"
+#include <string>
+
+// ݹ½﷨һʷԪǰհ
+// ֵ֧䣺
+//   CREATE TABLE name (col TYPE[(size)], ...)
+//   DROP TABLE name
+//   TRUNCATE [TABLE] name
+//   INSERT [OR REPLACE] INTO name VALUES (v1, v2, ...) [, (v1, v2, ...) ...]
+//       [ON CONFLICT [(key)] DO NOTHING | DO UPDATE SET col = v [, ...]]
+//   UPDATE name SET col = v [, col = v ...] [WHERE cond AND ...]
+//   DELETE FROM name [WHERE cond AND ...]
+//   SELECT list FROM name [JOIN name ON a.x = b.y] [WHERE cond AND ...]
+//       [GROUP BY col, ...] [ORDER BY col [ASC|DESC], ...] [LIMIT n [OFFSET m]]
+//   COPY name FROM 'file' [FORMAT CSV|BINARY] [WITH (DELIMITER 'c', HEADER [TRUE|FALSE], THREADS n)]
+//   COPY name TO 'file' [FORMAT CSV|BINARY] [WHERE cond AND ...] [WITH (DELIMITER 'c', HEADER)]
+//   PREPARE name AS statement
+//   EXECUTE name [(v1, v2, ...)]
+//   DEALLOCATE name
+//   BEGIN [TRANSACTION] / COMMIT [TRANSACTION] / ROLLBACK [TRANSACTION]
+// cond Ϊ col op vcol IS [NOT] NULL  col BETWEEN a AND b
+// INSERT / UPDATE ֵ WHERE ıȽֵǲռλ ?
+// ؼֲִСдĩβķֺſѡ
+// ַõŻ˫ıед飬 'O''Brien'
+class Parser
+{
+public:
+    // һ䵽 stmtʧʱ error() ԭ
+    bool parse(std::string_view sql, Statement& stmt);
+
+    const std::string& error() const
+    {
+        return message;
+    }
+
+private:
+    Lexer lexer;
+    Token current;
+    Statement* stmt = nullptr;
+    std::string message;
+
+    void advance()
+    {
+        current = lexer.next();
+    }
+
+    bool isKeyword(const char* keyword) const
+    {
+        return current.type == TokenType::IDENT && equalsKeyword(current.text, keyword);
+    }
+
+    bool isSymbol(const char* symbol) const
+    {
+        return current.type == TokenType::SYMBOL && current.text == symbol;
+    }
+
+    bool acceptKeyword(const char* keyword);
+    bool acceptSymbol(const char* symbol);
+    bool expectKeyword(const char* keyword);
+    bool expectSymbol(const char* symbol);
+    bool expectIdent(std::string_view& name);
+    bool expectNumber(size_t& value);
+    bool expectString(std::string_view& text);
+    // ǰʷԪıתַԭ stmt->unescaped Уûתʱڴ
+    std::string_view tokenText();
+    bool fail(const char* expected);
+
+    bool parseCreateTable();
+    bool parseDropTable();
+    bool parseTruncate();
+    bool parseInsert();
+    bool parseUpdate();
+    bool parseAssignments();
+    bool parseDelete();
+    bool parseSelect();
+    bool parseCopy();
+    bool parseCopyOption();
+    bool parsePrepare();
+    bool parseExecute();
+    bool parseSelectItem();
+    bool parseColumnRef(ColumnRef& column);
+    bool parseCondition();
+    bool parseWhere();
+    bool parseValue(ValueNode& value, bool allowParam);
+    bool parseValueList();
+};
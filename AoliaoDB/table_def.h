@@ -1,47 +1,46 @@
 #pragma once
+#include "row_layout.h"
 #include <string>
 #include <vector>
 
-enum class FieldType
-{
-    INT,
-    VARCHAR,
-    FLOAT,
-    DOUBLE
-};
-
 #pragma pack(push, 1) // ȷ1ֽڶ
-struct FieldDef
-{
-    std::string name;
-    FieldType type;
-    size_t size;
-};
-
 struct TableDef
 {
     std::string tableName;
     std::vector<FieldDef> fields;
     size_t recordSize;
+    bool orderedKeys = false;  // ͵洢Ҷ˳򼴵һеֵ˳
+    bool variableRows = false; // VARCHAR ڼ¼β¼ݱ仯
+    bool nullBitmap = false;   // ¼ԿֵλͼͷпΪ NULL
+    bool copyOnWrite = false;  // ļԭظдļ¼дԪļ
+
+    std::vector<std::shared_ptr<Dictionary>> dictionaries; //  fields Ӧֵ TableManager 
+    RowLayout layout; //  calculateRecordSize 
 
+    // ɼ¼֣recordSize Ϊ¼ĴС
     void calculateRecordSize()
     {
-        recordSize = 0;
-        for (const auto& field : fields)
+        layout.compile(fields, variableRows, nullBitmap, dictionaries);
+        recordSize = layout.recordSize();
+    }
+
+    // ֲֶ±꣬ڷ -1
+    int fieldIndex(const std::string& name) const
+    {
+        for (size_t i = 0; i < fields.size(); i++)
         {
-            switch (field.type)
+            if (fields[i].name == name)
             {
-            case FieldType::INT:
-                recordSize = (recordSize + 3) & ~3; // 4ֽڶ
-                recordSize += sizeof(int);
-                break;
-            case FieldType::VARCHAR:
-                recordSize = (recordSize + 3) & ~3; // 4ֽڶ
-                recordSize += field.size;
-                break;
+                return static_cast<int>(i);
             }
         }
-        recordSize = (recordSize + 3) & ~3; // մС4ֽڶ
+        return -1;
+    }
+
+    // ֶڶƼ¼еƫ
+    size_t fieldOffset(size_t index) const
+    {
+        return layout.column(index).offset;
     }
 };
 #pragma pack(pop)
\ No newline at end of file
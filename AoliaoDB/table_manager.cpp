@@ -1,9 +1,43 @@
 #define _CRT_SECURE_NO_WARNINGS
 #include "table_manager.h"
+#include "predicate.h"
+#include "aggregate.h"
+#include "group_by.h"
+#include "external_sort.h"
+#include "hash_join.h"
+#include "sql_parser.h"
+#include "leaf_scan.h"
+#include "csv_import.h"
+#include "csv_export.h"
+#include "field_codec.h"
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <direct.h> // for _mkdir
+
+// дʱ°汾֮򿪵ĿղܿЩ޸ģ
+// дʱƵıύı COMMIT дļ֮󷢲
+class VersionPublisher
+{
+public:
+    explicit VersionPublisher(bpt::bplus_tree* tree) : tree(tree->in_transaction() ? nullptr : tree)
+    {
+    }
+
+    ~VersionPublisher()
+    {
+        if (tree)
+        {
+            tree->publish();
+        }
+    }
+
+private:
+    bpt::bplus_tree* tree;
+};
+
 TableManager::TableManager(const std::string& dbPath) : dbPath(dbPath)
 {
     // ȷĿ¼
@@ -13,27 +47,53 @@ TableManager::TableManager(const std::string& dbPath) : dbPath(dbPath)
     mkdir(dbPath.c_str(), 0777);
 #endif
 
+    // ϴύд־жʱȲ꣬ٴ򿪱ļ
+    recoverCommitLog();
+
     // رԪ
     loadTableDefs();
 }
 
 bool TableManager::createTable(const TableDef& tableDef)
 {
+    std::unique_lock<std::shared_mutex> catalog(catalogMutex);
+    if (transaction)
+    {
+        std::cerr << "CREATE TABLE is not allowed inside a transaction" << std::endl;
+        return false;
+    }
+
     TableDef def = tableDef;
+    def.orderedKeys = true;    // ±ʹñļ
+    def.variableRows = true;   // ±ʹñ䳤¼
+    def.nullBitmap = true;     // ±ķпΪ NULL
+    if (!openDictionaries(def, true))
+    {
+        return false;
+    }
     def.calculateRecordSize(); // 㲢¼С
 
     std::string filename = dbPath + def.tableName + ".tbl";
-    tables[def.tableName] = new bpt::bplus_tree(filename.c_str(), true);
+    tables[def.tableName] = new bpt::bplus_tree(filename.c_str(), true, def.recordSize, def.copyOnWrite);
     tableDefs[def.tableName] = def;
+    tableLocks[def.tableName].reset(new TableLock);
 
     // ṹԪļ
     saveTableDefs();
+    invalidatePlans();
     return true;
 }
 
 bool TableManager::dropTable(const std::string& tableName)
 {
+    std::unique_lock<std::shared_mutex> catalog(catalogMutex);
     std::cout << "Attempting to drop table: " << tableName << std::endl;
+    if (transaction)
+    {
+        std::cerr << "DROP TABLE is not allowed inside a transaction" << std::endl;
+        return false;
+    }
+
 
     // ȼǷڣʹıƥ
     auto it = tables.find(tableName);
@@ -57,6 +117,11 @@ bool TableManager::dropTable(const std::string& tableName)
 
     std::string actualTableName = it->first;
     std::cout << "Found table: " << actualTableName << std::endl;
+    if (unappliedTables.count(actualTableName))
+    {
+        std::cerr << "Table " << actualTableName << " has committed changes waiting to be replayed" << std::endl;
+        return false;
+    }
 
     // رղɾ B+ 
     if (it->second)
@@ -67,17 +132,27 @@ bool TableManager::dropTable(const std::string& tableName)
         it->second = nullptr;
     }
     tables.erase(it);
+    tableLocks.erase(actualTableName);
+
+    // ɾֵļ
+    for (const auto& dictionary : tableDefs[actualTableName].dictionaries)
+    {
+        if (dictionary)
+        {
+            remove(dictionary->fileName().c_str());
+        }
+    }
 
     // ӱӳɾ
     tableDefs.erase(actualTableName);
+    invalidatePlans();
 
     // ɾļ
     std::string filename = dbPath + actualTableName + ".tbl";
     std::cout << "Deleting file: " << filename << std::endl;
 
-    // ȷļرպɾ
+    // ļ B+ رգֵֻڶдʱ򿪣򿪵ļӰ
 #ifdef _WIN32
-    _fcloseall(); // رд򿪵ļ
     if (_unlink(filename.c_str()) != 0)
 #else
     if (unlink(filename.c_str()) != 0)
@@ -116,8 +191,304 @@ bool TableManager::dropTable(const std::string& tableName)
     }
 }
 
+bool TableManager::truncateTable(const std::string& tableName)
+{
+    auto it = tables.find(tableName);
+    if (it == tables.end())
+    {
+        std::cerr << "Table not found: " << tableName << std::endl;
+        return false;
+    }
+
+    VersionPublisher publisher(it->second);
+
+    // ṹ䣬ļƻȻЧ
+    if (it->second->truncate() != 0)
+    {
+        std::cerr << "Failed to truncate table: " << tableName << std::endl;
+        return false;
+    }
+    std::cout << "Table " << tableName << " truncated" << std::endl;
+    return true;
+}
+
+// ύ־βıǣ˵־
+static const unsigned long long COMMIT_MARK = 0x54494d4d4f43ULL; // "COMMIT"
+
+bool TableManager::beginTransaction(SessionId session)
+{
+    std::unique_lock<std::shared_mutex> catalog(catalogMutex);
+    if (transaction)
+    {
+        std::cerr << "A transaction is already in progress" << std::endl;
+        return false;
+    }
+    if (!unappliedTables.empty())
+    {
+        // µύḲǻûطŵ־
+        std::cerr << "A committed transaction is waiting to be replayed from " << commitLogPath()
+            << ", restart before starting another" << std::endl;
+        return false;
+    }
+    // ڵһαдʱż񣬼 execute
+    transactionSession = session;
+    transaction = true;
+    return true;
+}
+
+bool TableManager::rollback(SessionId session)
+{
+    std::unique_lock<std::shared_mutex> catalog(catalogMutex);
+    if (!inTransaction(session))
+    {
+        std::cerr << "No transaction in progress" << std::endl;
+        return false;
+    }
+    for (auto& pair : tables)
+    {
+        if (pair.second->in_transaction())
+        {
+            pair.second->rollback();
+        }
+    }
+    transaction = false;
+    std::cout << "Transaction rolled back" << std::endl;
+    return true;
+}
+
+bool TableManager::commit(SessionId session)
+{
+    std::unique_lock<std::shared_mutex> catalog(catalogMutex);
+    if (!inTransaction(session))
+    {
+        std::cerr << "No transaction in progress" << std::endl;
+        return false;
+    }
+    transaction = false;
+
+    // ֻмıҪдصĿ
+    std::vector<bpt::bplus_tree*> dirty;
+    for (auto& pair : tables)
+    {
+        if (!pair.second->in_transaction())
+        {
+            continue;
+        }
+        if (!pair.second->pending_blocks().empty() || pair.second->pending_truncate())
+        {
+            dirty.push_back(pair.second);
+        }
+        else
+        {
+            pair.second->apply_pending();
+        }
+    }
+    if (dirty.empty())
+    {
+        return true;
+    }
+
+    // бĿдͬһ־ֻͬһΣͬɼύɹ
+    std::string logPath = commitLogPath();
+    FILE* log = fopen(logPath.c_str(), "wb");
+    if (!log)
+    {
+        std::cerr << "Failed to create commit log: " << logPath << std::endl;
+        for (auto tree : dirty)
+        {
+            tree->rollback();
+        }
+        return false;
+    }
+
+    bool ok = true;
+    size_t blockCount = 0;
+    for (auto tree : dirty)
+    {
+        size_t pathLength = strlen(tree->get_path());
+        char truncated = tree->pending_truncate() ? 1 : 0;
+        size_t count = tree->pending_blocks().size();
+        ok = ok && fwrite(&pathLength, sizeof(size_t), 1, log) == 1 &&
+            fwrite(tree->get_path(), pathLength, 1, log) == 1 &&
+            fwrite(&truncated, 1, 1, log) == 1 &&
+            fwrite(&count, sizeof(size_t), 1, log) == 1;
+        for (const auto& block : tree->pending_blocks())
+        {
+            size_t length = block.second.bytes.size();
+            ok = ok && fwrite(&block.first, sizeof(off_t), 1, log) == 1 &&
+                fwrite(&length, sizeof(size_t), 1, log) == 1 &&
+                (length == 0 || fwrite(block.second.bytes.data(), length, 1, log) == 1);
+        }
+        blockCount += count;
+    }
+    size_t end = 0;
+    ok = ok && fwrite(&end, sizeof(size_t), 1, log) == 1 &&
+        fwrite(&COMMIT_MARK, sizeof(COMMIT_MARK), 1, log) == 1;
+    ok = fflush(log) == 0 && ok;
+#ifdef _WIN32
+    ok = _commit(_fileno(log)) == 0 && ok;
+#else
+    ok = fsync(fileno(log)) == 0 && ok;
+#endif
+    fclose(log);
+
+    if (!ok)
+    {
+        std::cerr << "Failed to write commit log, transaction rolled back" << std::endl;
+        remove(logPath.c_str());
+        for (auto tree : dirty)
+        {
+            tree->rollback();
+        }
+        return false;
+    }
+
+    // ־ѾͬѾύ֮ʧܲٱΪύʧܡ
+    // дظļ;ʧʱ־طţٴļ´Щ
+    for (auto tree : dirty)
+    {
+        if (tree->apply_pending() != 0)
+        {
+            ok = false;
+        }
+    }
+    if (!ok)
+    {
+        std::cerr << "Failed to apply committed blocks, replaying " << logPath << std::endl;
+        bool replayed = recoverCommitLog();
+        for (auto& pair : tables)
+        {
+            auto it = std::find(dirty.begin(), dirty.end(), pair.second);
+            if (it == dirty.end())
+            {
+                continue;
+            }
+            if (!replayed)
+            {
+                // ļύݲһ£ط־֮ǰܾд
+                unappliedTables.insert(pair.first);
+                continue;
+            }
+            // ڴеԪݺҳд֮ǰģطźļ´
+            std::string path = pair.second->get_path();
+            delete pair.second;
+            pair.second = new bpt::bplus_tree(path.c_str());
+            *it = pair.second;
+        }
+        if (!replayed)
+        {
+            std::cerr << "Transaction committed but not written back, tables are read-only until "
+                << logPath << " is replayed on restart" << std::endl;
+            return true;
+        }
+    }
+    else
+    {
+        remove(logPath.c_str());
+    }
+    for (auto tree : dirty)
+    {
+        tree->publish();
+    }
+
+    std::cout << "Transaction committed: " << dirty.size() << " tables, " << blockCount << " blocks" << std::endl;
+    return true;
+}
+
+bool TableManager::recoverCommitLog()
+{
+    std::string logPath = commitLogPath();
+    FILE* log = fopen(logPath.c_str(), "rb");
+    if (!log)
+    {
+        return true;
+    }
+
+    // ֶβᳬ־𻵵־ڷڴ
+    fseek(log, 0, SEEK_END);
+    size_t logSize = static_cast<size_t>(ftell(log));
+    fseek(log, 0, SEEK_SET);
+
+    // ȶ־ȷύǺŸĶļ
+    std::vector<std::pair<std::string, bool>> files;
+    std::vector<bpt::pending_map_t> blocks;
+    bool complete = false;
+    while (true)
+    {
+        size_t pathLength;
+        if (fread(&pathLength, sizeof(size_t), 1, log) != 1)
+        {
+            break;
+        }
+        if (pathLength == 0)
+        {
+            unsigned long long mark;
+            complete = fread(&mark, sizeof(mark), 1, log) == 1 && mark == COMMIT_MARK;
+            break;
+        }
+
+        if (pathLength > logSize)
+        {
+            break;
+        }
+
+        std::string path(pathLength, '\0');
+        char truncated;
+        size_t count;
+        if (fread(&path[0], pathLength, 1, log) != 1 ||
+            fread(&truncated, 1, 1, log) != 1 || fread(&count, sizeof(size_t), 1, log) != 1)
+        {
+            break;
+        }
+
+        bpt::pending_map_t tableBlocks;
+        bool ok = true;
+        for (size_t i = 0; i < count && ok; i++)
+        {
+            off_t offset;
+            size_t length;
+            ok = fread(&offset, sizeof(off_t), 1, log) == 1 &&
+                fread(&length, sizeof(size_t), 1, log) == 1 && length <= logSize;
+            if (ok)
+            {
+                bpt::pending_block_t& block = tableBlocks[offset];
+                block.whole = true;
+                block.bytes.resize(length);
+                ok = length == 0 || fread(&block.bytes[0], length, 1, log) == 1;
+            }
+        }
+        if (!ok)
+        {
+            break;
+        }
+        files.emplace_back(path, truncated != 0);
+        blocks.push_back(std::move(tableBlocks));
+    }
+    fclose(log);
+
+    if (!complete)
+    {
+        std::cerr << "Discarding incomplete commit log: " << logPath << std::endl;
+        remove(logPath.c_str());
+        return true;
+    }
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        std::cout << "Replaying commit log into " << files[i].first << std::endl;
+        if (bpt::bplus_tree::write_blocks(files[i].first.c_str(), files[i].second, blocks[i]) != 0)
+        {
+            std::cerr << "Failed to replay commit log, keeping " << logPath << std::endl;
+            return false;
+        }
+    }
+    remove(logPath.c_str());
+    return true;
+}
+
 TableDef TableManager::getTableDef(const std::string& tableName)
 {
+    std::shared_lock<std::shared_mutex> catalog(catalogMutex);
     auto it = tableDefs.find(tableName);
     if (it != tableDefs.end())
     {
@@ -135,6 +506,8 @@ bool TableManager::insert(const std::string& tableName, const std::vector<std::s
         return false;
     }
 
+    VersionPublisher publisher(it->second);
+
     auto tableDefIt = tableDefs.find(tableName);
     if (tableDefIt == tableDefs.end())
     {
@@ -165,7 +538,7 @@ bool TableManager::insert(const std::string& tableName, const std::vector<std::s
         std::cout << "Serialized data size: " << value.size << std::endl;
 
         // ʹõһֶΪ
-        bpt::key_t key(values[0].c_str());
+        bpt::key_t key = makeKey(tableDef, values[0]);
         std::cout << "Using key: " << key.k << std::endl;
 
         // 
@@ -186,240 +559,1800 @@ bool TableManager::insert(const std::string& tableName, const std::vector<std::s
     }
 }
 
-std::vector<std::vector<std::string>> TableManager::select(const std::string& tableName, const std::string& where)
+bool TableManager::insertBatch(const std::string& tableName, const std::vector<std::vector<std::string>>& rows)
 {
-    std::vector<std::vector<std::string>> results;
     auto it = tables.find(tableName);
     if (it == tables.end())
     {
         std::cerr << "Table not found: " << tableName << std::endl;
-        return results;
+        return false;
     }
 
-    std::cout << "Selecting from table: " << tableName << std::endl;
-    bpt::bplus_tree* tree = it->second;
+    VersionPublisher publisher(it->second);
+    const TableDef& tableDef = tableDefs[tableName];
 
-    try
+    for (const auto& row : rows)
     {
-        // ļ
-        if (!tree->open_tree_file("rb+"))
+        if (row.size() != tableDef.fields.size())
         {
-            std::cerr << "Failed to open table file" << std::endl;
-            return results;
+            std::cerr << "Field count mismatch. Expected: " << tableDef.fields.size()
+                << ", Got: " << row.size() << std::endl;
+            return false;
         }
+    }
 
-        // ȡԪ
-        auto meta = tree->get_meta();
-        std::cout << "Table meta - leaf_offset: " << meta.leaf_offset
-            << ", leaf_node_num: " << meta.leaf_node_num << std::endl;
-
-        // ӵһҶӽڵ㿪ʼ
-        bpt::leaf_node_t leaf;
-        off_t current = tree->get_first_leaf();
+    try
+    {
+        std::cout << "Batch inserting " << rows.size() << " records into table: " << tableName << std::endl;
 
-        while (current != 0)
+        // B+ ˳ʱڵļͬһҶ
+        std::vector<std::pair<bpt::key_t, size_t>> order;
+        order.reserve(rows.size());
+        for (size_t i = 0; i < rows.size(); i++)
         {
-            std::cout << "Reading leaf node at offset: " << current << std::endl;
-
-            if (!tree->read_leaf_node(&leaf, current))
+            order.push_back(std::make_pair(makeKey(tableDef, rows[i][0]), i));
+        }
+        std::sort(order.begin(), order.end(),
+            [](const std::pair<bpt::key_t, size_t>& a, const std::pair<bpt::key_t, size_t>& b)
             {
-                std::cerr << "Failed to read leaf node at offset: " << current << std::endl;
-                break;
-            }
-
-            std::cout << "Leaf node contains " << leaf.n << " records" << std::endl;
+                return bpt::keycmp(a.first, b.first) < 0;
+            });
 
-            // ǰҶӽڵм¼
-            for (size_t i = 0; i < leaf.n; i++)
+        std::vector<bpt::key_t> keys;
+        keys.reserve(order.size());
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            if (i > 0 && bpt::keycmp(order[i - 1].first, order[i].first) == 0)
             {
-                const auto& record = leaf.children[i];
-                std::cout << "Record " << i << " - Key: " << record.key.k
-                    << ", Value size: " << record.value.size << std::endl;
-
-                if (record.value.data && record.value.size > 0)
-                {
-                    auto row = deserializeValues(tableDefs[tableName], record.value);
-                    if (!row.empty())
-                    {
-                        std::cout << "Deserialized record: ";
-                        for (const auto& val : row)
-                        {
-                            std::cout << val << " ";
-                        }
-                        std::cout << std::endl;
-
-                        results.push_back(std::move(row));
-                    }
-                }
+                std::cerr << "Duplicate key in batch: " << rows[order[i].second][0] << std::endl;
+                return false;
             }
+            keys.push_back(order[i].first);
+        }
 
-            current = leaf.next;
-            std::cout << "Next leaf node offset: " << current << std::endl;
+        // ˳лһ
+        std::vector<char> buffer(rows.size() * tableDef.recordSize);
+        std::vector<size_t> lengths(rows.size());
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            lengths[i] = serializeValues(tableDef, rows[order[i].second], buffer.data() + i * tableDef.recordSize);
         }
 
-        tree->close_tree_file();
+        if (!insertSorted(it->second, tableDef, keys, buffer.data(), lengths.data()))
+        {
+            return false;
+        }
+        return true;
     }
     catch (const std::exception& e)
     {
-        std::cerr << "Error in select: " << e.what() << std::endl;
-        tree->close_tree_file();
+        std::cerr << "Error during batch insert: " << e.what() << std::endl;
+        return false;
     }
-
-    std::cout << "Found " << results.size() << " records" << std::endl;
-    return results;
 }
 
-bpt::value_t TableManager::serializeValues(const TableDef& def, const std::vector<std::string>& values)
+bool TableManager::upsert(const std::string& tableName, const std::vector<std::vector<std::string>>& rows,
+    ConflictAction conflict, const std::vector<std::pair<size_t, std::string>>& assignments, size_t& count)
 {
-    std::cout << "Serializing values..." << std::endl;
-    std::cout << "Record size: " << def.recordSize << std::endl;
+    count = 0;
+    auto it = tables.find(tableName);
+    if (it == tables.end())
+    {
+        std::cerr << "Table not found: " << tableName << std::endl;
+        return false;
+    }
 
-    bpt::value_t value;
-    value.size = def.recordSize;
-    value.data = new char[value.size];
-    memset(value.data, 0, value.size);
+    VersionPublisher publisher(it->second);
+    const TableDef& def = tableDefs[tableName];
 
+    // ȱУSET ֵڵһһΣʱûд
+    std::vector<bpt::key_t> keys(rows.size());
+    std::vector<bpt::value_t> values(rows.size());
+    std::vector<char> buffer(def.recordSize);
+    std::string error;
     try
     {
-        size_t offset = 0;
-        for (size_t i = 0; i < values.size(); i++)
+        for (size_t i = 0; i < rows.size(); i++)
         {
-            const auto& field = def.fields[i];
-            std::cout << "Serializing field " << field.name << ": " << values[i] << std::endl;
-
-            // ȷ4ֽڶ
-            size_t aligned_offset = (offset + 3) & ~3;
-            if (aligned_offset != offset)
-            {
-                std::cout << "Aligning offset from " << offset << " to " << aligned_offset << std::endl;
-                offset = aligned_offset;
-            }
-
-            switch (field.type)
-            {
-            case FieldType::INT:
+            if (rows[i].size() != def.fields.size())
             {
-                int val = std::stoi(values[i]);
-                std::cout << "Writing INT " << val << " at offset " << offset << std::endl;
-                std::memcpy(value.data + offset, &val, sizeof(int));
-                offset += sizeof(int);
-
-                // ֤д
-                int check_val;
-                std::memcpy(&check_val, value.data + offset - sizeof(int), sizeof(int));
-                std::cout << "Verification read: " << check_val << std::endl;
-                break;
-            }
-
-            case FieldType::VARCHAR:
-            {
-                const std::string& str = values[i];
-                size_t strLen = std::min(str.length(), field.size - 1);
-                std::cout << "Writing VARCHAR '" << str << "' (len=" << strLen << ") at offset " << offset << std::endl;
-
-                std::memcpy(value.data + offset, str.c_str(), strLen);
-                value.data[offset + strLen] = '\0';
-
-                // ֤д
-                std::cout << "Verification read: '" << (value.data + offset) << "'" << std::endl;
-                offset += field.size;
-                break;
-            }
+                std::cerr << "Field count mismatch. Expected: " << def.fields.size()
+                    << ", Got: " << rows[i].size() << std::endl;
+                return false;
             }
+            keys[i] = makeKey(def, rows[i][0]);
+            values[i].data = new char[def.recordSize];
+            values[i].size = serializeValues(def, rows[i], values[i].data);
         }
-        std::cout << "Total bytes written: " << offset << std::endl;
     }
     catch (const std::exception& e)
     {
-        std::cerr << "Error during serialization: " << e.what() << std::endl;
-        value.clear();
-        throw;
+        std::cerr << "Error during upsert: " << e.what() << std::endl;
+        return false;
     }
-
-    return value;
-}
-
-std::vector<std::string> TableManager::deserializeValues(const TableDef& def, const bpt::value_t& data)
-{
-    std::vector<std::string> values;
-    values.reserve(def.fields.size());
-
-    if (!data.data || data.size == 0)
+    if (conflict == ConflictAction::UPDATE && !rows.empty() &&
+        def.layout.rewrite(values[0].data, values[0].size, assignments, buffer.data(), error) == 0)
     {
-        std::cerr << "Invalid data pointer or size" << std::endl;
-        return values;
+        std::cerr << "Failed to update: " << error << std::endl;
+        return false;
     }
 
-    std::cout << "Deserializing record of size " << data.size << std::endl;
-    try
+    // ѴʱREPLACE ¼¼UPDATE ֵдɼ¼NOTHING 
+    std::function<bool(bpt::value_t&)> replace;
+    if (conflict == ConflictAction::NOTHING)
     {
-        size_t offset = 0;
-        for (const auto& field : def.fields)
+        replace = [](bpt::value_t&)
         {
-            // ȷ4ֽڶ
-            size_t aligned_offset = (offset + 3) & ~3;
-            if (aligned_offset != offset)
+            return false;
+        };
+    }
+    else if (conflict == ConflictAction::UPDATE)
+    {
+        replace = [&](bpt::value_t& old)
+        {
+            size_t length = def.layout.rewrite(old.data, old.size, assignments, buffer.data(), error);
+            if (length == 0)
             {
-                std::cout << "Aligning offset from " << offset << " to " << aligned_offset << std::endl;
-                offset = aligned_offset;
+                return false;
             }
-
-            if (offset >= data.size)
+            if (length > old.size)
             {
-                std::cerr << "Offset " << offset << " exceeds data size " << data.size << std::endl;
-                break;
+                delete[] old.data;
+                old.data = new char[length];
             }
+            memcpy(old.data, buffer.data(), length);
+            old.size = length;
+            return true;
+        };
+    }
 
-            std::cout << "Reading field " << field.name << " at offset " << offset << std::endl;
-            switch (field.type)
-            {
-            case FieldType::INT:
+    for (size_t i = 0; i < rows.size(); i++)
+    {
+        int result = it->second->upsert(keys[i], values[i], replace);
+        if (result < 0)
+        {
+            std::cerr << "Failed to upsert into B+ tree, error code: " << result << std::endl;
+            return false;
+        }
+        if (result == 0 || conflict != ConflictAction::NOTHING)
+        {
+            count++;
+        }
+    }
+    return true;
+}
+
+bool TableManager::insertSorted(bpt::bplus_tree* tree, const TableDef& def,
+    const std::vector<bpt::key_t>& keys, const char* rows, const size_t* lengths)
+{
+    // ȼеļ֤ҪôȫҪô
+    bool exists = false;
+    size_t existing = 0;
+    if (tree->search_batch(keys, [&](size_t index, const bpt::value_t&)
+        {
+            if (!exists)
+            {
+                exists = true;
+                existing = index;
+            }
+        }) < 0)
+    {
+        std::cerr << "Failed to check existing keys" << std::endl;
+        return false;
+    }
+    if (exists)
+    {
+        std::vector<std::string> row = deserializeValues(def, rows + existing * def.recordSize, lengths[existing]);
+        std::cerr << "Duplicate key: " << row[0] << std::endl;
+        return false;
+    }
+
+    int result = tree->insert_batch(keys, rows, def.recordSize, lengths);
+    std::cout << "Batch insert result code: " << result << std::endl;
+    if (result != 0)
+    {
+        std::cerr << "Failed to insert into B+ tree, error code: " << result << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool TableManager::copyFrom(const std::string& tableName, const std::string& path,
+    const CopyOptions& options, size_t& count)
+{
+    count = 0;
+    auto it = tables.find(tableName);
+    if (it == tables.end())
+    {
+        std::cerr << "Table not found: " << tableName << std::endl;
+        return false;
+    }
+
+    VersionPublisher publisher(it->second);
+    const TableDef& def = tableDefs[tableName];
+
+    try
+    {
+        std::cout << "Copying " << path << " into table: " << tableName << std::endl;
+
+        CsvImporter importer(def, options, [&def](const std::string& value)
+            {
+                return makeKey(def, value);
+            });
+        if (!importer.load(path))
+        {
+            std::cerr << "Failed to load " << path << ": " << importer.error() << std::endl;
+            return false;
+        }
+        if (importer.rowCount() == 0)
+        {
+            return true;
+        }
+
+        // ձԵֱӽϲе
+        int result = it->second->bulk_load(importer.sortedKeys(), importer.rows(), def.recordSize,
+            importer.lengths());
+        if (result == 1)
+        {
+            result = insertSorted(it->second, def, importer.sortedKeys(), importer.rows(), importer.lengths()) ? 0 : -1;
+        }
+        if (result != 0)
+        {
+            return false;
+        }
+        count = importer.rowCount();
+        return true;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error during copy: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+bool TableManager::copyTo(const std::string& tableName, const std::string& path,
+    const CopyOptions& options, const std::vector<Condition>& conditions, bool ownWrites, size_t& count)
+{
+    count = 0;
+    auto it = tables.find(tableName);
+    if (it == tables.end())
+    {
+        std::cerr << "Table not found: " << tableName << std::endl;
+        return false;
+    }
+    const TableDef& def = tableDefs[tableName];
+
+    RowPredicate predicate;
+    if (!predicate.compile(def, conditions))
+    {
+        std::cerr << "Invalid WHERE clause" << std::endl;
+        return false;
+    }
+
+    std::cout << "Copying table " << tableName << " to " << path << std::endl;
+
+    // ҶҶдڴֻеǰҶ
+    RowExporter exporter(def, options);
+    if (!exporter.open(path))
+    {
+        return false;
+    }
+    bool ok = true;
+    bool scanned = scanRows(it->second, predicate, ownWrites, [&](const char* row, size_t size)
+        {
+            ok = exporter.write(row, size);
+            return ok;
+        });
+    if (!exporter.close() || !ok || !scanned)
+    {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+    count = exporter.rowCount();
+    return true;
+}
+
+const Condition* TableManager::keyCondition(const TableDef& def, const std::vector<Condition>& conditions)
+{
+    for (const auto& cond : conditions)
+    {
+        if (cond.op == CompareOp::EQ && keyLookupUsable(def, cond.field))
+        {
+            return &cond;
+        }
+    }
+    return nullptr;
+}
+
+bool TableManager::keyRange(const TableDef& def, const std::vector<Condition>& conditions,
+    bpt::key_t& left, bool& hasLeft, bpt::key_t& right, bool& hasRight)
+{
+    // ߽ȡ䣬>  < Ķ˵νų
+    hasLeft = hasRight = false;
+    //  keyOrderUsable ֻͬбĶ˳ֵ˳
+    // VARCHAR  keycmp ȱȳȣΧı˳һ£ɨɾ
+    if (!def.orderedKeys || def.fields.empty() || def.fields[0].type == FieldType::VARCHAR)
+    {
+        return false;
+    }
+    for (const auto& cond : conditions)
+    {
+        if (!keyLookupUsable(def, cond.field))
+        {
+            continue;
+        }
+        if (cond.op == CompareOp::GT || cond.op == CompareOp::GE)
+        {
+            bpt::key_t key = makeKey(def, cond.value);
+            if (!hasLeft || bpt::keycmp(key, left) > 0)
+            {
+                left = key;
+            }
+            hasLeft = true;
+        }
+        else if (cond.op == CompareOp::LT || cond.op == CompareOp::LE)
+        {
+            bpt::key_t key = makeKey(def, cond.value);
+            if (!hasRight || bpt::keycmp(key, right) < 0)
+            {
+                right = key;
+            }
+            hasRight = true;
+        }
+    }
+    return hasLeft || hasRight;
+}
+
+bool TableManager::update(const std::string& tableName, const std::vector<std::pair<size_t, std::string>>& assignments,
+    const std::vector<Condition>& conditions, size_t& count)
+{
+    count = 0;
+    auto it = tables.find(tableName);
+    if (it == tables.end())
+    {
+        std::cerr << "Table not found: " << tableName << std::endl;
+        return false;
+    }
+
+    VersionPublisher publisher(it->second);
+    const TableDef& def = tableDefs[tableName];
+
+    RowPredicate predicate;
+    if (!predicate.compile(def, conditions))
+    {
+        std::cerr << "Invalid WHERE clause" << std::endl;
+        return false;
+    }
+
+    std::vector<char> buffer(def.recordSize);
+    std::string error;
+    const Condition* keyCond = keyCondition(def, conditions);
+    if (keyCond)
+    {
+        // ֵһβңһд
+        try
+        {
+            bpt::key_t key = makeKey(def, keyCond->value);
+            bpt::value_t value;
+            if (it->second->search(key, &value) != 0 || !predicate.matches(value.data, value.size))
+            {
+                return true;
+            }
+            size_t length = def.layout.rewrite(value.data, value.size, assignments, buffer.data(), error);
+            if (length == 0)
+            {
+                std::cerr << "Failed to update: " << error << std::endl;
+                return false;
+            }
+            bpt::value_t updated;
+            updated.data = new char[length];
+            updated.size = length;
+            memcpy(updated.data, buffer.data(), length);
+            if (it->second->update(key, updated) != 0)
+            {
+                std::cerr << "Failed to update the B+ tree" << std::endl;
+                return false;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error during update: " << e.what() << std::endl;
+            return false;
+        }
+        count = 1;
+        return true;
+    }
+
+    // ֵ¼޹أһƥļ¼ʱûдκҶ
+    bool failed = false;
+    int changed = it->second->update_scan([&](const bpt::key_t&, bpt::value_t& value)
+        {
+            if (failed || !predicate.matches(value.data, value.size))
+            {
+                return false;
+            }
+            size_t length = def.layout.rewrite(value.data, value.size, assignments, buffer.data(), error);
+            if (length == 0)
+            {
+                failed = true;
+                return false;
+            }
+            if (length > value.size)
+            {
+                delete[] value.data;
+                value.data = new char[length];
+            }
+            memcpy(value.data, buffer.data(), length);
+            value.size = length;
+            return true;
+        });
+    if (failed || changed < 0)
+    {
+        std::cerr << "Failed to update: " << (failed ? error : "B+ tree error") << std::endl;
+        return false;
+    }
+    count = static_cast<size_t>(changed);
+    std::cout << "Updated " << count << " records" << std::endl;
+    return true;
+}
+
+bool TableManager::deleteRecords(const std::string& tableName, const std::vector<Condition>& conditions, size_t& count)
+{
+    count = 0;
+    auto it = tables.find(tableName);
+    if (it == tables.end())
+    {
+        std::cerr << "Table not found: " << tableName << std::endl;
+        return false;
+    }
+
+    VersionPublisher publisher(it->second);
+    const TableDef& def = tableDefs[tableName];
+
+    RowPredicate predicate;
+    if (!predicate.compile(def, conditions))
+    {
+        std::cerr << "Invalid WHERE clause" << std::endl;
+        return false;
+    }
+
+    const Condition* keyCond = keyCondition(def, conditions);
+    if (keyCond)
+    {
+        try
+        {
+            bpt::key_t key = makeKey(def, keyCond->value);
+            bpt::value_t value;
+            if (it->second->search(key, &value) != 0 || !predicate.matches(value.data, value.size))
+            {
+                return true;
+            }
+            if (it->second->remove(key) != 0)
+            {
+                std::cerr << "Failed to remove from the B+ tree" << std::endl;
+                return false;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << "Error during delete: " << e.what() << std::endl;
+            return false;
+        }
+        count = 1;
+        return true;
+    }
+
+    auto match = [&](const bpt::key_t&, const bpt::value_t& value)
+    {
+        return predicate.matches(value.data, value.size);
+    };
+
+    int removed;
+    bpt::key_t left, right;
+    bool hasLeft, hasRight;
+    try
+    {
+        removed = keyRange(def, conditions, left, hasLeft, right, hasRight) ?
+            it->second->remove_range(hasLeft ? &left : nullptr, hasRight ? &right : nullptr, match) :
+            it->second->remove_scan(match);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error during delete: " << e.what() << std::endl;
+        return false;
+    }
+    if (removed < 0)
+    {
+        std::cerr << "Failed to delete from the B+ tree" << std::endl;
+        return false;
+    }
+    count = static_cast<size_t>(removed);
+    std::cout << "Deleted " << count << " records" << std::endl;
+    return true;
+}
+
+bool TableManager::keyOrderUsable(const TableDef& def, const SelectOptions& options)
+{
+    // û ORDER BY ʱ˳򷵻أҼ˳˳һʱֱҶɨ
+    if (options.orderBy.empty())
+    {
+        return true;
+    }
+    return options.orderBy.size() == 1 && options.orderBy[0].field == def.fields[0].name &&
+        def.orderedKeys && def.fields[0].type != FieldType::VARCHAR;
+}
+
+// Ӻͷʱļǰ׺ͬʱִе䲻Ṳļ
+static std::string tempFilePrefix(const std::string& base)
+{
+    static std::atomic<unsigned long long> sequence(0);
+    return base + std::to_string(++sequence) + "_";
+}
+
+std::vector<std::vector<std::string>> TableManager::sortScan(const std::string& tableName,
+    const RowPredicate& predicate, const SelectOptions& options, bool ownWrites)
+{
+    std::vector<std::vector<std::string>> results;
+    const TableDef& def = tableDefs[tableName];
+    bpt::bplus_tree* tree = tables[tableName];
+
+    // top-N Ҫ OFFSET + LIMIT 
+    size_t keep = options.limit == NO_LIMIT ? NO_LIMIT : options.limit + options.offset;
+    size_t skipped = 0;
+
+    SortKeyLayout keyLayout;
+    if (!keyLayout.compile(def, options.orderBy))
+    {
+        return results;
+    }
+
+    std::cout << "Sorting table: " << tableName << std::endl;
+
+    try
+    {
+        ExternalSorter sorter(&keyLayout, tempFilePrefix(dbPath + tableName + ".sort_"), keep, def.recordSize);
+        bool ok = scanRows(tree, predicate, ownWrites, [&](const char* row, size_t size)
+            {
+                return sorter.add(row, size);
+            });
+
+        if (!ok || !sorter.finish([&](const char* row, size_t size)
+            {
+                if (skipped < options.offset)
+                {
+                    skipped++;
+                    return true;
+                }
+                results.push_back(deserializeValues(def, row, size));
+                return results.size() < options.limit;
+            }))
+        {
+            std::cerr << "Sort failed for table: " << tableName << std::endl;
+            results.clear();
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error in select: " << e.what() << std::endl;
+        results.clear();
+    }
+
+    std::cout << "Found " << results.size() << " records" << std::endl;
+    return results;
+}
+
+std::vector<std::vector<std::string>> TableManager::scanKeyOrder(const std::string& tableName,
+    const RowPredicate& predicate, bool descending, size_t limit, size_t offset, bool ownWrites)
+{
+    std::vector<std::vector<std::string>> results;
+    if (limit == 0)
+    {
+        return results;
+    }
+
+    const TableDef& def = tableDefs[tableName];
+    bpt::bplus_tree* tree = tables[tableName];
+    size_t skipped = 0;
+    size_t leavesRead = 0;
+
+    try
+    {
+        bpt::snapshot_reader reader(tree, nullptr, ownWrites);
+        if (!reader.is_open())
+        {
+            std::cerr << "Failed to open table file" << std::endl;
+            return results;
+        }
+
+        bpt::leaf_node_t leaf;
+        off_t current = descending ? reader.last_leaf() : reader.first_leaf();
+        bool done = false;
+        while (current != 0 && !done)
+        {
+            if (!reader.read_leaf(&leaf, current))
+            {
+                std::cerr << "Failed to read leaf node at offset: " << current << std::endl;
+                break;
+            }
+            leavesRead++;
+
+            for (size_t j = 0; j < leaf.n && !done; j++)
+            {
+                const auto& value = leaf.children[descending ? leaf.n - 1 - j : j].value;
+                if (!value.data || value.size == 0 || !predicate.matches(value.data, value.size))
+                {
+                    continue;
+                }
+                if (skipped < offset)
+                {
+                    skipped++;
+                    continue;
+                }
+                results.push_back(deserializeValues(def, value));
+                done = results.size() >= limit;
+            }
+
+            current = descending ? leaf.prev : leaf.next;
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error in select: " << e.what() << std::endl;
+    }
+
+    std::cout << "Found " << results.size() << " records, read " << leavesRead
+        << " of " << tree->get_published_meta().leaf_node_num << " leaves" << std::endl;
+    return results;
+}
+
+bool TableManager::scanRows(bpt::bplus_tree* tree, const RowPredicate& predicate, bool ownWrites,
+    const std::function<bool(const char*, size_t)>& callback)
+{
+    // ڿɨ裬ɨڼд벻ı
+    bpt::snapshot_reader reader(tree, nullptr, ownWrites);
+    if (!reader.is_open())
+    {
+        std::cerr << "Failed to open table file" << std::endl;
+        return false;
+    }
+
+    bpt::leaf_node_t leaf;
+    off_t current = reader.first_leaf();
+    bool ok = true;
+    while (current != 0 && ok)
+    {
+        if (!reader.read_leaf(&leaf, current))
+        {
+            std::cerr << "Failed to read leaf node at offset: " << current << std::endl;
+            break;
+        }
+
+        for (size_t i = 0; i < leaf.n && ok; i++)
+        {
+            const auto& value = leaf.children[i].value;
+            if (value.data && value.size > 0 && predicate.matches(value.data, value.size))
+            {
+                ok = callback(value.data, value.size);
+            }
+        }
+        current = leaf.next;
+    }
+    return ok;
+}
+
+std::vector<std::vector<std::string>> TableManager::join(const JoinDef& joinDef,
+    const std::vector<Condition>& conditions, bool ownWrites)
+{
+    std::vector<std::vector<std::string>> results;
+    auto leftIt = tables.find(joinDef.leftTable);
+    auto rightIt = tables.find(joinDef.rightTable);
+    if (leftIt == tables.end() || rightIt == tables.end())
+    {
+        std::cerr << "Table not found: "
+            << (leftIt == tables.end() ? joinDef.leftTable : joinDef.rightTable) << std::endl;
+        return results;
+    }
+
+    const TableDef& leftDef = tableDefs[joinDef.leftTable];
+    const TableDef& rightDef = tableDefs[joinDef.rightTable];
+
+    JoinKeyColumn leftKey;
+    JoinKeyColumn rightKey;
+    if (!leftKey.compile(leftDef, joinDef.leftField) || !rightKey.compile(rightDef, joinDef.rightField))
+    {
+        return results;
+    }
+    if (leftKey.field.type != rightKey.field.type)
+    {
+        std::cerr << "JOIN columns have different types" << std::endl;
+        return results;
+    }
+
+    // WHERE ǰ׺ָ࣬ûǰ׺ʱֶ
+    std::vector<Condition> leftConditions;
+    std::vector<Condition> rightConditions;
+    for (auto cond : conditions)
+    {
+        size_t dot = cond.field.find('.');
+        std::string table = dot == std::string::npos ? "" : cond.field.substr(0, dot);
+        cond.field = cond.field.substr(dot == std::string::npos ? 0 : dot + 1);
+
+        if (table == joinDef.leftTable || (table.empty() && leftDef.fieldIndex(cond.field) >= 0))
+        {
+            leftConditions.push_back(cond);
+        }
+        else if (table == joinDef.rightTable || (table.empty() && rightDef.fieldIndex(cond.field) >= 0))
+        {
+            rightConditions.push_back(cond);
+        }
+        else
+        {
+            std::cerr << "Unknown field in WHERE: " << cond.field << std::endl;
+            return results;
+        }
+    }
+    RowPredicate leftPredicate;
+    RowPredicate rightPredicate;
+    if (!leftPredicate.compile(leftDef, leftConditions) || !rightPredicate.compile(rightDef, rightConditions))
+    {
+        std::cerr << "Invalid WHERE clause" << std::endl;
+        return results;
+    }
+
+    // ǴһСöʱСӼ B+ ɨ
+    // ϣӣҶٵһΪ build 
+    size_t leftLeaves = leftIt->second->get_published_meta().leaf_node_num;
+    size_t rightLeaves = rightIt->second->get_published_meta().leaf_node_num;
+    bool indexRight = keyLookupUsable(rightDef, joinDef.rightField) &&
+        leftLeaves * INDEX_JOIN_LEAF_RATIO <= rightLeaves;
+    bool indexLeft = !indexRight && keyLookupUsable(leftDef, joinDef.leftField) &&
+        rightLeaves * INDEX_JOIN_LEAF_RATIO <= leftLeaves;
+
+    // emit ĵһ build ࣨʱΪࣩļ¼
+    bool buildLeft = indexRight || (!indexLeft && leftLeaves <= rightLeaves);
+    bpt::bplus_tree* buildTree = buildLeft ? leftIt->second : rightIt->second;
+    bpt::bplus_tree* probeTree = buildLeft ? rightIt->second : leftIt->second;
+    const RowPredicate& buildPredicate = buildLeft ? leftPredicate : rightPredicate;
+    const RowPredicate& probePredicate = buildLeft ? rightPredicate : leftPredicate;
+
+    try
+    {
+        HashJoiner::JoinCallback emit = [&](const char* buildRow, size_t buildSize,
+            const char* probeRow, size_t probeSize)
+        {
+            std::vector<std::string> row = deserializeValues(leftDef,
+                buildLeft ? buildRow : probeRow, buildLeft ? buildSize : probeSize);
+            std::vector<std::string> right = deserializeValues(rightDef,
+                buildLeft ? probeRow : buildRow, buildLeft ? probeSize : buildSize);
+            row.insert(row.end(), right.begin(), right.end());
+            results.push_back(std::move(row));
+        };
+
+        bool ok;
+        if (indexLeft || indexRight)
+        {
+            std::cout << "Index nested loop join, inner side: "
+                << (indexRight ? joinDef.rightTable : joinDef.leftTable) << std::endl;
+            ok = indexJoin(buildTree, buildPredicate, buildLeft ? leftKey : rightKey,
+                indexRight ? rightDef : leftDef, probeTree, probePredicate, ownWrites, emit);
+        }
+        else
+        {
+            std::cout << "Hash join, build side: "
+                << (buildLeft ? joinDef.leftTable : joinDef.rightTable) << std::endl;
+
+            HashJoiner joiner(buildLeft ? leftKey : rightKey, buildLeft ? rightKey : leftKey,
+                tempFilePrefix(dbPath + joinDef.leftTable + "_" + joinDef.rightTable + ".join_"));
+            ok = scanRows(buildTree, buildPredicate, ownWrites, [&](const char* row, size_t size)
+                {
+                    return joiner.build(row, size);
+                });
+            ok = ok && scanRows(probeTree, probePredicate, ownWrites, [&](const char* row, size_t size)
+                {
+                    return joiner.probe(row, size, emit);
+                });
+            ok = ok && joiner.finish(emit);
+        }
+
+        if (!ok)
+        {
+            std::cerr << "Join failed" << std::endl;
+            results.clear();
+        }
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error in join: " << e.what() << std::endl;
+        results.clear();
+    }
+
+    std::cout << "Found " << results.size() << " records" << std::endl;
+    return results;
+}
+
+bool TableManager::keyLookupUsable(const TableDef& def, const std::string& field)
+{
+    // ɱ INT ǲʱԭʼıͬһֵвͬдڲ
+    return !def.fields.empty() && def.fields[0].name == field &&
+        (def.fields[0].type == FieldType::VARCHAR || def.orderedKeys);
+}
+
+bool TableManager::indexJoin(bpt::bplus_tree* outerTree, const RowPredicate& outerPredicate,
+    const JoinKeyColumn& outerKey, const TableDef& innerDef, bpt::bplus_tree* innerTree,
+    const RowPredicate& innerPredicate, bool ownWrites, const HashJoiner::JoinCallback& emit)
+{
+    // ¼棬ÿңͬһҶϵļֻһҶӡ
+    // ڱһϲңбд벻Ӱ
+    bpt::snapshot_reader inner(innerTree, nullptr, ownWrites);
+    if (!inner.is_open())
+    {
+        std::cerr << "Failed to open table file" << std::endl;
+        return false;
+    }
+    std::vector<std::string> batch;
+    size_t probes = 0;
+    size_t leafReads = 0;
+
+    auto probeBatch = [&]() -> bool
+    {
+        std::vector<std::pair<bpt::key_t, size_t>> order;
+        for (size_t i = 0; i < batch.size(); i++)
+        {
+            const std::string& row = batch[i];
+            if (outerKey.offset + outerKey.layout.width > row.size() || outerKey.layout.isNull(row.data()))
+            {
+                continue;
+            }
+
+            if (outerKey.field.type != FieldType::VARCHAR)
+            {
+                // ͵ڱһʹֱɶֵɼı
+                const char* field = row.data() + outerKey.offset;
+                order.push_back(std::make_pair(bpt::key_t(orderedKeyText(outerKey.field, field).c_str()), i));
+                continue;
+            }
+
+            std::string value(outerKey.layout.text(row.data(), row.size()));
+            if (value.size() >= sizeof(bpt::key_t().k))
+            {
+                continue; // ȵֵ
+            }
+            order.push_back(std::make_pair(makeKey(innerDef, value), i));
+        }
+
+        std::sort(order.begin(), order.end(),
+            [](const std::pair<bpt::key_t, size_t>& a, const std::pair<bpt::key_t, size_t>& b)
+            {
+                return bpt::keycmp(a.first, b.first) < 0;
+            });
+
+        std::vector<bpt::key_t> keys;
+        keys.reserve(order.size());
+        for (const auto& item : order)
+        {
+            keys.push_back(item.first);
+        }
+
+        int reads = inner.search_batch(keys, [&](size_t k, const bpt::value_t& value)
+            {
+                if (value.data && value.size > 0 && innerPredicate.matches(value.data, value.size))
+                {
+                    const std::string& row = batch[order[k].second];
+                    emit(row.data(), row.size(), value.data, value.size);
+                }
+            });
+
+        if (reads < 0)
+        {
+            return false;
+        }
+        probes += keys.size();
+        leafReads += reads;
+        batch.clear();
+        return true;
+    };
+
+    bool ok = scanRows(outerTree, outerPredicate, ownWrites, [&](const char* row, size_t size)
+        {
+            batch.push_back(std::string(row, size));
+            return batch.size() < INDEX_JOIN_BATCH || probeBatch();
+        });
+    ok = ok && (batch.empty() || probeBatch());
+
+    std::cout << "Index join probed " << probes << " keys with " << leafReads
+        << " leaf reads" << std::endl;
+    return ok;
+}
+
+std::vector<std::vector<std::string>> TableManager::aggregate(const std::string& tableName,
+    const std::vector<std::string>& groupBy, const std::vector<AggregateDef>& aggregates,
+    const std::vector<Condition>& conditions, bool ownWrites)
+{
+    std::vector<std::vector<std::string>> results;
+    auto it = tables.find(tableName);
+    if (it == tables.end())
+    {
+        std::cerr << "Table not found: " << tableName << std::endl;
+        return results;
+    }
+
+    const TableDef& def = tableDefs[tableName];
+
+    RowPredicate predicate;
+    if (!predicate.compile(def, conditions))
+    {
+        std::cerr << "Invalid WHERE clause" << std::endl;
+        return results;
+    }
+
+    AggregateEvaluator evaluator;
+    if (!evaluator.compile(def, aggregates))
+    {
+        return results;
+    }
+
+    GroupKeyLayout keyLayout;
+    if (!groupBy.empty() && !keyLayout.compile(def, groupBy))
+    {
+        return results;
+    }
+
+    std::cout << "Aggregating table: " << tableName << std::endl;
+
+    try
+    {
+        LeafScanner scanner(it->second, ownWrites);
+        size_t workers = std::max<size_t>(scanner.partition(), 1);
+
+        if (!groupBy.empty())
+        {
+            // ۺϣÿ߳һعϣڴԤʱĿ¼
+            GroupAggregator grouper(&keyLayout, &evaluator, workers,
+                tempFilePrefix(dbPath + tableName + ".groupby_"));
+            std::atomic<bool> spillOk(true);
+            bool ok = scanner.run([&](size_t worker, const bpt::leaf_node_t& leaf)
+                {
+                    for (size_t i = 0; i < leaf.n; i++)
+                    {
+                        const auto& value = leaf.children[i].value;
+                        if (value.data && value.size > 0 && predicate.matches(value.data, value.size) &&
+                            !grouper.accumulate(worker, value.data, value.size))
+                        {
+                            spillOk = false;
+                        }
+                    }
+                });
+
+            if (!ok || !spillOk || !grouper.finish(results))
+            {
+                std::cerr << "Group by failed for table: " << tableName << std::endl;
+                results.clear();
+            }
+            return results;
+        }
+
+        // ÿֻ߳дԼĲ״̬
+        std::vector<std::vector<AggregateState>> partials(workers, evaluator.createStates());
+        bool ok = scanner.run([&](size_t worker, const bpt::leaf_node_t& leaf)
+            {
+                AggregateState* states = partials[worker].data();
+                for (size_t i = 0; i < leaf.n; i++)
+                {
+                    const auto& value = leaf.children[i].value;
+                    if (value.data && value.size > 0 && predicate.matches(value.data, value.size))
+                    {
+                        evaluator.accumulate(states, value.data, value.size);
+                    }
+                }
+            });
+
+        if (!ok)
+        {
+            std::cerr << "Parallel scan failed for table: " << tableName << std::endl;
+            return results;
+        }
+
+        // ϲ״̬
+        for (size_t i = 1; i < partials.size(); i++)
+        {
+            evaluator.merge(partials[0].data(), partials[i].data());
+        }
+        results.push_back(evaluator.finalize(partials[0].data()));
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error in aggregate: " << e.what() << std::endl;
+    }
+
+    return results;
+}
+
+void TableManager::invalidatePlans()
+{
+    // ṹ仯󻺴ļƻȫϣ PREPARE ļƻִʱ±
+    schemaVersion++;
+    std::lock_guard<std::mutex> lock(planMutex);
+    planCache.clear();
+}
+
+std::shared_ptr<const QueryPlan> TableManager::prepare(const std::string& sql, std::string& error)
+{
+    std::string key;
+    if (!normalizeStatement(sql, key, nullptr))
+    {
+        error = "invalid token in statement";
+        return nullptr;
+    }
+    return compile(key, error);
+}
+
+std::shared_ptr<const QueryPlan> TableManager::prepare(const std::string& sql,
+    std::vector<std::string>& params, std::string& error)
+{
+    std::string key;
+    params.clear();
+    if (!normalizeStatement(sql, key, &params))
+    {
+        error = "invalid token in statement";
+        return nullptr;
+    }
+    return compile(key, error);
+}
+
+std::shared_ptr<const QueryPlan> TableManager::compile(const std::string& text, std::string& error)
+{
+    // ڼṹ仯ƻе schemaVersion ıһ
+    std::shared_lock<std::shared_mutex> catalog(catalogMutex);
+    std::shared_ptr<const QueryPlan> cached;
+    {
+        std::lock_guard<std::mutex> lock(planMutex);
+        cached = planCache.find(text);
+    }
+    if (cached && cached->schemaVersion == schemaVersion)
+    {
+        return cached;
+    }
+
+    Parser parser;
+    Statement stmt;
+    if (!parser.parse(text, stmt))
+    {
+        error = parser.error();
+        return nullptr;
+    }
+
+    std::shared_ptr<QueryPlan> plan = std::make_shared<QueryPlan>();
+    plan->text = text;
+    if (!buildPlan(stmt, *plan, error))
+    {
+        return nullptr;
+    }
+
+    // DDL ִֻһΣ
+    if (plan->type == StatementType::INSERT || plan->type == StatementType::SELECT ||
+        plan->type == StatementType::UPDATE || plan->type == StatementType::DELETE_FROM)
+    {
+        std::lock_guard<std::mutex> lock(planMutex);
+        planCache.insert(text, plan);
+    }
+    return plan;
+}
+
+// ﷨еֵתΪƻеֵ
+static PlanValue toPlanValue(const ValueNode& node)
+{
+    PlanValue value;
+    value.param = node.param;
+    if (node.param < 0)
+    {
+        value.literal = std::string(node.text);
+    }
+    return value;
+}
+
+bool TableManager::buildPlan(const Statement& stmt, QueryPlan& plan, std::string& error)
+{
+    plan.type = stmt.type;
+    plan.schemaVersion = schemaVersion;
+    plan.paramCount = stmt.paramCount;
+    plan.tableName = std::string(stmt.table);
+
+    switch (stmt.type)
+    {
+    case StatementType::CREATE_TABLE:
+        plan.tableDef.tableName = plan.tableName;
+        for (const auto& column : stmt.columns)
+        {
+            FieldDef field;
+            field.name = std::string(column.name);
+            field.type = column.type;
+            field.size = column.size;
+            field.dictionary = column.dictionary;
+            if (field.dictionary && plan.tableDef.fields.empty())
+            {
+                error = "the primary key cannot use a dictionary: " + field.name;
+                return false;
+            }
+            plan.tableDef.fields.push_back(field);
+        }
+        plan.tableDef.copyOnWrite = stmt.copyOnWrite;
+        plan.tableDef.calculateRecordSize();
+        return true;
+
+    case StatementType::DROP_TABLE:
+        return true;
+
+    case StatementType::BEGIN_TRANSACTION:
+    case StatementType::COMMIT:
+    case StatementType::ROLLBACK:
+        return true;
+
+    case StatementType::TRUNCATE_TABLE:
+        if (tableDefs.find(plan.tableName) == tableDefs.end())
+        {
+            error = "table not found: " + plan.tableName;
+            return false;
+        }
+        return true;
+
+    case StatementType::INSERT:
+    {
+        auto it = tableDefs.find(plan.tableName);
+        if (it == tableDefs.end())
+        {
+            error = "table not found: " + plan.tableName;
+            return false;
+        }
+        if (stmt.values.size() != it->second.fields.size() * stmt.rowCount)
+        {
+            error = "expected " + std::to_string(it->second.fields.size()) + " values, got " +
+                std::to_string(stmt.values.size() / stmt.rowCount);
+            return false;
+        }
+        plan.rowCount = stmt.rowCount;
+        for (const auto& value : stmt.values)
+        {
+            plan.values.push_back(toPlanValue(value));
+        }
+
+        plan.conflict = stmt.conflict;
+        if (!stmt.conflictTarget.empty() && stmt.conflictTarget != it->second.fields[0].name)
+        {
+            error = "ON CONFLICT only supports the primary key: " + std::string(stmt.conflictTarget);
+            return false;
+        }
+        return buildAssignments(stmt, it->second, plan, error);
+    }
+
+    case StatementType::COPY_FROM:
+    case StatementType::COPY_TO:
+        if (tableDefs.find(plan.tableName) == tableDefs.end())
+        {
+            error = "table not found: " + plan.tableName;
+            return false;
+        }
+        plan.fileName = std::string(stmt.fileName);
+        plan.copy = stmt.copy;
+        return buildWhere(stmt, plan, error);
+
+    case StatementType::UPDATE:
+    {
+        auto it = tableDefs.find(plan.tableName);
+        if (it == tableDefs.end())
+        {
+            error = "table not found: " + plan.tableName;
+            return false;
+        }
+        return buildAssignments(stmt, it->second, plan, error) && buildWhere(stmt, plan, error);
+    }
+
+    case StatementType::DELETE_FROM:
+        if (tableDefs.find(plan.tableName) == tableDefs.end())
+        {
+            error = "table not found: " + plan.tableName;
+            return false;
+        }
+        return buildWhere(stmt, plan, error);
+
+    case StatementType::SELECT:
+        return buildSelectPlan(stmt, plan, error);
+
+    default:
+        error = "PREPARE / EXECUTE / DEALLOCATE cannot be prepared";
+        return false;
+    }
+}
+
+bool TableManager::buildAssignments(const Statement& stmt, const TableDef& def, QueryPlan& plan, std::string& error)
+{
+    for (const auto& assignment : stmt.assignments)
+    {
+        int index = def.fieldIndex(std::string(assignment.field));
+        if (index < 0)
+        {
+            error = "unknown field in SET: " + std::string(assignment.field);
+            return false;
+        }
+        if (index == 0)
+        {
+            error = "the primary key cannot be updated: " + std::string(assignment.field);
+            return false;
+        }
+        plan.assignments.emplace_back(static_cast<size_t>(index), toPlanValue(assignment.value));
+    }
+    return true;
+}
+
+bool TableManager::buildWhere(const Statement& stmt, QueryPlan& plan, std::string& error)
+{
+    bool isJoin = !stmt.joinTable.empty();
+
+    // WHERE JOIN ʱֶд .ֶΣ join() ָࣻǲѯı
+    for (const auto& node : stmt.where)
+    {
+        PlanCondition cond;
+        cond.cond.op = node.op;
+        cond.cond.field = std::string(node.column.field);
+        cond.param = node.value.param;
+        if (node.value.param < 0)
+        {
+            cond.cond.value = std::string(node.value.text);
+        }
+        if (!node.column.table.empty())
+        {
+            if (isJoin)
+            {
+                cond.cond.field = std::string(node.column.table) + "." + cond.cond.field;
+            }
+            else if (node.column.table != stmt.table)
+            {
+                error = "unknown table in WHERE: " + std::string(node.column.table);
+                return false;
+            }
+        }
+        plan.where.push_back(cond);
+    }
+    return true;
+}
+
+bool TableManager::buildSelectPlan(const Statement& stmt, QueryPlan& plan, std::string& error)
+{
+    bool isJoin = !stmt.joinTable.empty();
+    for (std::string_view table : {stmt.table, stmt.joinTable})
+    {
+        if (!table.empty() && tableDefs.find(std::string(table)) == tableDefs.end())
+        {
+            error = "table not found: " + std::string(table);
+            return false;
+        }
+    }
+    const TableDef& def = tableDefs[plan.tableName];
+
+    if (!buildWhere(stmt, plan, error))
+    {
+        return false;
+    }
+
+    bool hasAggregate = false;
+    for (const auto& item : stmt.selectList)
+    {
+        hasAggregate = hasAggregate || item.isAggregate;
+    }
+
+    if (isJoin)
+    {
+        if (!stmt.groupBy.empty() || !stmt.orderBy.empty() || stmt.limit != NO_LIMIT ||
+            stmt.offset != 0 || hasAggregate)
+        {
+            error = "JOIN does not support aggregates / GROUP BY / ORDER BY / LIMIT";
+            return false;
+        }
+        plan.path = AccessPath::JOIN;
+        plan.join.leftTable = plan.tableName;
+        plan.join.rightTable = std::string(stmt.joinTable);
+        for (const ColumnRef* side : {&stmt.joinLeft, &stmt.joinRight})
+        {
+            if (side->table == stmt.table && plan.join.leftField.empty())
             {
-                if (offset + sizeof(int) <= data.size)
-                {
-                    int val;
-                    std::memcpy(&val, data.data + offset, sizeof(int));
-                    std::cout << "Read INT value: " << val << std::endl;
-                    values.push_back(std::to_string(val));
-                    offset += sizeof(int);
-                }
-                else
-                {
-                    std::cerr << "Not enough data for INT at offset " << offset << std::endl;
-                }
-                break;
+                plan.join.leftField = std::string(side->field);
+            }
+            else if (side->table == stmt.joinTable && plan.join.rightField.empty())
+            {
+                plan.join.rightField = std::string(side->field);
+            }
+            else
+            {
+                error = "ON must compare a column of each table";
+                return false;
+            }
+        }
+
+        // Ϊ ȫֶ + ұȫֶΣͷǰ׺
+        for (const auto* side : {&plan.join.leftTable, &plan.join.rightTable})
+        {
+            for (const auto& field : tableDefs[*side].fields)
+            {
+                plan.headers.push_back(*side + "." + field.name);
+            }
+        }
+    }
+    else if (hasAggregate || !stmt.groupBy.empty())
+    {
+        if (!stmt.orderBy.empty() || stmt.limit != NO_LIMIT || stmt.offset != 0)
+        {
+            error = "ORDER BY / LIMIT / OFFSET are not supported with aggregates";
+            return false;
+        }
+
+        // Ϊ  + ۺУͨб GROUP BY 
+        plan.path = AccessPath::AGGREGATE;
+        for (const auto& column : stmt.groupBy)
+        {
+            plan.groupBy.push_back(std::string(column));
+        }
+        plan.headers = plan.groupBy;
+        for (const auto& item : stmt.selectList)
+        {
+            if (item.isAggregate)
+            {
+                AggregateDef agg;
+                agg.func = item.func;
+                agg.field = item.star ? "*" : std::string(item.column.field);
+                plan.columns.push_back(plan.groupBy.size() + plan.aggregates.size());
+                plan.headers.push_back(agg.label());
+                plan.aggregates.push_back(agg);
+                continue;
+            }
+
+            std::string name = item.star ? "*" : std::string(item.column.field);
+            auto pos = std::find(plan.groupBy.begin(), plan.groupBy.end(), name);
+            if (pos == plan.groupBy.end())
+            {
+                error = "column " + name + " must appear in GROUP BY";
+                return false;
+            }
+            plan.columns.push_back(pos - plan.groupBy.begin());
+        }
+        return true;
+    }
+    else
+    {
+        for (const auto& item : stmt.orderBy)
+        {
+            plan.options.orderBy.push_back(OrderByItem{std::string(item.field), item.descending});
+        }
+        plan.options.limit = stmt.limit;
+        plan.options.offset = stmt.offset;
+        plan.path = keyOrderUsable(def, plan.options) ? AccessPath::KEY_ORDER_SCAN : AccessPath::SORT_SCAN;
+        for (const auto& field : def.fields)
+        {
+            plan.headers.push_back(field.name);
+        }
+    }
+
+    // SELECT бΪ * аֶƥ䣬Ψһ
+    for (const auto& item : stmt.selectList)
+    {
+        if (item.star)
+        {
+            for (size_t i = 0; i < plan.headers.size(); i++)
+            {
+                plan.columns.push_back(i);
             }
+            continue;
+        }
+
+        size_t match = plan.headers.size();
+        for (size_t i = 0; i < plan.headers.size(); i++)
+        {
+            std::string_view header = plan.headers[i];
+            size_t dot = isJoin ? header.find('.') : std::string_view::npos;
+            std::string_view table = dot == std::string_view::npos ? stmt.table : header.substr(0, dot);
+            std::string_view field = dot == std::string_view::npos ? header : header.substr(dot + 1);
+            if (field != item.column.field || (!item.column.table.empty() && table != item.column.table))
+            {
+                continue;
+            }
+            if (match != plan.headers.size())
+            {
+                error = "ambiguous column: " + std::string(item.column.field);
+                return false;
+            }
+            match = i;
+        }
+        if (match == plan.headers.size())
+        {
+            error = "unknown column: " + std::string(item.column.field);
+            return false;
+        }
+        plan.columns.push_back(match);
+    }
+    return true;
+}
+
+QueryResult TableManager::execute(const QueryPlan& plan, const std::vector<std::string>& params,
+    SessionId session)
+{
+    QueryResult result;
+    if (params.size() != plan.paramCount)
+    {
+        std::cerr << "Expected " << plan.paramCount << " parameters, got " << params.size() << std::endl;
+        return result;
+    }
+
+    std::shared_lock<std::shared_mutex> catalog(catalogMutex);
+    if (plan.schemaVersion != schemaVersion)
+    {
+        // ṹڱ֮仯ԭı±
+        catalog.unlock();
+        std::string error;
+        std::shared_ptr<const QueryPlan> fresh = compile(plan.text, error);
+        if (!fresh)
+        {
+            std::cerr << "Failed to recompile statement: " << error << std::endl;
+            return result;
+        }
+        return execute(*fresh, params, session);
+    }
+
+    switch (plan.type)
+    {
+    case StatementType::CREATE_TABLE:
+    case StatementType::DROP_TABLE:
+    case StatementType::BEGIN_TRANSACTION:
+    case StatementType::COMMIT:
+    case StatementType::ROLLBACK:
+        // ЩԼĿ¼Ķռ
+        catalog.unlock();
+        return executeLocked(plan, params, session);
+    default:
+        break;
+    }
+
+    // ˳ͬʱʶ֮䲻
+    std::vector<std::string> names(1, plan.tableName);
+    if (plan.type == StatementType::SELECT && plan.path == AccessPath::JOIN)
+    {
+        names.push_back(plan.join.rightTable);
+    }
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+
+    // ѯڿ϶ȴд룻д֮ɱдŶӣTRUNCATE ռ
+    bool readOnly = plan.type == StatementType::SELECT || plan.type == StatementType::COPY_TO;
+    bool exclusive = plan.type == StatementType::TRUNCATE_TABLE;
+    std::vector<std::shared_lock<std::shared_mutex>> sharedLocks;
+    std::vector<std::unique_lock<std::shared_mutex>> exclusiveLocks;
+    std::vector<std::unique_lock<std::mutex>> writerLocks;
+    for (const auto& name : names)
+    {
+        auto it = tableLocks.find(name);
+        if (it == tableLocks.end())
+        {
+            continue; // ڣִб
+        }
+        if (!readOnly && unappliedTables.count(name))
+        {
+            std::cerr << "Table " << name << " has committed changes waiting to be replayed from "
+                << commitLogPath() << ", restart to write to it" << std::endl;
+            return result;
+        }
+        if (exclusive)
+        {
+            exclusiveLocks.emplace_back(it->second->table);
+            continue;
+        }
+        sharedLocks.emplace_back(it->second->table);
+        if (!readOnly)
+        {
+            writerLocks.emplace_back(it->second->writer);
+        }
+    }
+
+    // д֮жϣѾỰʱд
+    // ĻỰһдʱѱ񣬸Ķڴֱ COMMIT
+    auto tree = tables.find(plan.tableName);
+    if (!readOnly && transaction && tree != tables.end())
+    {
+        if (!inTransaction(session))
+        {
+            if (tree->second->in_transaction())
+            {
+                std::cerr << "Table " << plan.tableName << " is being written by another session's transaction"
+                    << std::endl;
+                return result;
+            }
+        }
+        else if (!tree->second->in_transaction())
+        {
+            tree->second->begin_transaction();
+        }
+    }
+    return executeLocked(plan, params, session);
+}
+
+QueryResult TableManager::executeLocked(const QueryPlan& plan, const std::vector<std::string>& params,
+    SessionId session)
+{
+    QueryResult result;
+    auto bind = [&](const std::string& literal, int param) -> const std::string&
+    {
+        return param < 0 ? literal : params[param];
+    };
+    auto bindAssignments = [&]()
+    {
+        std::vector<std::pair<size_t, std::string>> assignments;
+        assignments.reserve(plan.assignments.size());
+        for (const auto& assignment : plan.assignments)
+        {
+            assignments.emplace_back(assignment.first, bind(assignment.second.literal, assignment.second.param));
+        }
+        return assignments;
+    };
+
+    switch (plan.type)
+    {
+    case StatementType::CREATE_TABLE:
+        result.ok = createTable(plan.tableDef);
+        return result;
+
+    case StatementType::DROP_TABLE:
+        result.ok = dropTable(plan.tableName);
+        return result;
+
+    case StatementType::TRUNCATE_TABLE:
+        result.ok = truncateTable(plan.tableName);
+        return result;
+
+    case StatementType::BEGIN_TRANSACTION:
+        result.ok = beginTransaction(session);
+        return result;
+
+    case StatementType::COMMIT:
+        result.ok = commit(session);
+        return result;
+
+    case StatementType::ROLLBACK:
+        result.ok = rollback(session);
+        return result;
 
-            case FieldType::VARCHAR:
+    case StatementType::INSERT:
+    {
+        if (plan.conflict != ConflictAction::FAIL)
+        {
+            size_t width = plan.values.size() / plan.rowCount;
+            std::vector<std::vector<std::string>> rows(plan.rowCount);
+            for (size_t i = 0; i < plan.rowCount; i++)
             {
-                if (offset < data.size)
+                for (size_t j = 0; j < width; j++)
                 {
-                    const char* str = data.data + offset;
-                    size_t maxLen = std::min(field.size - 1, data.size - offset);
-                    size_t strLen = strnlen(str, maxLen);
-                    std::string value(str, strLen);
-                    std::cout << "Read VARCHAR value: '" << value << "' (len=" << strLen << ")" << std::endl;
-                    values.push_back(std::move(value));
-                    offset += field.size;
+                    const PlanValue& value = plan.values[i * width + j];
+                    rows[i].push_back(bind(value.literal, value.param));
                 }
-                else
+            }
+            result.ok = upsert(plan.tableName, rows, plan.conflict, bindAssignments(), result.affected);
+            return result;
+        }
+
+        if (plan.rowCount == 1)
+        {
+            std::vector<std::string> values;
+            values.reserve(plan.values.size());
+            for (const auto& value : plan.values)
+            {
+                values.push_back(bind(value.literal, value.param));
+            }
+            result.ok = insert(plan.tableName, values);
+        }
+        else
+        {
+            size_t width = plan.values.size() / plan.rowCount;
+            std::vector<std::vector<std::string>> rows(plan.rowCount);
+            for (size_t i = 0; i < plan.rowCount; i++)
+            {
+                rows[i].reserve(width);
+                for (size_t j = 0; j < width; j++)
                 {
-                    std::cerr << "Not enough data for VARCHAR at offset " << offset << std::endl;
+                    const PlanValue& value = plan.values[i * width + j];
+                    rows[i].push_back(bind(value.literal, value.param));
                 }
-                break;
-            }
             }
+            result.ok = insertBatch(plan.tableName, rows);
+        }
+        result.affected = result.ok ? plan.rowCount : 0;
+        return result;
+    }
+
+    case StatementType::COPY_FROM:
+        result.ok = copyFrom(plan.tableName, plan.fileName, plan.copy, result.affected);
+        return result;
+
+    case StatementType::SELECT:
+    case StatementType::COPY_TO:
+    case StatementType::UPDATE:
+    case StatementType::DELETE_FROM:
+        break;
+
+    default:
+        return result;
+    }
+
+    std::vector<Condition> conditions;
+    conditions.reserve(plan.where.size());
+    for (const auto& cond : plan.where)
+    {
+        conditions.push_back(cond.cond);
+        conditions.back().value = bind(cond.cond.value, cond.param);
+    }
+
+    // ֻĻỰлûύĿ
+    bool ownWrites = inTransaction(session);
+    if (plan.type == StatementType::COPY_TO)
+    {
+        result.ok = copyTo(plan.tableName, plan.fileName, plan.copy, conditions, ownWrites, result.affected);
+        return result;
+    }
+    if (plan.type == StatementType::UPDATE)
+    {
+        result.ok = update(plan.tableName, bindAssignments(), conditions, result.affected);
+        return result;
+    }
+    if (plan.type == StatementType::DELETE_FROM)
+    {
+        result.ok = deleteRecords(plan.tableName, conditions, result.affected);
+        return result;
+    }
+
+    std::vector<std::vector<std::string>> rows;
+    result.ok = true;
+    switch (plan.path)
+    {
+    case AccessPath::AGGREGATE:
+        rows = aggregate(plan.tableName, plan.groupBy, plan.aggregates, conditions, ownWrites);
+        result.ok = !rows.empty() || !plan.groupBy.empty();
+        break;
+    case AccessPath::JOIN:
+        rows = join(plan.join, conditions, ownWrites);
+        break;
+    default:
+    {
+        RowPredicate predicate;
+        if (!predicate.compile(tableDefs[plan.tableName], conditions))
+        {
+            std::cerr << "Invalid WHERE clause" << std::endl;
+            result.ok = false;
+            return result;
+        }
+        if (plan.path == AccessPath::KEY_ORDER_SCAN)
+        {
+            bool descending = !plan.options.orderBy.empty() && plan.options.orderBy[0].descending;
+            rows = scanKeyOrder(plan.tableName, predicate, descending, plan.options.limit, plan.options.offset,
+                ownWrites);
+        }
+        else
+        {
+            rows = sortScan(plan.tableName, predicate, plan.options, ownWrites);
+        }
+        break;
+    }
+    }
+
+    //  SELECT б
+    for (size_t column : plan.columns)
+    {
+        result.headers.push_back(plan.headers[column]);
+    }
+    result.rows.reserve(rows.size());
+    for (auto& row : rows)
+    {
+        std::vector<std::string> projected;
+        projected.reserve(plan.columns.size());
+        for (size_t column : plan.columns)
+        {
+            projected.push_back(row[column]);
+        }
+        result.rows.push_back(std::move(projected));
+    }
+    return result;
+}
+
+bpt::key_t TableManager::makeKey(const TableDef& def, const std::string& value)
+{
+    if (isNullText(value))
+    {
+        throw std::invalid_argument("primary key " + def.fields[0].name + " cannot be NULL");
+    }
+    if (def.orderedKeys && !def.fields.empty() && def.fields[0].type != FieldType::VARCHAR)
+    {
+        // ͵ļͬȵııkeycmp ˳ֵ˳
+        char buf[8];
+        if (!encodeField(def.fields[0], value, buf))
+        {
+            throw std::invalid_argument("invalid " + def.fields[0].name + " value: " + value);
         }
+        return bpt::key_t(orderedKeyText(def.fields[0], buf).c_str());
+    }
+    return bpt::key_t(value.c_str());
+}
+
+bpt::value_t TableManager::serializeValues(const TableDef& def, const std::vector<std::string>& values)
+{
+    std::cout << "Serializing values..." << std::endl;
+    std::cout << "Max record size: " << def.recordSize << std::endl;
+
+    bpt::value_t value;
+    value.data = new char[def.recordSize];
+
+    try
+    {
+        value.size = serializeValues(def, values, value.data);
+        std::cout << "Record size: " << value.size << std::endl;
     }
     catch (const std::exception& e)
     {
-        std::cerr << "Error during deserialization: " << e.what() << std::endl;
-        values.clear();
+        std::cerr << "Error during serialization: " << e.what() << std::endl;
+        value.clear();
+        throw;
+    }
+
+    return value;
+}
+
+size_t TableManager::serializeValues(const TableDef& def, const std::vector<std::string>& values, char* out)
+{
+    std::string error;
+    size_t length = def.layout.encode(values, out, error);
+    if (length == 0)
+    {
+        throw std::invalid_argument(error);
+    }
+    return length;
+}
+
+std::vector<std::string> TableManager::deserializeValues(const TableDef& def, const bpt::value_t& data)
+{
+    return deserializeValues(def, data.data, data.size);
+}
+
+std::vector<std::string> TableManager::deserializeValues(const TableDef& def, const char* data, size_t size)
+{
+    if (!data || size == 0)
+    {
+        std::cerr << "Invalid data pointer or size" << std::endl;
+        return std::vector<std::string>();
     }
 
+    std::vector<std::string> values = def.layout.decode(data, size);
+    if (values.size() < def.fields.size())
+    {
+        std::cerr << "Record of size " << size << " is shorter than the table layout" << std::endl;
+    }
     return values;
 }
 
+bool TableManager::openDictionaries(TableDef& def, bool create)
+{
+    def.dictionaries.assign(def.fields.size(), nullptr);
+    for (size_t i = 0; i < def.fields.size(); i++)
+    {
+        if (!def.fields[i].dictionary)
+        {
+            continue;
+        }
+        std::string filename = dbPath + def.tableName + "." + def.fields[i].name + ".dict";
+        if (create)
+        {
+            remove(filename.c_str()); // ͬɱµֵ
+        }
+        def.dictionaries[i] = std::make_shared<Dictionary>(filename);
+        if (!def.dictionaries[i]->load())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 void TableManager::saveTableDefs()
 {
     std::string metaFile = dbPath + "tables.meta";
@@ -446,6 +2379,25 @@ void TableManager::saveTableDefs()
                 << static_cast<int>(field.type) << " "
                 << field.size << std::endl;
         }
+        if (def.orderedKeys)
+        {
+            ofs << "ORDERED_KEYS" << std::endl;
+        }
+        if (def.variableRows)
+        {
+            ofs << "VARIABLE_ROWS" << std::endl;
+        }
+        if (def.nullBitmap)
+        {
+            ofs << "NULL_BITMAP" << std::endl;
+        }
+        for (const auto& field : def.fields)
+        {
+            if (field.dictionary)
+            {
+                ofs << "DICTIONARY " << field.name << std::endl;
+            }
+        }
         ofs << "END_TABLE" << std::endl; // ӱ
     }
 
@@ -505,7 +2457,6 @@ void TableManager::loadTableDefs()
 
         std::cout << "Field count: " << fieldCount << std::endl;
 
-        size_t totalSize = 0;
         for (size_t i = 0; i < fieldCount && ifs.good(); i++)
         {
             FieldDef field;
@@ -514,16 +2465,6 @@ void TableManager::loadTableDefs()
             {
                 field.type = static_cast<FieldType>(type);
                 def.fields.push_back(field);
-
-                switch (field.type)
-                {
-                case FieldType::INT:
-                    totalSize += sizeof(int);
-                    break;
-                case FieldType::VARCHAR:
-                    totalSize += field.size;
-                    break;
-                }
                 std::cout << "Loaded field: " << field.name << std::endl;
             }
             else
@@ -531,12 +2472,41 @@ void TableManager::loadTableDefs()
                 std::cerr << "Failed to read field " << i << " for table: " << tableName << std::endl;
             }
         }
-        def.recordSize = totalSize;
 
         // ȡ
         std::string endMark;
         std::getline(ifs, endMark);
         std::getline(ifs, endMark);
+        if (endMark == "ORDERED_KEYS")
+        {
+            def.orderedKeys = true;
+            std::getline(ifs, endMark);
+        }
+        if (endMark == "VARIABLE_ROWS")
+        {
+            def.variableRows = true;
+            std::getline(ifs, endMark);
+        }
+        if (endMark == "NULL_BITMAP")
+        {
+            def.nullBitmap = true;
+            std::getline(ifs, endMark);
+        }
+        while (endMark.compare(0, 11, "DICTIONARY ") == 0)
+        {
+            int index = def.fieldIndex(endMark.substr(11));
+            if (index >= 0)
+            {
+                def.fields[index].dictionary = true;
+            }
+            std::getline(ifs, endMark);
+        }
+        if (!openDictionaries(def, false))
+        {
+            std::cerr << "Failed to load dictionaries for table: " << tableName << std::endl;
+            continue;
+        }
+        def.calculateRecordSize(); // 뽨ʱĲһ£
         if (endMark != "END_TABLE")
         {
             std::cerr << "Invalid table definition format" << std::endl;
@@ -550,8 +2520,10 @@ void TableManager::loadTableDefs()
             auto* tree = new bpt::bplus_tree(filename.c_str());
             if (tree && tree->get_meta().order == BP_ORDER)
             {
+                def.copyOnWrite = tree->copy_on_write();
                 tables[tableName] = tree;
                 tableDefs[tableName] = def;
+                tableLocks[tableName].reset(new TableLock);
                 std::cout << "Successfully loaded table: " << tableName << std::endl;
             }
             else
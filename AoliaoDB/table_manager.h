@@ -1,8 +1,23 @@
 #pragma once
 #include "bpt.h"
 #include "table_def.h"
+#include "query_def.h"
+#include "predicate.h"
+#include "hash_join.h"
+#include "query_plan.h"
+#include <atomic>
+#include <functional>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
 
+// Ựͬʱ executeִڼĿ¼Ĺ漰
+// ѯ COPY TO ڿ϶ֻд빲бдͬһдִУ
+// ѯTRUNCATE ռCREATE / DROP ռĿ¼
+// ״̬ TableManager ģڼ䲻ӦִỰ䡣
+// ķԼдֻͨ execute ִ
 class TableManager
 {
 public:
@@ -14,15 +29,38 @@ public:
     // ɾ
     bool dropTable(const std::string& tableName);
 
-    // ȡ
+    // ִĻỰֻлỰ 0Ϊÿӷһ
+    typedef unsigned long long SessionId;
+
+    // ͬһʱֻһỰ񡣱еһαдʱ
+    // ֮дĿֻڴУֻỰĶȡܿỰϴύİ汾
+    // дѾıʱش
+    // COMMIT ѼıĿдͬһύ־ͬһΣдظļɾ־
+    // ־֮ͬύɹдʧʱط־طҲʧʱЩ֮ǰֻ
+    // ROLLBACK Щ顣в CREATE / DROPֵֵع
+    bool beginTransaction(SessionId session = 0);
+    bool commit(SessionId session = 0);
+    bool rollback(SessionId session = 0);
+
+    // session Ƿ
+    bool inTransaction(SessionId session = 0) const
+    {
+        return transaction && transactionSession == session;
+    }
+
+    // ȡĸ
     TableDef getTableDef(const std::string& tableName);
 
-    // ¼
-    bool insert(const std::string& tableName, const std::vector<std::string>& values);
+    // ΪִмƻֶΡѡ·е ? Ϊ
+    // ƻ淶ı LRU 棬ʧʱؿղ error
+    std::shared_ptr<const QueryPlan> prepare(const std::string& sql, std::string& error);
+
+    // ͬϣеȡ paramsԶֻͬ乲һƻ
+    std::shared_ptr<const QueryPlan> prepare(const std::string& sql,
+        std::vector<std::string>& params, std::string& error);
 
-    // ѯ¼
-    std::vector<std::vector<std::string>> select(const std::string& tableName,
-        const std::string& where = "");
+    // 󶨲ִмƻṹڱ֮仯ʱԶ±
+    QueryResult execute(const QueryPlan& plan, const std::vector<std::string>& params, SessionId session = 0);
 
     ~TableManager()
     {
@@ -44,13 +82,151 @@ private:
     std::map<std::string, bpt::bplus_tree*> tables;
     std::map<std::string, TableDef> tableDefs;
 
+    // Ŀ¼ɾ tables / tableDefs / tableLocks޸ schemaVersion Ϳʼʱռ
+    // ִкͱڼ乲
+    std::shared_mutex catalogMutex;
+    // ÿɾֻڳĿ¼ʱӳ
+    struct TableLock
+    {
+        std::shared_mutex table; // ֻ TRUNCATE ռ
+        std::mutex writer;       // дγ
+    };
+    std::map<std::string, std::unique_ptr<TableLock>> tableLocks;
+
+    std::atomic<bool> transaction{ false };
+    std::atomic<SessionId> transactionSession{ 0 }; // ʼĻỰ
+    // ύдغطŶʧܵıļύݲһ£ط־֮ǰֻ
+    std::set<std::string> unappliedTables;
+
+    PlanCache planCache;
+    std::mutex planMutex; // Ŀ¼ıͬʱУ汾
+    unsigned long long schemaVersion = 0; // ÿ CREATE / DROP һ
+
+    // Ŀ¼Ĺͱִ֮мƻ
+    QueryResult executeLocked(const QueryPlan& plan, const std::vector<std::string>& params, SessionId session);
+
+    // µĶдֻ executeLocked ڳĿ¼ͱʱ
+    // ձB+ ļضϺ³ʼṹֵ䱣
+    bool truncateTable(const std::string& tableName);
+
+    // ¼
+    bool insert(const std::string& tableName, const std::vector<std::string>& values);
+    // в룺лһһд B+ ʱͬһΡ
+    // ڻеļظʱܾ
+    bool insertBatch(const std::string& tableName, const std::vector<std::vector<std::string>>& rows);
+
+    // INSERT OR REPLACE / ON CONFLICTÿֻ½һΣѴʱҶԭ滻 assignments ޸ġ
+    // ȱ룬ʧʱдκһУcount ز޸ĵDO NOTHING в
+    bool upsert(const std::string& tableName, const std::vector<std::vector<std::string>>& rows,
+        ConflictAction conflict, const std::vector<std::pair<size_t, std::string>>& assignments, size_t& count);
+
+    // COPY table FROM 'file'н CSVձԵϽǿձ룬count ص
+    bool copyFrom(const std::string& tableName, const std::string& path,
+        const CopyOptions& options, size_t& count);
+
+    // COPY table TO 'file'Ҷʽдļ¼CSV Ƹʽcount д
+    bool copyTo(const std::string& tableName, const std::string& path,
+        const CopyOptions& options, const std::vector<Condition>& conditions, bool ownWrites, size_t& count);
+
+    // UPDATEassignments Ϊ (ֶ±, ֵ)޸ġ
+    // ֵȽʱֱӲһ¼Ҷɨһ飬ÿҶдһ
+    bool update(const std::string& tableName, const std::vector<std::pair<size_t, std::string>>& assignments,
+        const std::vector<Condition>& conditions, size_t& count);
+
+    // DELETEֵʱֱɾзΧʱֻʷΧڵҶӣɾյҶժ
+    // ɨһԭɾֻлڰҶ remove ϲ
+    bool deleteRecords(const std::string& tableName, const std::vector<Condition>& conditions, size_t& count);
+
+    // ۺϲѯҶΪɹ̲߳м㲿״̬ϲ
+    // groupBy ΪʱһнÿһУ + ۺ
+    std::vector<std::vector<std::string>> aggregate(const std::string& tableName,
+        const std::vector<std::string>& groupBy, const std::vector<AggregateDef>& aggregates,
+        const std::vector<Condition>& where, bool ownWrites);
+
+    // ֵӣÿΪ ȫֶ + ұȫֶ
+    // ǴʱʹǶѭӣʹùϣ
+    // where е .ֶ ָıɨʱֱ
+    std::vector<std::vector<std::string>> join(const JoinDef& joinDef,
+        const std::vector<Condition>& where, bool ownWrites);
+
+    // ṹ仯лļƻ
+    void invalidatePlans();
+
+    // 淶䲢ɼƻȲ黺
+    std::shared_ptr<const QueryPlan> compile(const std::string& text, std::string& error);
+    bool buildPlan(const Statement& stmt, QueryPlan& plan, std::string& error);
+    // ﷨е WHERE תΪƻе
+    bool buildWhere(const Statement& stmt, QueryPlan& plan, std::string& error);
+    bool buildSelectPlan(const Statement& stmt, QueryPlan& plan, std::string& error);
+    // SET бΪֶ±ֵܸ꣬
+    static bool buildAssignments(const Statement& stmt, const TableDef& def, QueryPlan& plan, std::string& error);
+
+    // ѯܷҶ˳ɨ裬Ҫ
+    static bool keyOrderUsable(const TableDef& def, const SelectOptions& options);
+
+    // ȫɨ򣬳ڴԤʱⲿ鲢 LIMIT ʱʹ top-N 
+    std::vector<std::vector<std::string>> sortScan(const std::string& tableName,
+        const RowPredicate& predicate, const SelectOptions& options, bool ownWrites);
+
+    // ļ¼д B+ еļظʱܾ
+    // ¼ĿΪ def.recordSizelengths Ϊÿ¼ʵʳ
+    bool insertSorted(bpt::bplus_tree* tree, const TableDef& def,
+        const std::vector<bpt::key_t>& keys, const char* rows, const size_t* lengths);
+
+    // Ϊֵдֵ䣬create ʱͬľֵļ
+    bool openDictionaries(TableDef& def, bool create);
+
+    // ɵһеֵ B+ ļ
+    static bpt::key_t makeKey(const TableDef& def, const std::string& value);
+
+    // Ҷ˳ɨ裬descending ʱһҶ prev  limit ֹͣ
+    std::vector<std::vector<std::string>> scanKeyOrder(const std::string& tableName,
+        const RowPredicate& predicate, bool descending, size_t limit, size_t offset, bool ownWrites);
+
+    // Ҷ˳ɨļ¼callback  false ʱֹͣ
+    // ȡڿϣownWrites Ϊ true ʱиĹĿҲֻܶĻỰ
+    bool scanRows(bpt::bplus_tree* tree, const RowPredicate& predicate, bool ownWrites,
+        const std::function<bool(const char*, size_t)>& callback);
+
+    // ǷΪֱӲ B+ 
+    static bool keyLookupUsable(const TableDef& def, const std::string& field);
+
+    // пֱӲ B+ ֵȽϣûз nullptr
+    static const Condition* keyCondition(const TableDef& def, const std::vector<Condition>& conditions);
+
+    // Ķ > >= < <= ı䣬û½ϽʱӦ has Ϊ false
+    // ûлVARCHARʱ false
+    static bool keyRange(const TableDef& def, const std::vector<Condition>& conditions,
+        bpt::key_t& left, bool& hasLeft, bpt::key_t& right, bool& hasRight);
+
+    // Ƕѭӣɨ࣬Ӽڲ B+ ϲ
+    // emit ĵһΪ¼
+    bool indexJoin(bpt::bplus_tree* outerTree, const RowPredicate& outerPredicate,
+        const JoinKeyColumn& outerKey, const TableDef& innerDef, bpt::bplus_tree* innerTree,
+        const RowPredicate& innerPredicate, bool ownWrites, const HashJoiner::JoinCallback& emit);
+
     // ֵַתΪƸʽ
     bpt::value_t serializeValues(const TableDef& def,
         const std::vector<std::string>& values);
+    // д÷ṩ def.recordSize ֽڻؼ¼ʵʳ
+    size_t serializeValues(const TableDef& def,
+        const std::vector<std::string>& values, char* out);
 
     // Ƹʽתֵַ
     std::vector<std::string> deserializeValues(const TableDef& def,
         const bpt::value_t& data);
+    std::vector<std::string> deserializeValues(const TableDef& def,
+        const char* data, size_t size);
+
+    // ύ־ļ·дĿ飬ύǽβ
+    std::string commitLogPath() const
+    {
+        return dbPath + "commit.log";
+    }
+
+    // ʱطŴύǵ־ûб˵ύûɣļδĶֱɾ
+    // ύʱдʧҲطšطʧܡ־ʱ false
+    bool recoverCommitLog();
 
     // 嵽ļ
     void saveTableDefs();